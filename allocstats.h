@@ -0,0 +1,147 @@
+/*******************************************************************************************
+* allocstats.h - heap allocation accounting for "Dodge!" (diagnostics build)
+*
+*   - Counts every heap allocation: glibc builds interpose malloc/calloc/realloc/etc.
+*     (this also catches raylib's RL_MALLOC and operator new); other platforms replace
+*     the global operator new/new[]
+*   - Only the main thread's allocations go into the frame and phase counts (plain
+*     counters, touched by one thread only). The tuning watcher and save threads allocate
+*     too; they only bump an atomic tally, printed by the report but not checked
+*   - PROFILE_SCOPE blocks attribute allocations to frame phases (see profiler.h)
+*   - AllocStatsEndFrame() closes a frame; frames that started in PLAYING are the
+*     "steady state" and must not allocate at all
+*   - AllocStatsReport() prints per-phase totals and returns the number of steady-state
+*     frames that allocated, so main() can fail the run (non-zero exit code)
+*
+* Compile-time switch: build with -DDODGE_ALLOC_STATS. Include this header from exactly
+* one translation unit (it defines the allocation functions).
+*******************************************************************************************/
+
+#pragma once
+
+#ifdef DODGE_ALLOC_STATS
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+static const int ALLOC_MAX_PHASES = 16;
+
+struct AllocStats {
+    unsigned long total;                        // allocations since start
+    unsigned long long totalBytes;
+    unsigned long frameStart;                   // total at the start of the current frame
+    unsigned long frames;
+    unsigned long steadyFrames;                 // frames that started in PLAYING
+    unsigned long steadyFramesAllocating;       // ... of which allocated at least once
+    unsigned long steadyAllocs;                 // allocations made in those frames
+    unsigned long worstFrame;                   // most allocations in one steady frame
+    unsigned long phase[ALLOC_MAX_PHASES];      // allocations per PROFILE_SCOPE phase
+};
+
+static AllocStats gAllocStats = {};                                    // main thread only
+static std::atomic<unsigned long> gAllocOtherThreads{ 0 };             // allocations anywhere else
+static const std::thread::id gAllocMainThread = std::this_thread::get_id();   // set before main()
+
+static inline void AllocStatsCount(size_t bytes)
+{
+    // Before gAllocMainThread is set there is only the main thread
+    if (gAllocMainThread != std::thread::id() && std::this_thread::get_id() != gAllocMainThread) {
+        gAllocOtherThreads.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    gAllocStats.total++;
+    gAllocStats.totalBytes += bytes;
+}
+
+// --- : Allocation hooks ------------------------------------------------------------------
+#if defined(__GLIBC__)
+
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+
+    void *malloc(size_t size)             { AllocStatsCount(size); return __libc_malloc(size); }
+    void *calloc(size_t n, size_t size)   { AllocStatsCount(n*size); return __libc_calloc(n, size); }
+    void *realloc(void *ptr, size_t size) { AllocStatsCount(size); return __libc_realloc(ptr, size); }
+    void *memalign(size_t alignment, size_t size) { AllocStatsCount(size); return __libc_memalign(alignment, size); }
+    void *aligned_alloc(size_t alignment, size_t size) { AllocStatsCount(size); return __libc_memalign(alignment, size); }
+    int posix_memalign(void **out, size_t alignment, size_t size)
+    {
+        AllocStatsCount(size);
+        *out = __libc_memalign(alignment, size);
+        return *out ? 0 : 12; // ENOMEM
+    }
+}
+
+#else
+
+// operator new is the only portable hook (misses C allocations inside raylib)
+void *operator new(size_t size)
+{
+    AllocStatsCount(size);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { AllocStatsCount(size); return malloc(size ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { AllocStatsCount(size); return malloc(size ? size : 1); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#endif
+
+// Attributes allocations made in the enclosing scope to a phase
+struct AllocScope {
+    int phase;
+    unsigned long start;
+    explicit AllocScope(int p) : phase(p), start(gAllocStats.total) {}
+    ~AllocScope() { gAllocStats.phase[phase] += gAllocStats.total - start; }
+};
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b)  ALLOC_CONCAT_(a, b)
+#define ALLOC_SCOPE(phase)  AllocScope ALLOC_CONCAT(_allocScope, __LINE__)(phase)
+
+// steady = the frame started in PLAYING (no ResetGame, no state setup)
+static void AllocStatsEndFrame(bool steady)
+{
+    AllocStats &a = gAllocStats;
+    unsigned long n = a.total - a.frameStart;
+    a.frames++;
+    if (steady) {
+        a.steadyFrames++;
+        a.steadyAllocs += n;
+        if (n > 0) a.steadyFramesAllocating++;
+        if (n > a.worstFrame) a.worstFrame = n;
+    }
+    a.frameStart = a.total;
+}
+
+static unsigned long AllocStatsReport(const char *const *phaseNames, int phaseCount)
+{
+    const AllocStats &a = gAllocStats;
+    printf("Allocations: %lu total (%llu bytes) over %lu frames, %lu on other threads (not checked)\n",
+           a.total, a.totalBytes, a.frames, gAllocOtherThreads.load(std::memory_order_relaxed));
+    for (int i = 0; i < phaseCount && i < ALLOC_MAX_PHASES; ++i) {
+        printf("  %-10s %lu\n", phaseNames[i], a.phase[i]);
+    }
+    printf("Steady-state (PLAYING) frames: %lu, allocating: %lu, allocations: %lu, worst frame: %lu\n",
+           a.steadyFrames, a.steadyFramesAllocating, a.steadyAllocs, a.worstFrame);
+    if (a.steadyFramesAllocating > 0) printf("ALLOC CHECK FAILED: steady-state frames allocated\n");
+    return a.steadyFramesAllocating;
+}
+
+#else // !DODGE_ALLOC_STATS
+
+#define ALLOC_SCOPE(phase) ((void)0)
+static inline void AllocStatsEndFrame(bool) {}
+static inline unsigned long AllocStatsReport(const char *const *, int) { return 0; }
+
+#endif // DODGE_ALLOC_STATS
@@ -0,0 +1,334 @@
+/*******************************************************************************************
+* bench.cpp - headless micro-benchmarks for the "Dodge!" simulation (game.h)
+*
+*   - ResetGame, UpdateEnemies (FallEnemies + RecycleEnemies), PlayerHit (bounding boxes only, and with every
+*     enemy going through the exact-shape narrowphase), the same three on the fixed-point
+*     path (*Fixed, fixed.h), a whole StepGame with and without the per-tick state hashes
+*     (Game::hashTicks) and the end-of-tick hash alone, snapshot save/load at 10 .. 1M enemies,
+*     one lookahead bot decision (bot.h) and one software-rendered frame (raster.h, 84x84 and
+*     800x450) at 10 .. 1000, a spectator delta frame (spectate.h), plus the HUD TextFormat calls
+*   - Never opens a window, so it runs on a headless Linux box
+*   - Prints a table, and with --json <file> writes Google Benchmark-compatible JSON
+*     (same "benchmarks" schema, so Google Benchmark's compare.py can diff two commits)
+*
+* USAGE
+*   dodge_bench [--json out.json] [--filter substring] [--min-time seconds] [--max-enemies N]
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../snapshot.h"
+#include "../bot.h"
+#include "../raster.h"
+#include "../spectate.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Keeps the optimiser from deleting work whose result is never read
+template <typename T> static inline void DoNotOptimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+struct BenchResult {
+    char name[64];
+    long iterations;
+    double nsPerIter;
+    double itemsPerSec;     // enemies processed per second (0 when not meaningful)
+};
+
+struct BenchOptions {
+    const char *jsonPath = nullptr;
+    const char *filter = nullptr;
+    double minTime = 0.5;   // seconds per benchmark
+    int maxEnemies = 1000000;
+};
+
+static std::vector<BenchResult> gResults;
+static BenchOptions gOpt;
+
+static double NowSec()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs body(iterations) with growing iteration counts until it takes at least minTime
+template <typename Body>
+static void RunBench(const char *name, long items, Body body)
+{
+    if (gOpt.filter && !strstr(name, gOpt.filter)) return;
+
+    long iters = 1;
+    double elapsed = 0.0;
+    for (;;) {
+        double t0 = NowSec();
+        body(iters);
+        elapsed = NowSec() - t0;
+        if (elapsed >= gOpt.minTime || iters >= (1L << 30)) break;
+        // Aim a bit past minTime, but never grow more than 10x per step
+        double scale = (elapsed > 0.0) ? gOpt.minTime*1.4/elapsed : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iters = (long)(iters*scale);
+    }
+
+    BenchResult r = {};
+    snprintf(r.name, sizeof(r.name), "%s", name);
+    r.iterations = iters;
+    r.nsPerIter = elapsed*1e9/iters;
+    r.itemsPerSec = items ? (double)items*iters/elapsed : 0.0;
+    gResults.push_back(r);
+
+    printf("%-32s %12ld %14.1f ns %14.3e items/s\n", r.name, r.iterations, r.nsPerIter, r.itemsPerSec);
+    fflush(stdout);
+}
+
+static void WriteJson(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "bench: could not write %s\n", path); return; }
+
+    fprintf(f, "{\n  \"context\": { \"executable\": \"dodge_bench\", \"min_time\": %.3f },\n", gOpt.minTime);
+    fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < gResults.size(); ++i) {
+        const BenchResult &r = gResults[i];
+        fprintf(f, "    { \"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %ld, "
+                   "\"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\", \"items_per_second\": %.1f }%s\n",
+                r.name, r.iterations, r.nsPerIter, r.nsPerIter, r.itemsPerSec,
+                (i + 1 < gResults.size()) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--json") && i + 1 < argc) gOpt.jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc) gOpt.filter = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) gOpt.minTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-enemies") && i + 1 < argc) gOpt.maxEnemies = atoi(argv[++i]);
+        else { fprintf(stderr, "usage: %s [--json file] [--filter str] [--min-time s] [--max-enemies N]\n", argv[0]); return 1; }
+    }
+
+    printf("%-32s %12s %17s %20s\n", "benchmark", "iterations", "time/iter", "throughput");
+
+    const float dt = 1.0f/60.0f;
+    char name[64];
+
+    for (int n = 10; n <= gOpt.maxEnemies; n *= 10) {
+        Game game;
+        InitGame(game, 1234, n, WeatherKind::SUNNY);
+
+        snprintf(name, sizeof(name), "ResetGame/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                game.weather = (WeatherKind)(i % 3);
+                ResetGame(game);
+                DoNotOptimize(game.enemies.kinds[0].y.data());
+            }
+        });
+
+        game.weather = WeatherKind::RAINY;
+        ResetGame(game);
+        Player &player = game.player;
+        EnemyPool &enemies = game.enemies;
+
+        snprintf(name, sizeof(name), "UpdateEnemies/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                FallEnemies(game, dt);
+                RecycleEnemies(game);
+                DoNotOptimize(enemies.kinds[RainKind::KIND].y.data());
+            }
+        });
+
+        // The same on the fixed-point path (values on the exact grid, fixed.h)
+        Game fixedGame;
+        fixedGame.fixedPoint = true;
+        InitGame(fixedGame, 1234, n, WeatherKind::RAINY);
+
+        snprintf(name, sizeof(name), "UpdateEnemiesFixed/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                FallEnemies(fixedGame, dt);
+                RecycleEnemies(fixedGame);
+                DoNotOptimize(fixedGame.enemies.kinds[RainKind::KIND].y.data());
+            }
+        });
+
+        // Whole ticks while playing (invincible and no ramp, so the run and the count stay
+        // put), then the same with the per-tick state hashes on. The two run one after the
+        // other on a state that keeps moving, so their difference is mostly noise:
+        // FinishTickHash/n below times the hashing on its own
+        Game ticking;
+        InitGame(ticking, 1234, n, WeatherKind::RAINY);
+        ticking.invincible = true;
+        ticking.difficultyRamp = false;
+        StepGame(ticking, { KEYS_START, -1, dt });
+
+        for (int hashed = 0; hashed < 2; ++hashed) {
+            ticking.hashTicks = hashed != 0;
+            snprintf(name, sizeof(name), hashed ? "StepGameHashed/%d" : "StepGame/%d", n);
+            RunBench(name, n, [&](long iters) {
+                for (long i = 0; i < iters; ++i) {
+                    StepGame(ticking, { 0, -1, dt });
+                    DoNotOptimize(ticking.tickHash);
+                }
+            });
+        }
+
+        // The end-of-tick hash alone, a different enemy window each call as in a run (the
+        // slot writes it folds in are a few adds per spawn or recycle, left out)
+        snprintf(name, sizeof(name), "FinishTickHash/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                ticking.ticks++;
+                FinishTickHash(ticking);
+                DoNotOptimize(ticking.tickHash);
+            }
+        });
+
+        // Player parked in the bottom-left corner and every enemy lifted above the screen,
+        // so nothing overlaps and PlayerHit() has to test every enemy (the worst case)
+        player.rect = player.prevRect = { 0.0f, SCREEN_H - 36.0f, 36.0f, 36.0f };
+        for (EnemyBucket &b : enemies.kinds) {
+            for (int i = 0; i < b.count; ++i) b.y[i] = -100.0f - b.h[i];
+        }
+
+        snprintf(name, sizeof(name), "PlayerHit/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                bool hit = PlayerHit(player, enemies, dt);
+                DoNotOptimize(hit);
+            }
+        });
+
+        snprintf(name, sizeof(name), "PlayerHitFixed/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                bool hit = PlayerHitFixed(player, enemies, dt);
+                DoNotOptimize(hit);
+            }
+        });
+
+        // Save states of the whole game (rewind / rollback / bot lookahead), into a warm buffer
+        GameSnapshot snap;
+        SaveGameSnapshot(game, snap);
+        Game restored;
+
+        snprintf(name, sizeof(name), "SnapshotSave/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                SaveGameSnapshot(game, snap);
+                DoNotOptimize(snap.bytes.data());
+            }
+        });
+
+        snprintf(name, sizeof(name), "SnapshotLoad/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                LoadGameSnapshot(restored, snap);
+                DoNotOptimize(restored.enemies.kinds[RainKind::KIND].y.data());
+            }
+        });
+
+        // One spectator delta frame (spectate.h) per tick; the body also runs the tick itself
+        // (fall + recycle), so the encode is this minus UpdateEnemies above
+        SpecState spec;
+        std::vector<unsigned char> frame;
+        SpecEncode(spec, game, 0, true, frame);
+
+        snprintf(name, sizeof(name), "SpecEncodeTick/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                FallEnemies(game, dt);
+                RecycleEnemies(game);
+                frame.clear();
+                SpecEncode(spec, game, (unsigned int)i, false, frame);
+                DoNotOptimize(frame.data());
+            }
+        });
+
+        // All three kinds, each enemy's bounding box overlapping the player's top-left corner by
+        // half a pixel while its shape misses (round shapes and the rounded corner leave a gap):
+        // every block passes the broadphase, so this is the worst case for the narrowphase
+        Game mixed;
+        mixed.kindMix[0] = mixed.kindMix[1] = mixed.kindMix[2] = 1;
+        InitGame(mixed, 1234, n, WeatherKind::SUNNY);
+        mixed.player.rect = mixed.player.prevRect = { 200.0f, 200.0f, 36.0f, 36.0f };
+        ForEachEnemyKind([&](auto k) {
+            using K = decltype(k);
+            EnemyBucket &b = mixed.enemies.kinds[K::KIND];
+            for (int i = 0; i < b.count; ++i) {
+                EnemyBlock e = { SplatF32x4(0.0f), SplatF32x4(0.0f), SplatF32x4(b.w[i]), SplatF32x4(b.h[i]), SplatF32x4(0.0f) };
+                EnemyBlock box = EnemyBounds<K>(e);
+                b.x[i] = mixed.player.rect.x + 0.5f - box.w[0] - box.x[0];
+                b.y[i] = mixed.player.rect.y + 0.5f - box.h[0] - box.y[0];
+            }
+        });
+        if (PlayerHit(mixed.player, mixed.enemies, dt)) fprintf(stderr, "PlayerHitNarrow: setup overlaps the player\n");
+
+        snprintf(name, sizeof(name), "PlayerHitNarrow/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                bool hit = PlayerHit(mixed.player, mixed.enemies, dt);
+                DoNotOptimize(hit);
+            }
+        });
+
+        if (PlayerHitFixed(mixed.player, mixed.enemies, dt)) fprintf(stderr, "PlayerHitNarrowFixed: setup overlaps the player\n");
+        snprintf(name, sizeof(name), "PlayerHitNarrowFixed/%d", n);
+        RunBench(name, n, [&](long iters) {
+            for (long i = 0; i < iters; ++i) {
+                bool hit = PlayerHitFixed(mixed.player, mixed.enemies, dt);
+                DoNotOptimize(hit);
+            }
+        });
+
+        // One bot decision (9 moves over the default horizon) on a fresh mixed-kind run
+        if (n <= 1000) {
+            Game play;
+            play.kindMix[0] = play.kindMix[1] = play.kindMix[2] = 1;
+            InitGame(play, 1234, n, WeatherKind::SUNNY);
+            Bot bot;
+            BotDecide(bot, play);
+
+            snprintf(name, sizeof(name), "BotDecide/%d", n);
+            RunBench(name, n, [&](long iters) {
+                for (long i = 0; i < iters; ++i) {
+                    unsigned char keys = BotDecide(bot, play);
+                    DoNotOptimize(keys);
+                }
+            });
+
+            // The same run's PLAYING frame rasterized at an agent's and at the window's size
+            play.state = GameState::PLAYING;
+            const int sizes[2][2] = { { 84, 84 }, { SCREEN_W, SCREEN_H } };
+            for (const int *size : sizes) {
+                std::vector<unsigned char> pixels((size_t)size[0]*size[1]);
+                RasterTarget target = MakeRasterTarget(pixels.data(), size[0], size[1]);
+                snprintf(name, sizeof(name), "RasterGame/%dx%d/%d", size[0], size[1], n);
+                RunBench(name, n, [&](long iters) {
+                    for (long i = 0; i < iters; ++i) {
+                        RasterGame(play, target);
+                        DoNotOptimize(pixels.data());
+                    }
+                });
+            }
+        }
+    }
+
+    // HUD text exactly as drawn while PLAYING (TextFormat uses raylib's static buffers)
+    RunBench("HudTextFormat", 0, [&](long iters) {
+        for (long i = 0; i < iters; ++i) {
+            const char *a = TextFormat("Score: %d", (int)i);
+            const char *b = TextFormat("London weather: %s", "Cloudy");
+            DoNotOptimize(a);
+            DoNotOptimize(b);
+        }
+    });
+
+    if (gOpt.jsonPath) WriteJson(gOpt.jsonPath);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************************
+* bot.h - lookahead bot: plays "Dodge!" by simulating every move before making one
+*
+*   Each decision saves the live Game (snapshot.h), restores it into a scratch Game and
+*   simulates 'horizon' seconds ahead. Enemies never react to the player, so their future
+*   is simulated once and kept per rollout step; then each of the 9 key combinations (stand
+*   still + 8 directions) is held over that future, moving only the player and testing the
+*   collision. The move that survives longest wins; ties go to the move ending nearest the
+*   bottom-centre "home" spot, with a bonus for keeping the current move so the bot does
+*   not jitter.
+*
+*   - Rollouts run the real update code (UpdatePlayer/FallEnemies/PlayerHit) at a coarse
+*     'stepDt'; the swept collision keeps the coarse steps from skipping hits
+*   - The scratch Game, the snapshot and the enemy frames are reused, so deciding never
+*     allocates once warm
+*   - Rollouts see the enemies the RNG will spawn, so at a fixed tick the bot plays the
+*     actual future; with a variable frame time it is a close approximation
+*   - Users: main.cpp's attract mode on the MENU, tools/soak.cpp (headless soak test)
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include "snapshot.h"
+#include <cmath>
+#include <vector>
+
+struct BotConfig {
+    float horizon = 0.6f;                     // seconds simulated per candidate move
+    float stepDt = 1.0f/20.0f;                // rollout tick
+    int replanEvery = 1;                      // decide every N ticks, hold the move in between
+    float stickiness = 24.0f;                 // tie-break bonus (pixels) for keeping the current move
+};
+
+struct Bot {
+    BotConfig cfg;
+    unsigned char keys = 0;                   // move being held
+    int holdTicks = 0;                        // ticks left before the next decision
+    GameSnapshot root;                        // the live game at the decision
+    Game scratch;                             // restored from 'root', runs the enemies ahead
+    std::vector<EnemyPool> future;            // enemies after each rollout step
+    long rolloutSteps = 0;                    // player moves tested against a future step (stats)
+};
+
+// -----------------------------------------------------------------------------------------
+// One PLAYING tick with the held keys: StepGame()'s PLAYING branch without the profiler and
+// trace hooks and without the state change. True if the player was hit (even if invincible).
+// -----------------------------------------------------------------------------------------
+inline bool BotSimTick(Game &game, unsigned char keys, float dt)
+{
+    UpdatePlayer(game.player, KeysToMove(keys), dt);
+    UpdateDifficulty(game);
+    FallEnemies(game, dt);
+    bool hit = PlayerHit(game.player, game.enemies, dt);
+    RecycleEnemies(game);
+    game.score += 60.0f*dt;
+    return hit;
+}
+
+// Where the bot drifts when nothing threatens it: centred, low enough to see what falls
+inline float BotHomeDistance(const Player &player)
+{
+    float dx = player.rect.x + player.rect.width*0.5f - SCREEN_W*0.5f;
+    float dy = player.rect.y + player.rect.height*0.5f - SCREEN_H*0.7f;
+    return sqrtf(dx*dx + dy*dy);
+}
+
+// -----------------------------------------------------------------------------------------
+// Pick the move for the next tick of a PLAYING game
+// -----------------------------------------------------------------------------------------
+inline unsigned char BotDecide(Bot &bot, const Game &game)
+{
+    const BotConfig &cfg = bot.cfg;
+    int steps = (int)(cfg.horizon/cfg.stepDt + 0.5f);
+    if (steps < 1) steps = 1;
+    if ((int)bot.future.size() < steps) bot.future.resize(steps);
+
+    // The enemies' future: the same for every move (StepGame's order without the player)
+    SaveGameSnapshot(game, bot.root);
+    LoadGameSnapshot(bot.scratch, bot.root);
+    for (int t = 0; t < steps; ++t) {
+        UpdateDifficulty(bot.scratch);
+        FallEnemies(bot.scratch, cfg.stepDt);
+        EnemyPoolCopy(bot.future[t], bot.scratch.enemies);   // before the recycle, as PlayerHit sees it in StepGame
+        RecycleEnemies(bot.scratch);
+        bot.scratch.score += 60.0f*cfg.stepDt;
+    }
+
+    unsigned char bestKeys = bot.keys;
+    float bestValue = -1.0e30f;
+    for (int m = 0; m < MOVE_COUNT; ++m) {
+        unsigned char keys = MOVE_KEYS[m];
+        Vector2 move = KeysToMove(keys);
+        Player player = game.player;
+
+        int survived = steps;
+        for (int t = 0; t < steps; ++t) {
+            UpdatePlayer(player, move, cfg.stepDt);
+            if (PlayerHit(player, bot.future[t], cfg.stepDt)) { survived = t; break; }
+        }
+        bot.rolloutSteps += (survived < steps) ? survived + 1 : steps;
+
+        // Survival dominates; distance from home (at most ~500 px) only breaks ties
+        float value = survived*1000.0f - BotHomeDistance(player);
+        if (keys == bot.keys) value += cfg.stickiness;
+        if (value > bestValue) { bestValue = value; bestKeys = keys; }
+    }
+    return bestKeys;
+}
+
+// Keys for this tick: a fresh decision every replanEvery ticks while PLAYING, otherwise
+// START/RESTART so a soak run keeps playing
+inline unsigned char BotKeys(Bot &bot, const Game &game)
+{
+    if (game.state == GameState::MENU) return KEYS_START;
+    if (game.state == GameState::GAME_OVER) return KEYS_RESTART;
+
+    if (--bot.holdTicks <= 0) {
+        bot.keys = BotDecide(bot, game);
+        bot.holdTicks = bot.cfg.replanEvery;
+    }
+    return bot.keys;
+}
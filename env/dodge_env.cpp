@@ -0,0 +1,312 @@
+/*******************************************************************************************
+* dodge_env.cpp - implementation of the vector env C ABI (dodge_env.h)
+*
+*   - Each game is a Game from game.h stepped with StepGame(), so agents train on exactly
+*     what main() plays (same collision, difficulty curve, RNG)
+*   - Games are split into contiguous slices, one per thread; the caller's thread runs
+*     slice 0 and persistent workers run the rest, woken per call by a generation counter
+*   - Everything a step touches (games, nearest-k scratch) is allocated in create()
+*   - dodge_env_render() rasterizes the games (raster.h) on the same workers
+*******************************************************************************************/
+
+#include "dodge_env.h"
+#include "../game.h"
+#include "../raster.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int ENV_PLAYER_FLOATS = 4;
+
+// One candidate of a game's nearest-k list
+struct EnvNearest {
+    float dist2;
+    int kind, index;
+};
+
+struct DodgeEnv {
+    DodgeEnvConfig cfg;
+    int obsSize;
+
+    std::vector<Game> games;
+    std::vector<unsigned long long> seeds;    // seed of each game's current episode
+    std::vector<int> ticks;                   // ticks into each game's current episode
+    std::vector<unsigned char> pendingReset;  // done last step: reset before the next one
+    std::vector<EnvNearest> nearest;          // nearest_k scratch per game
+
+    // Arguments of the call being run (read by the workers)
+    void (*job)(DodgeEnv &env, int first, int last);
+    const uint64_t *resetSeeds;
+    const uint8_t *actions;
+    float *obs, *rewards;
+    uint8_t *dones;
+    uint8_t *frames;
+    int frameWidth, frameHeight;
+
+    // Workers 1..num_threads-1 (the caller is worker 0)
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake, finished;
+    unsigned long generation = 0;
+    int busy = 0;
+    bool quit = false;
+};
+
+// -----------------------------------------------------------------------------------------
+// Episodes
+// -----------------------------------------------------------------------------------------
+
+// Next seed of a game's own sequence (splitmix64), so auto-resets are reproducible
+static unsigned long long EnvNextSeed(unsigned long long seed)
+{
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static void EnvStartEpisode(DodgeEnv &env, int i, unsigned long long seed)
+{
+    const DodgeEnvConfig &cfg = env.cfg;
+    int weather = (cfg.weather >= 0 && cfg.weather <= 2) ? cfg.weather : (int)(seed % 3);
+    Game &game = env.games[i];
+    InitGame(game, seed, cfg.enemy_count, (WeatherKind)weather);
+
+    GameInput in{};
+    in.keys = KEYS_START;                     // MENU -> PLAYING, as when a player presses SPACE
+    in.weather = -1;
+    in.dt = cfg.dt;
+    StepGame(game, in);
+
+    env.seeds[i] = seed;
+    env.ticks[i] = 0;
+    env.pendingReset[i] = 0;
+}
+
+// -----------------------------------------------------------------------------------------
+// Observation of game i into obs[i*obsSize ...]
+// -----------------------------------------------------------------------------------------
+static void EnvWriteObs(DodgeEnv &env, int i)
+{
+    const Game &game = env.games[i];
+    const Rectangle &r = game.player.rect;
+    float *o = env.obs + (size_t)i*env.obsSize;
+    const float sx = 1.0f/SCREEN_W, sy = 1.0f/SCREEN_H;
+
+    o[0] = r.x*sx; o[1] = r.y*sy; o[2] = r.width*sx; o[3] = r.height*sy;
+
+    // Nearest k by distance from the player centre to the enemy rect (insertion, k is small)
+    const int k = env.cfg.nearest_k;
+    EnvNearest *best = env.nearest.data() + (size_t)i*k;
+    int found = 0;
+    float px = r.x + r.width*0.5f, py = r.y + r.height*0.5f;
+    for (int kind = 0; kind < ENEMY_KIND_COUNT && k > 0; ++kind) {
+        const EnemyBucket &b = game.enemies.kinds[kind];
+        for (int e = 0; e < b.count; ++e) {
+            float dx = fabsf(b.x[e] + b.w[e]*0.5f - px) - b.w[e]*0.5f;
+            float dy = fabsf(b.y[e] + b.h[e]*0.5f - py) - b.h[e]*0.5f;
+            dx = (dx > 0.0f) ? dx : 0.0f;
+            dy = (dy > 0.0f) ? dy : 0.0f;
+            float d2 = dx*dx + dy*dy;
+            if (found == k && d2 >= best[k - 1].dist2) continue;
+
+            int j = (found < k) ? found++ : k - 1;
+            while (j > 0 && best[j - 1].dist2 > d2) { best[j] = best[j - 1]; --j; }
+            best[j] = EnvNearest{ d2, kind, e };
+        }
+    }
+
+    float *enemy = o + ENV_PLAYER_FLOATS;
+    for (int n = 0; n < k; ++n, enemy += DODGE_ENV_FLOATS_PER_ENEMY) {
+        if (n >= found) {
+            for (int f = 0; f < DODGE_ENV_FLOATS_PER_ENEMY; ++f) enemy[f] = 0.0f;
+            continue;
+        }
+        const EnemyBucket &b = game.enemies.kinds[best[n].kind];
+        int e = best[n].index;
+        enemy[0] = (b.x[e] + b.w[e]*0.5f - px)*sx;
+        enemy[1] = (b.y[e] + b.h[e]*0.5f - py)*sy;
+        enemy[2] = b.w[e]*sx;
+        enemy[3] = b.h[e]*sy;
+        enemy[4] = b.speedY[e]*sy;
+        enemy[5] = (float)best[n].kind;
+        enemy[6] = 1.0f;
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+// Jobs (run on a slice [first, last) of the games)
+// -----------------------------------------------------------------------------------------
+static void EnvResetJob(DodgeEnv &env, int first, int last)
+{
+    for (int i = first; i < last; ++i) {
+        EnvStartEpisode(env, i, env.resetSeeds[i]);
+        EnvWriteObs(env, i);
+    }
+}
+
+static void EnvStepJob(DodgeEnv &env, int first, int last)
+{
+    const DodgeEnvConfig &cfg = env.cfg;
+    for (int i = first; i < last; ++i) {
+        if (env.pendingReset[i]) EnvStartEpisode(env, i, EnvNextSeed(env.seeds[i]));
+
+        Game &game = env.games[i];
+        GameInput in{};
+        in.keys = (env.actions[i] < MOVE_COUNT) ? MOVE_KEYS[env.actions[i]] : 0;
+        in.weather = -1;
+        in.dt = cfg.dt;
+
+        float before = game.score;
+        uint8_t done = DODGE_ENV_RUNNING;
+        for (int f = 0; f < cfg.frame_skip; ++f) {
+            StepGame(game, in);
+            env.ticks[i]++;
+            if (game.state != GameState::PLAYING) { done = DODGE_ENV_DIED; break; }
+            if (cfg.max_ticks > 0 && env.ticks[i] >= cfg.max_ticks) { done = DODGE_ENV_TRUNCATED; break; }
+        }
+
+        env.rewards[i] = (game.score - before)/60.0f - ((done == DODGE_ENV_DIED) ? cfg.death_penalty : 0.0f);
+        env.dones[i] = done;
+        env.pendingReset[i] = (done != DODGE_ENV_RUNNING);
+        EnvWriteObs(env, i);
+    }
+}
+
+static void EnvRenderJob(DodgeEnv &env, int first, int last)
+{
+    size_t frameSize = (size_t)env.frameWidth*env.frameHeight;
+    RasterGameBatch(env.games.data() + first, last - first, env.frames + first*frameSize, env.frameWidth, env.frameHeight);
+}
+
+// -----------------------------------------------------------------------------------------
+// Thread pool: slice t of N games is [t*N/T, (t+1)*N/T)
+// -----------------------------------------------------------------------------------------
+static void EnvRunSlice(DodgeEnv &env, int t)
+{
+    int n = env.cfg.num_envs, threads = (int)env.workers.size() + 1;
+    env.job(env, (int)((long long)t*n/threads), (int)((long long)(t + 1)*n/threads));
+}
+
+static void EnvWorker(DodgeEnv *env, int t)
+{
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(env->lock);
+            env->wake.wait(guard, [&] { return env->quit || env->generation != seen; });
+            if (env->quit) return;
+            seen = env->generation;
+        }
+        EnvRunSlice(*env, t);
+
+        std::lock_guard<std::mutex> guard(env->lock);
+        if (--env->busy == 0) env->finished.notify_one();
+    }
+}
+
+static void EnvRunParallel(DodgeEnv &env, void (*job)(DodgeEnv &, int, int))
+{
+    env.job = job;
+    if (env.workers.empty()) { EnvRunSlice(env, 0); return; }
+
+    {
+        std::lock_guard<std::mutex> guard(env.lock);
+        env.busy = (int)env.workers.size();
+        env.generation++;
+    }
+    env.wake.notify_all();
+    EnvRunSlice(env, 0);
+
+    std::unique_lock<std::mutex> guard(env.lock);
+    env.finished.wait(guard, [&] { return env.busy == 0; });
+}
+
+// -----------------------------------------------------------------------------------------
+// C ABI
+// -----------------------------------------------------------------------------------------
+extern "C" {
+
+DODGE_ENV_API DodgeEnvConfig dodge_env_default_config(void)
+{
+    DodgeEnvConfig cfg;
+    cfg.num_envs = 1;
+    cfg.num_threads = 1;
+    cfg.nearest_k = 8;
+    cfg.enemy_count = 10;
+    cfg.weather = -1;
+    cfg.frame_skip = 1;
+    cfg.max_ticks = 0;
+    cfg.dt = 1.0f/60.0f;
+    cfg.death_penalty = 1.0f;
+    return cfg;
+}
+
+DODGE_ENV_API DodgeEnv *dodge_env_create(const DodgeEnvConfig *config)
+{
+    if (!config || config->num_envs < 1 || config->nearest_k < 0 || config->frame_skip < 1 ||
+        !(config->dt > 0.0f) || config->enemy_count < 0) return nullptr;
+
+    DodgeEnv *env = new DodgeEnv();
+    env->cfg = *config;
+    env->obsSize = ENV_PLAYER_FLOATS + DODGE_ENV_FLOATS_PER_ENEMY*config->nearest_k;
+
+    int n = config->num_envs;
+    env->games.resize(n);
+    env->seeds.assign(n, 0);
+    env->ticks.assign(n, 0);
+    env->pendingReset.assign(n, 0);
+    env->nearest.resize((size_t)n*config->nearest_k);
+    for (int i = 0; i < n; ++i) EnvStartEpisode(*env, i, EnvNextSeed((unsigned long long)i));   // pools reserved now
+
+    int threads = config->num_threads;
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    if (threads > n) threads = n;
+    env->cfg.num_threads = threads;
+    for (int t = 1; t < threads; ++t) env->workers.emplace_back(EnvWorker, env, t);
+    return env;
+}
+
+DODGE_ENV_API void dodge_env_destroy(DodgeEnv *env)
+{
+    if (!env) return;
+    {
+        std::lock_guard<std::mutex> guard(env->lock);
+        env->quit = true;
+    }
+    env->wake.notify_all();
+    for (std::thread &w : env->workers) w.join();
+    delete env;
+}
+
+DODGE_ENV_API int dodge_env_num_envs(const DodgeEnv *env) { return env->cfg.num_envs; }
+DODGE_ENV_API int dodge_env_obs_size(const DodgeEnv *env) { return env->obsSize; }
+
+DODGE_ENV_API void dodge_env_reset(DodgeEnv *env, const uint64_t *seeds, float *obs)
+{
+    env->resetSeeds = seeds;
+    env->obs = obs;
+    EnvRunParallel(*env, EnvResetJob);
+}
+
+DODGE_ENV_API void dodge_env_step(DodgeEnv *env, const uint8_t *actions, float *obs, float *rewards, uint8_t *dones)
+{
+    env->actions = actions;
+    env->obs = obs;
+    env->rewards = rewards;
+    env->dones = dones;
+    EnvRunParallel(*env, EnvStepJob);
+}
+
+DODGE_ENV_API void dodge_env_render(DodgeEnv *env, uint8_t *frames, int width, int height)
+{
+    if (width < 1 || height < 1) return;
+    env->frames = frames;
+    env->frameWidth = width;
+    env->frameHeight = height;
+    EnvRunParallel(*env, EnvRenderJob);
+}
+
+} // extern "C"
@@ -0,0 +1,87 @@
+/*******************************************************************************************
+* dodge_env.h - C ABI "vector env" over the Dodge! simulation (for training agents)
+*
+*   N independent games stepped together, each the exact game (StepGame() from game.h) with
+*   its own seed. All data goes through caller-owned contiguous buffers:
+*
+*     obs      float[N * dodge_env_obs_size()]   see the layout below
+*     actions  uint8 [N]      0 still, 1 left, 2 right, 3 up, 4 down, 5 up-left, 6 up-right,
+*                             7 down-left, 8 down-right (MOVE_KEYS in game.h)
+*     rewards  float[N]       seconds survived this step, minus death_penalty on death
+*     dones    uint8 [N]      0 running, DODGE_ENV_DIED, DODGE_ENV_TRUNCATED (max_ticks)
+*
+*   Observation of one game (positions/sizes divided by the screen size, speeds by the
+*   screen height per second, so values are roughly within [-1, 1]):
+*     player  x, y, w, h
+*     nearest_k enemies, nearest first (distance from the player centre to the enemy rect):
+*             dx, dy (enemy centre - player centre), w, h, speed_y, kind (0 sun, 1 cloud,
+*             2 rain), present (1, or 0 with the rest zeroed when fewer enemies are live)
+*
+*   Pixel observations: dodge_env_render() draws every game (raster.h: the scene main.cpp
+*   draws, as 8-bit luminance, no text) into frames[N][height][width], e.g. 84x84.
+*
+*   - A game that is done is reset automatically at the start of its next step, with the
+*     next seed of its own sequence, so the obs returned with done != 0 is the final one
+*   - Steps never allocate; games are split over num_threads persistent workers and the
+*     results do not depend on the thread count
+*
+* BUILD (shared library; only raylib's header is needed, not the library)
+*   g++ -std=c++17 -O2 -shared -fPIC -fvisibility=hidden -I ~/raylib/src env/dodge_env.cpp -o libdodge_env.so -lpthread
+*******************************************************************************************/
+
+#ifndef DODGE_ENV_H
+#define DODGE_ENV_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+  #define DODGE_ENV_API __declspec(dllexport)
+#else
+  #define DODGE_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { DODGE_ENV_RUNNING = 0, DODGE_ENV_DIED = 1, DODGE_ENV_TRUNCATED = 2 };
+enum { DODGE_ENV_ACTIONS = 9, DODGE_ENV_FLOATS_PER_ENEMY = 7 };
+
+typedef struct DodgeEnvConfig {
+    int num_envs;             // games stepped together (N)
+    int num_threads;          // worker threads including the caller's (0 = hardware concurrency)
+    int nearest_k;            // enemies per observation
+    int enemy_count;          // enemies a run starts with (the difficulty curve adds more)
+    int weather;              // 0 sunny, 1 cloudy, 2 rainy, -1 = picked from each episode's seed
+    int frame_skip;           // ticks per step, the action held for all of them
+    int max_ticks;            // truncate an episode after this many ticks (0 = never)
+    float dt;                 // tick length in seconds
+    float death_penalty;      // subtracted from the reward of the step that ends in a hit
+} DodgeEnvConfig;
+
+typedef struct DodgeEnv DodgeEnv;
+
+// Defaults: 1 env, 1 thread, 8 nearest, 10 enemies, weather from seed, 1 tick of 1/60 s, penalty 1
+DODGE_ENV_API DodgeEnvConfig dodge_env_default_config(void);
+
+// NULL if the config is invalid (num_envs < 1, nearest_k < 0, frame_skip < 1, dt <= 0)
+DODGE_ENV_API DodgeEnv *dodge_env_create(const DodgeEnvConfig *config);
+DODGE_ENV_API void dodge_env_destroy(DodgeEnv *env);
+
+DODGE_ENV_API int dodge_env_num_envs(const DodgeEnv *env);
+DODGE_ENV_API int dodge_env_obs_size(const DodgeEnv *env);    // floats per game: 4 + 7*nearest_k
+
+// Start every game from seeds[N] (each game's later episodes derive their seeds from it)
+DODGE_ENV_API void dodge_env_reset(DodgeEnv *env, const uint64_t *seeds, float *obs);
+
+// One step of every game; an action outside [0, 9) counts as 0 (still)
+DODGE_ENV_API void dodge_env_step(DodgeEnv *env, const uint8_t *actions, float *obs, float *rewards, uint8_t *dones);
+
+// Current frame of every game into frames[N * height * width] (any size, e.g. 84x84 or 800x450)
+DODGE_ENV_API void dodge_env_render(DodgeEnv *env, uint8_t *frames, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DODGE_ENV_H
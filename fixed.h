@@ -0,0 +1,114 @@
+/*******************************************************************************************
+* fixed.h - fixed-point numbers and integer geometry for the deterministic sim path
+*
+*   With Game::fixedPoint set, every value a tick computes is an exact integer on a fixed
+*   grid (game.h), except a long run's score (below), so every compiler and target (x86,
+*   ARM, wasm) produces the same bits.
+*   Floats are only deterministic when each operation is rounded the same way; a compiler
+*   may fuse a*b + c into one FMA (GCC does by default on ARM), and that changes the result
+*   unless nothing needs rounding.
+*
+*   - Values stay in the Game's float fields, on a grid every float holds exactly:
+*       positions, sizes   Q12 (1/4096 px), |v| < 4096 px
+*       speeds             whole px/s, at most FIXED_MAX_SPEED
+*       dt                 Q12 (1/4096 s), at most FIXED_MAX_DT
+*       score              Q10 (1/1024 point), exact below 16384 points (2^24 / 1024,
+*                          about 4.5 minutes of play); above that each tick's add rounds
+*     Converting such a float to its integer and back is exact, so drawing, snapshots,
+*     replays and the spectator stream work unchanged
+*   - Distance per tick: speed * dt is Q12 and under 2^23 (4095 * 2048), y + speed*dt
+*     under 2^24: both exact in a float, fused or not. So the enemy kernel is the float
+*     kernel, as fast, on integers held in float lanes (an I32x4 multiply is emulated on
+*     SSE2 and measured 2.5x slower)
+*   - The score past 16384 points is still the same everywhere: its add is one correctly
+*     rounded operation, and the Q10 increment is exact, so fusing it into an FMA changes
+*     nothing. The difficulty only reads its integer part
+*   - Narrowphase in 1/16 px (FIXED_NARROW_ONE) with 64-bit products: exact while shapes and
+*     one tick's movement stay under 2048 px
+*******************************************************************************************/
+
+#pragma once
+
+static const float FIXED_POS_ONE = 4096.0f;          // Q12
+static const float FIXED_SPEED_ONE = 1.0f;           // whole px/s
+static const float FIXED_DT_ONE = 4096.0f;           // Q12
+static const float FIXED_SCORE_ONE = 1024.0f;        // Q10
+static const float FIXED_SCALE_ONE = 65536.0f;       // Q16 (difficulty speed scale)
+static const float FIXED_NARROW_ONE = 16.0f;         // narrowphase lengths
+static const int   FIXED_NARROW_SHIFT = 12 - 4;      // Q12 -> narrowphase
+static const int   FIXED_MAX_DT = 2048;              // 0.5 s: a longer tick counts as 0.5 s
+static const float FIXED_MAX_SPEED = 4095.0f;        // px/s, spawn speeds are clamped to it
+static const int   FIXED_INV_SQRT2 = 46341;          // 1/sqrt(2) in Q16 (diagonal moves)
+
+// dt in Q12, truncated and clamped (dt*4096 is exact, the cast truncates the same everywhere)
+inline int FixedDt(float dt)
+{
+    if (!(dt > 0.0f)) return 0;
+    if (dt >= FIXED_MAX_DT/FIXED_DT_ONE) return FIXED_MAX_DT;
+    return (int)(dt*FIXED_DT_ONE);
+}
+
+// A float on the grid <-> its integer (exact both ways; off-grid floats are truncated)
+inline int FixedFromFloat(float v, float one) { return (int)(v*one); }
+inline float FixedToFloat(long long q, float one) { return (float)q*(1.0f/one); }
+
+// Distance covered in one tick, Q12, from a speed as stored (a whole number of px/s)
+inline int FixedStep(float speed, int dtq)
+{
+    return FixedFromFloat(speed, FIXED_SPEED_ONE)*dtq;
+}
+
+// Narrowphase length (1/16 px) of a grid float; products of floats are rounded the same
+// everywhere (only a product feeding an add can be fused), so v may be w*CLOUD_RADIUS etc.
+inline long long FixedNarrow(float v) { return (long long)(v*FIXED_NARROW_ONE); }
+
+// -----------------------------------------------------------------------------------------
+// Swept tests in integers: the point s + t*d (t in [0, 1]) against shapes centred on the
+// origin, exactly as the float versions in game.h but with t kept as a fraction
+// -----------------------------------------------------------------------------------------
+struct FixedFrac {
+    long long num, den;                 // den > 0
+};
+
+inline bool FixedFracLess(FixedFrac a, FixedFrac b) { return a.num*b.den < b.num*a.den; }
+
+// Clips [t0, t1] to the part of the segment inside -e < s + t*d < e; false if never inside
+inline bool FixedClipToSlab(long long s, long long d, long long e, FixedFrac &t0, FixedFrac &t1)
+{
+    if (d == 0) return s > -e && s < e;     // inside for the whole tick, or never
+    FixedFrac lo = { -e - s, d }, hi = { e - s, d };
+    if (d < 0) { lo = { s - e, -d }; hi = { s + e, -d }; }   // the same two fractions, positive denominator
+    if (FixedFracLess(t0, lo)) t0 = lo;
+    if (FixedFracLess(hi, t1)) t1 = hi;
+    return true;
+}
+
+inline bool FixedSegmentHitsBox(long long sx, long long sy, long long dx, long long dy, long long ex, long long ey)
+{
+    FixedFrac t0 = { 0, 1 }, t1 = { 1, 1 };
+    return FixedClipToSlab(sx, dx, ex, t0, t1) && FixedClipToSlab(sy, dy, ey, t0, t1) && FixedFracLess(t0, t1);
+}
+
+// Segment from (fx, fy), relative to a circle's centre: its closest point inside the circle
+inline bool FixedSegmentHitsCircle(long long fx, long long fy, long long dx, long long dy, long long r)
+{
+    long long a = dx*dx + dy*dy, b = fx*dx + fy*dy, c = fx*fx + fy*fy - r*r;
+    if (a == 0 || b >= 0) return c < 0;                     // closest at t = 0
+    if (-b >= a) {                                          // closest at t = 1
+        long long ex = fx + dx, ey = fy + dy;
+        return ex*ex + ey*ey < r*r;
+    }
+    return a*c < b*b;                                       // |f + t*d|^2 = c - b^2/a at t = -b/a
+}
+
+// Rounded rect with inner half extents (hw, hh) and corner radius r
+inline bool FixedSegmentHitsRoundedRect(long long sx, long long sy, long long dx, long long dy,
+                                        long long hw, long long hh, long long r)
+{
+    return FixedSegmentHitsBox(sx, sy, dx, dy, hw + r, hh) ||
+           FixedSegmentHitsBox(sx, sy, dx, dy, hw, hh + r) ||
+           FixedSegmentHitsCircle(sx + hw, sy + hh, dx, dy, r) ||
+           FixedSegmentHitsCircle(sx - hw, sy + hh, dx, dy, r) ||
+           FixedSegmentHitsCircle(sx + hw, sy - hh, dx, dy, r) ||
+           FixedSegmentHitsCircle(sx - hw, sy - hh, dx, dy, r);
+}
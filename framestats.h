@@ -0,0 +1,93 @@
+/*******************************************************************************************
+* framestats.h - session frame-time histogram for "Dodge!"
+*
+*   - FrameStatsAdd() records one frame (seconds, straight from GetFrameTime())
+*   - Percentiles (p50/p95/p99) come from a fixed 0.25 ms bucket histogram, so
+*     recording is O(1) and the memory cost is constant however long the session runs
+*   - A frame longer than 1.5 vsync intervals counts the extra intervals as missed vsyncs
+*
+* Always compiled in: one array increment per frame.
+*******************************************************************************************/
+
+#pragma once
+
+#include <cstdio>
+
+static const float FRAME_BUCKET_MS = 0.25f;   // histogram resolution
+static const int   FRAME_BUCKETS   = 400;     // 0..100 ms, anything slower lands in the last bucket
+
+struct FrameStats {
+    unsigned int histogram[FRAME_BUCKETS];
+    unsigned long frames;
+    unsigned long missedVsyncs;     // vsync intervals skipped over the session
+    double totalMs;
+    float maxMs;
+    float targetMs;                 // one vsync interval (1000 / target FPS)
+};
+
+static FrameStats gFrameStats = { {0}, 0, 0, 0.0, 0.0f, 1000.0f/60.0f };
+
+static void FrameStatsReset(int targetFps)
+{
+    gFrameStats = FrameStats{};
+    gFrameStats.targetMs = 1000.0f/(float)targetFps;
+}
+
+static void FrameStatsAdd(float frameTimeSec)
+{
+    FrameStats &s = gFrameStats;
+    float ms = frameTimeSec*1000.0f;
+    if (ms <= 0.0f) return;   // first frame reports 0
+
+    int bucket = (int)(ms/FRAME_BUCKET_MS);
+    if (bucket >= FRAME_BUCKETS) bucket = FRAME_BUCKETS - 1;
+    s.histogram[bucket]++;
+
+    s.frames++;
+    s.totalMs += ms;
+    if (ms > s.maxMs) s.maxMs = ms;
+
+    // e.g. a 33 ms frame at 60 FPS skipped one vsync, a 50 ms frame skipped two
+    if (ms > s.targetMs*1.5f) s.missedVsyncs += (unsigned long)(ms/s.targetMs + 0.5f) - 1;
+}
+
+// Upper edge (ms) of the bucket holding the given percentile (0..100)
+static float FrameStatsPercentile(float pct)
+{
+    const FrameStats &s = gFrameStats;
+    if (s.frames == 0) return 0.0f;
+
+    unsigned long rank = (unsigned long)(s.frames*(pct/100.0f));
+    if (rank >= s.frames) rank = s.frames - 1;
+
+    unsigned long seen = 0;
+    for (int i = 0; i < FRAME_BUCKETS; ++i) {
+        seen += s.histogram[i];
+        if (seen > rank) {
+            float edge = (i + 1)*FRAME_BUCKET_MS;
+            return (i == FRAME_BUCKETS - 1 || edge > s.maxMs) ? s.maxMs : edge;
+        }
+    }
+    return s.maxMs;
+}
+
+// JSON summary written into a caller-provided buffer (used by the JS bridge and on exit)
+static const char *FrameStatsJSON(char *buf, int size)
+{
+    const FrameStats &s = gFrameStats;
+    snprintf(buf, size,
+             "{\"frames\":%lu,\"avg_ms\":%.3f,\"p50_ms\":%.2f,\"p95_ms\":%.2f,\"p99_ms\":%.2f,"
+             "\"max_ms\":%.2f,\"missed_vsyncs\":%lu}",
+             s.frames, s.frames ? s.totalMs/s.frames : 0.0,
+             FrameStatsPercentile(50.0f), FrameStatsPercentile(95.0f), FrameStatsPercentile(99.0f),
+             s.maxMs, s.missedVsyncs);
+    return buf;
+}
+
+static void FrameStatsPrint()
+{
+    const FrameStats &s = gFrameStats;
+    printf("Frame times over %lu frames: p50 %.2f ms | p95 %.2f ms | p99 %.2f ms | max %.2f ms | missed vsyncs %lu\n",
+           s.frames, FrameStatsPercentile(50.0f), FrameStatsPercentile(95.0f),
+           FrameStatsPercentile(99.0f), s.maxMs, s.missedVsyncs);
+}
@@ -0,0 +1,1038 @@
+/*******************************************************************************************
+* game.h - "Dodge!" simulation (no window, no drawing)
+*
+*   - Data types shared by the game, the benchmark and the headless tools
+*   - Game holds everything a run needs (state, player, enemies, score, weather, RNG), so
+*     a run is fully reproducible from its seed plus the per-tick GameInput stream
+*   - StepGame() is one tick of the update loop; main() and the headless tools both use it
+*   - Enemies live in a fixed-capacity pool, bucketed by kind (sun/cloud/rain) as
+*     structure-of-arrays; a difficulty curve grows the live count and speeds with the score
+*   - Per-kind code (spawn, update, and the draw code in main.cpp) is a template over a
+*     kind traits struct, so the hot loops never test the kind of an enemy
+*   - Collision tests the drawn shapes (rounded-rect player vs circles, cloud circles, rain
+*     rects) swept over the tick, after a bounding-box broadphase, 4 enemies per SIMD vector (simd.h)
+*   - Enemy sizes and speeds come from Game::profiles (defaults below, tuning.h loads and
+*     hot-reloads them from enemy_profiles.txt)
+*   - Game::fixedPoint switches the tick to integer arithmetic (fixed.h): the same bits on
+*     every compiler and target, for replays recorded on one build and checked on another
+*   - Game::hashTicks fills Game::tickHash every tick, one hash per part of the state, for
+*     the desync detector (tickhash.h, tools/desync.cpp)
+*******************************************************************************************/
+
+#pragma once
+
+#include "raylib.h"
+#include "profiler.h"
+#include "simd.h"
+#include "fixed.h"
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// -----------------------------------------------------------------------------------------
+// Data types
+// -----------------------------------------------------------------------------------------
+
+// Weather decides which enemies spawn (set from JS through SetWeather() in main.cpp)
+enum class WeatherKind { SUNNY = 0, CLOUDY = 1, RAINY = 2 };
+
+// Player data: a rectangle for position/size and a movement speed in pixels/sec
+struct Player {
+    Rectangle rect;      // x, y, width, height
+    Rectangle prevRect;  // rect before this tick's move (swept collision)
+    float speed = 260.0f;
+};
+
+// --- : Enemy kinds (mirror WeatherKind). Each kind is a traits struct; the spawn/update/draw
+// kernels are templates over it. Tunable numbers live in EnemyProfile instead.
+static const int ENEMY_KIND_COUNT = 3;
+
+struct SunKind {                         // circles (the rect is the bounds), medium
+    static const int KIND = 0;
+    static const bool SQUARE = true;     // height = width (the profile's height range is unused)
+};
+
+struct CloudKind {                       // wider, slower puffs
+    static const int KIND = 1;
+    static const bool SQUARE = false;
+};
+
+struct RainKind {                        // thin, long drops
+    static const int KIND = 2;
+    static const bool SQUARE = false;
+};
+
+// Size and speed ranges of one kind (pixels, pixels/sec): speed = speedBase + [speedMin, speedMax]
+struct EnemyProfile {
+    int wMin, wMax;
+    int hMin, hMax;
+    float speedBase;
+    int speedMin, speedMax;
+};
+
+// One profile per kind, indexed by KIND. Plain data: copied into Game, so runs stay reproducible
+struct EnemyProfileTable {
+    EnemyProfile kinds[ENEMY_KIND_COUNT];
+};
+
+static const EnemyProfileTable DEFAULT_ENEMY_PROFILES = { {
+    { 18, 30, 18, 30, 140.0f, 20, 120 },   // sun
+    { 40, 72, 24, 40, 100.0f, 20,  80 },   // cloud
+    {  3,  6, 14, 24, 180.0f, 40, 180 },   // rain
+} };
+
+// Hot per-enemy loops work in blocks of this many floats (one F32x4, see simd.h). The update
+// loops are written as fixed-size inner loops, which the compiler vectorizes at -O2.
+static const int ENEMY_SIMD_WIDTH = SIMD_WIDTH;
+
+// Calls fn(SunKind{}), fn(CloudKind{}), fn(RainKind{}); use decltype(k) in a generic lambda
+template <typename Fn> inline void ForEachEnemyKind(Fn &&fn) {
+    fn(SunKind{});
+    fn(CloudKind{});
+    fn(RainKind{});
+}
+
+// Live enemies of one kind, structure-of-arrays so each field is a contiguous float run.
+// Slots [0, count) are live and [count, capacity) are free (stale values, never NaN);
+// capacity is a multiple of ENEMY_SIMD_WIDTH.
+struct EnemyBucket {
+    std::vector<float> x, y, w, h;
+    std::vector<float> speedY;
+    int count = 0;
+    float maxSpeedY = 0.0f;              // fastest speed given out since the last clear (collision broadphase)
+
+    int size() const { return count; }
+    int capacity() const { return (int)x.size(); }
+};
+
+// Fixed-capacity enemy storage, one bucket per kind. Activating takes the first free slot
+// of a bucket, deactivating swaps that bucket's last live enemy into the hole. Both are
+// O(1), live enemies stay contiguous for the update/draw loops, and the storage only grows
+// in EnemyPoolReserve() (never mid-run). Every bucket can hold the whole capacity, since
+// the weather can make all enemies the same kind.
+struct EnemyPool {
+    EnemyBucket kinds[ENEMY_KIND_COUNT];
+    int count = 0;                       // live enemies across all kinds
+    int limit = 0;                       // most live enemies allowed across all kinds
+    int peak = 0;                        // most enemies live at once since the pool was created
+
+    int size() const { return count; }
+    int capacity() const { return limit; }
+};
+
+// Simple game-state enum to control which screen/logic is active
+enum class GameState { MENU, PLAYING, GAME_OVER };
+static const char *const STATE_NAMES[] = { "MENU", "PLAYING", "GAME_OVER" };
+
+// Simulation-owned random numbers (xorshift64*), so runs replay identically on any build
+struct GameRng {
+    unsigned long long state;
+};
+
+// Per-tick state hashes (Game::hashTicks): one per part of the state, so two runs that
+// diverge can be told where. Enemies are hashed incrementally, so the cost does not grow
+// with their number:
+//   - which slots were written outside the fall (spawn, recycle, deactivation), in order;
+//     what went there comes from the RNG and the speed scale, hashed with the rest
+//   - the fallen y of TICK_HASH_WINDOW enemies per bucket, a different window each tick
+//     (picked from Game::ticks, so a run resumed from a save state hashes the same ones);
+//     with more enemies than that, a y that drifts on its own shows up to
+//     count/TICK_HASH_WINDOW ticks late (100 at 100k), but nothing else can change an enemy.
+//     TickHash::enemyWindows goes into the stream, so tools/desync.cpp can print that range
+enum TickHashField { TICK_HASH_PLAYER, TICK_HASH_ENEMIES, TICK_HASH_SCORE, TICK_HASH_RNG, TICK_HASH_FIELDS };
+static const char *const TICK_HASH_NAMES[TICK_HASH_FIELDS] = { "player", "enemies", "score", "rng" };
+static const unsigned long long TICK_HASH_SEED = 0x9E3779B97F4A7C15ull;
+static const int TICK_HASH_WINDOW = 1024;
+
+struct TickHash {
+    unsigned long long field[TICK_HASH_FIELDS];   // after the last StepGame
+    unsigned long long writeSum, writeSums;       // this tick's enemy slot writes so far
+    int enemyWindows;                             // ticks the windows take to cover every enemy (1: all)
+};
+
+inline unsigned long long HashMix(unsigned long long h, unsigned long long v) {
+    h ^= v*0xC2B2AE3D27D4EB4Full;
+    h = (h << 31) | (h >> 33);
+    return h*0x9E3779B97F4A7C15ull;
+}
+
+inline unsigned long long HashFloat(unsigned long long h, float f) {
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return HashMix(h, bits);
+}
+
+// Everything one run needs (a new field also goes into SnapshotHeader, snapshot.h)
+struct Game {
+    GameState state = GameState::MENU;
+    Player player{};
+    EnemyPool enemies;
+    float score = 0.0f;                  // current run score (seconds * 60)
+    int bestScore = 0;                   // best score across runs (integer)
+    int enemyCount = 10;                 // how many enemies a run starts with
+    int targetEnemies = 10;              // how many the difficulty curve wants right now
+    float speedScale = 1.0f;             // difficulty multiplier on new enemy speeds
+    bool difficultyRamp = true;          // off in stress mode (the ramp there is by frame time)
+    WeatherKind weather = WeatherKind::SUNNY;
+    GameRng rng{ 1 };
+    int kindMix[3] = { 0, 0, 0 };        // spawn weights sun/cloud/rain; all 0 = follow the weather
+    bool invincible = false;             // collisions are still tested but never end the run (stress mode)
+    bool fixedPoint = false;             // integer tick (fixed.h): bit-identical on every build
+    unsigned int ticks = 0;              // StepGame calls since InitGame (picks the tick hash's y windows)
+    bool hashTicks = false;              // fill tickHash every StepGame (tickhash.h records it)
+    TickHash tickHash = {};              // not saved: rebuilt from the state every tick
+    EnemyProfileTable profiles = DEFAULT_ENEMY_PROFILES;   // kept across InitGame/ResetGame
+};
+
+// Input for one tick (keyboard on desktop/web, recorded file in the headless tools)
+enum GameKeys {
+    KEYS_LEFT    = 1 << 0,
+    KEYS_RIGHT   = 1 << 1,
+    KEYS_UP      = 1 << 2,
+    KEYS_DOWN    = 1 << 3,
+    KEYS_START   = 1 << 4,   // SPACE/ENTER (menu)
+    KEYS_RESTART = 1 << 5,   // R (game over)
+    KEYS_MENU    = 1 << 6,   // ESC (game over)
+};
+
+// The 9 movement choices (stand still + 8 directions), for the bot and the training env
+static const int MOVE_COUNT = 9;
+static const unsigned char MOVE_KEYS[MOVE_COUNT] = {
+    0,
+    KEYS_LEFT, KEYS_RIGHT, KEYS_UP, KEYS_DOWN,
+    KEYS_LEFT | KEYS_UP, KEYS_RIGHT | KEYS_UP, KEYS_LEFT | KEYS_DOWN, KEYS_RIGHT | KEYS_DOWN,
+};
+
+struct GameInput {
+    unsigned char keys;      // GameKeys bits (held keys for movement, pressed keys for the rest)
+    signed char weather;     // -1 = unchanged, otherwise a WeatherKind
+    float dt;                // frame time in seconds
+};
+
+// -----------------------------------------------------------------------------------------
+// screen size
+// -----------------------------------------------------------------------------------------
+static const int SCREEN_W = 800;
+static const int SCREEN_H = 450;
+
+// -----------------------------------------------------------------------------------------
+// Difficulty curve: one extra enemy every 10 s of survival, speeds up to 1.8x at 100 s
+// -----------------------------------------------------------------------------------------
+static const int   DIFFICULTY_MAX_ENEMIES = 64;       // pool capacity for a normal run
+static const float DIFFICULTY_ENEMY_EVERY = 600.0f;   // score points per extra enemy
+static const float DIFFICULTY_SPEED_FULL  = 6000.0f;  // score at which speeds reach the max scale
+static const float DIFFICULTY_SPEED_MAX   = 1.8f;
+
+// -----------------------------------------------------------------------------------------
+// Enemy pool operations (all O(1) except Reserve, which is only called outside PLAYING)
+// -----------------------------------------------------------------------------------------
+inline void EnemyPoolReserve(EnemyPool &pool, int capacity) {
+    if (capacity <= pool.capacity()) return;
+    // Storage is rounded up to whole SIMD blocks, so the last partial block can be loaded as is
+    int padded = (capacity + ENEMY_SIMD_WIDTH - 1)/ENEMY_SIMD_WIDTH*ENEMY_SIMD_WIDTH;
+    for (EnemyBucket &b : pool.kinds) {
+        b.x.resize(padded); b.y.resize(padded);
+        b.w.resize(padded); b.h.resize(padded);
+        b.speedY.resize(padded);
+    }
+    pool.limit = capacity;
+}
+
+inline void EnemyPoolClear(EnemyPool &pool) {
+    for (EnemyBucket &b : pool.kinds) { b.count = 0; b.maxSpeedY = 0.0f; }
+    pool.count = 0;
+}
+
+// Slot index in the kind's bucket, -1 when the pool is full
+inline int EnemyPoolActivate(EnemyPool &pool, int kind) {
+    if (pool.count >= pool.limit) return -1;
+    if (++pool.count > pool.peak) pool.peak = pool.count;
+    return pool.kinds[kind].count++;
+}
+
+inline void EnemyPoolDeactivate(EnemyPool &pool, int kind, int index) {
+    EnemyBucket &b = pool.kinds[kind];
+    int last = --b.count;
+    b.x[index] = b.x[last]; b.y[index] = b.y[last];
+    b.w[index] = b.w[last]; b.h[index] = b.h[last];
+    b.speedY[index] = b.speedY[last];
+    pool.count--;
+}
+
+// Copy of the live enemies and counters only (dst keeps its storage, growing it if too small)
+inline void EnemyPoolCopy(EnemyPool &dst, const EnemyPool &src) {
+    EnemyPoolReserve(dst, src.limit);
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        const EnemyBucket &s = src.kinds[k];
+        EnemyBucket &d = dst.kinds[k];
+        size_t n = (size_t)s.count*sizeof(float);
+        memcpy(d.x.data(), s.x.data(), n); memcpy(d.y.data(), s.y.data(), n);
+        memcpy(d.w.data(), s.w.data(), n); memcpy(d.h.data(), s.h.data(), n);
+        memcpy(d.speedY.data(), s.speedY.data(), n);
+        d.count = s.count;
+        d.maxSpeedY = s.maxSpeedY;
+    }
+    dst.count = src.count;
+    dst.limit = src.limit;
+    dst.peak = src.peak;
+}
+
+// Peak live count and how much of the pool it used (printed on exit / by the tools)
+inline void PrintEnemyPoolStats(const EnemyPool &pool) {
+    int cap = pool.capacity();
+    printf("Enemy pool: capacity %d, live %d, peak %d (%.0f%% peak utilisation)\n",
+           cap, pool.count, pool.peak, cap ? 100.0*pool.peak/cap : 0.0);
+}
+
+// -----------------------------------------------------------------------------------------
+// Random numbers: same contract as raylib's GetRandomValue (inclusive, swaps if min > max)
+// -----------------------------------------------------------------------------------------
+inline void SeedRandom(GameRng &rng, unsigned long long seed) {
+    rng.state = seed ? seed : 0x9E3779B97F4A7C15ull;   // xorshift state must never be 0
+}
+
+inline int RandomValue(GameRng &rng, int min, int max) {
+    if (min > max) { int t = min; min = max; max = t; }
+    unsigned long long x = rng.state;
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    rng.state = x;
+    unsigned int r = (unsigned int)((x*0x2545F4914F6CDD1Dull) >> 32);
+    return min + (int)(r % (unsigned int)(max - min + 1));
+}
+
+// -----------------------------------------------------------------------------------------
+// Kind of the next enemy: the current weather, or a weighted pick when kindMix is set
+// -----------------------------------------------------------------------------------------
+inline int PickEnemyKind(Game &game) {
+    int total = game.kindMix[0] + game.kindMix[1] + game.kindMix[2];
+    if (total <= 0) return (int)game.weather;
+
+    int r = RandomValue(game.rng, 0, total - 1);
+    if (r < game.kindMix[0]) return 0;
+    if (r < game.kindMix[0] + game.kindMix[1]) return 1;
+    return 2;
+}
+
+// -----------------------------------------------------------------------------------------
+// Add one enemy of the given kind above the screen with a random size/speed
+// (false when the pool is full)
+// -----------------------------------------------------------------------------------------
+template <typename K> inline float RandomEnemySpeed(Game &game) {
+    const EnemyProfile &p = game.profiles.kinds[K::KIND];
+    if (game.fixedPoint) {
+        // Whole px/s times the Q16 scale, clamped so one tick's step stays exact
+        long long speed = FixedFromFloat(p.speedBase, FIXED_SPEED_ONE) +
+                          (long long)RandomValue(game.rng, p.speedMin, p.speedMax)*(int)FIXED_SPEED_ONE;
+        speed = (speed*FixedFromFloat(game.speedScale, FIXED_SCALE_ONE)) >> 16;
+        if (speed > (long long)(FIXED_MAX_SPEED*FIXED_SPEED_ONE)) speed = (long long)(FIXED_MAX_SPEED*FIXED_SPEED_ONE);
+        return FixedToFloat(speed, FIXED_SPEED_ONE);
+    }
+    return (p.speedBase + (float)RandomValue(game.rng, p.speedMin, p.speedMax))*game.speedScale;
+}
+
+// An enemy slot written outside the fall (spawn, recycle, deactivation), for the tick hash.
+// Only which slot goes in: what is written there comes from the RNG, the slot's size and the
+// speed scale, all hashed, and a y that drifts shows up in the y window. Slots go into a sum
+// and a sum of sums (so order counts) mixed once per tick; mixing x, y and speed in per slot
+// cost 1% of a 100k tick, against the few hundred recycles in it.
+inline void HashEnemyWrite(unsigned long long &sum, unsigned long long &sums, int kind, int i) {
+    sum += ((unsigned long long)kind << 24) | (unsigned)i;
+    sums += sum;
+}
+
+template <typename K> inline bool SpawnEnemyOfKind(Game &game) {
+    int i = EnemyPoolActivate(game.enemies, K::KIND);
+    if (i < 0) return false;
+
+    EnemyBucket &b = game.enemies.kinds[K::KIND];
+    const EnemyProfile &p = game.profiles.kinds[K::KIND];
+    GameRng &rng = game.rng;
+    b.x[i] = (float)RandomValue(rng, 0, SCREEN_W - 40);
+    b.y[i] = (float)RandomValue(rng, -SCREEN_H, -20);
+    b.w[i] = (float)RandomValue(rng, p.wMin, p.wMax);
+    b.h[i] = K::SQUARE ? b.w[i] : (float)RandomValue(rng, p.hMin, p.hMax);
+    b.speedY[i] = RandomEnemySpeed<K>(game);
+    if (b.speedY[i] > b.maxSpeedY) b.maxSpeedY = b.speedY[i];
+    if (game.hashTicks) HashEnemyWrite(game.tickHash.writeSum, game.tickHash.writeSums, K::KIND, i);
+    return true;
+}
+
+inline bool SpawnEnemy(Game &game, int kind) {
+    if (kind == RainKind::KIND) return SpawnEnemyOfKind<RainKind>(game);
+    if (kind == CloudKind::KIND) return SpawnEnemyOfKind<CloudKind>(game);
+    return SpawnEnemyOfKind<SunKind>(game);
+}
+
+// -----------------------------------------------------------------------------------------
+// Reset everything needed for a new run:
+//   - Centre player near bottom
+//   - Spawn enemies above the screen with random sizes/speeds
+//   - Reset score
+// -----------------------------------------------------------------------------------------
+inline void ResetGame(Game &game) {
+    TRACE_SCOPE("ResetGame");
+
+    // Player rectangle: centered horizontally, a bit above the bottom
+    game.player.rect = { SCREEN_W/2.0f - 18.0f, SCREEN_H - 70.0f, 36.0f, 36.0f };
+    game.player.prevRect = game.player.rect;
+
+    // Start with a clean enemy pool (capacity is kept, so only the first reset allocates)
+    EnemyPoolClear(game.enemies);
+    EnemyPoolReserve(game.enemies, (game.enemyCount > DIFFICULTY_MAX_ENEMIES) ? game.enemyCount : DIFFICULTY_MAX_ENEMIES);
+    game.targetEnemies = game.enemyCount;
+    game.speedScale = 1.0f;
+
+    // --- : spawn based on current weather kind (or the stress-mode mix)
+    for (int i = 0; i < game.enemyCount; ++i) SpawnEnemy(game, PickEnemyKind(game));
+
+    // Score is time-based (accumulates while you survive)
+    game.score = 0.0f;
+}
+
+// Fresh game at the MENU; the first run is reset here too so there is a baseline to draw
+inline void InitGame(Game &game, unsigned long long seed, int enemyCount, WeatherKind weather) {
+    game.state = GameState::MENU;
+    game.bestScore = 0;
+    game.ticks = 0;
+    game.enemyCount = enemyCount;
+    game.weather = weather;
+    SeedRandom(game.rng, seed);
+    ResetGame(game);
+}
+
+// State transitions go through here so they can be traced
+inline void ChangeState(Game &game, GameState next) {
+    game.state = next;
+    TraceInstant("state", "to", STATE_NAMES[(int)next]);
+}
+
+// Direction held by the LEFT/RIGHT/UP/DOWN bits (opposite keys cancel out)
+inline Vector2 KeysToMove(unsigned char keys) {
+    Vector2 move{0, 0};
+    if (keys & KEYS_RIGHT) move.x += 1;
+    if (keys & KEYS_LEFT)  move.x -= 1;
+    if (keys & KEYS_DOWN)  move.y += 1;
+    if (keys & KEYS_UP)    move.y -= 1;
+    return move;
+}
+
+// -----------------------------------------------------------------------------------------
+// Move the player by a direction (any length; diagonals are normalised) and clamp on screen
+// -----------------------------------------------------------------------------------------
+inline void UpdatePlayer(Player &player, Vector2 move, float dt) {
+    // Normalise diagonal movement so speed stays consistent in all directions
+    if (move.x != 0 || move.y != 0) {
+        float len = sqrtf(move.x*move.x + move.y*move.y);
+        move.x /= len;
+        move.y /= len;
+    }
+
+    // Move the player by (speed * deltaTime)
+    player.prevRect = player.rect;
+    player.rect.x += move.x * player.speed * dt;
+    player.rect.y += move.y * player.speed * dt;
+
+    // Keep player fully on screen (clamp)
+    if (player.rect.x < 0) player.rect.x = 0;
+    if (player.rect.y < 0) player.rect.y = 0;
+    if (player.rect.x + player.rect.width > SCREEN_W)
+        player.rect.x = SCREEN_W - player.rect.width;
+    if (player.rect.y + player.rect.height > SCREEN_H)
+        player.rect.y = SCREEN_H - player.rect.height;
+}
+
+// Fixed-point UpdatePlayer: each axis of `move` counts as -1, 0 or 1 (KeysToMove)
+inline void UpdatePlayerFixed(Player &player, Vector2 move, int dtq) {
+    int mx = (move.x > 0) - (move.x < 0), my = (move.y > 0) - (move.y < 0);
+    int step = FixedStep(player.speed, dtq);
+    if (mx != 0 && my != 0) step = (int)(((long long)step*FIXED_INV_SQRT2) >> 16);
+
+    player.prevRect = player.rect;
+    int x = FixedFromFloat(player.rect.x, FIXED_POS_ONE) + mx*step;
+    int y = FixedFromFloat(player.rect.y, FIXED_POS_ONE) + my*step;
+    int w = FixedFromFloat(player.rect.width, FIXED_POS_ONE), h = FixedFromFloat(player.rect.height, FIXED_POS_ONE);
+    const int right = (int)(SCREEN_W*FIXED_POS_ONE), bottom = (int)(SCREEN_H*FIXED_POS_ONE);
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x + w > right) x = right - w;
+    if (y + h > bottom) y = bottom - h;
+    player.rect.x = FixedToFloat(x, FIXED_POS_ONE);
+    player.rect.y = FixedToFloat(y, FIXED_POS_ONE);
+}
+
+// -----------------------------------------------------------------------------------------
+// Difficulty: how many enemies and how fast, from the current score
+// -----------------------------------------------------------------------------------------
+inline void UpdateDifficulty(Game &game) {
+    if (!game.difficultyRamp) {
+        game.targetEnemies = game.enemyCount;
+        return;
+    }
+    if (game.fixedPoint) {
+        // Whole points, and a Q16 speed scale
+        int score = (int)game.score;
+        int target = game.enemyCount + score/(int)DIFFICULTY_ENEMY_EVERY;
+        game.targetEnemies = (target < game.enemies.capacity()) ? target : game.enemies.capacity();
+
+        long long t = (score < (int)DIFFICULTY_SPEED_FULL) ? score : (int)DIFFICULTY_SPEED_FULL;
+        long long ramp = FixedFromFloat(DIFFICULTY_SPEED_MAX - 1.0f, FIXED_SCALE_ONE);
+        game.speedScale = FixedToFloat((long long)FIXED_SCALE_ONE + ramp*t/(int)DIFFICULTY_SPEED_FULL, FIXED_SCALE_ONE);
+        return;
+    }
+
+    int target = game.enemyCount + (int)(game.score/DIFFICULTY_ENEMY_EVERY);
+    game.targetEnemies = (target < game.enemies.capacity()) ? target : game.enemies.capacity();
+
+    float t = game.score/DIFFICULTY_SPEED_FULL;
+    game.speedScale = 1.0f + (DIFFICULTY_SPEED_MAX - 1.0f)*((t < 1.0f) ? t : 1.0f);
+}
+
+// -----------------------------------------------------------------------------------------
+// Enemies fall by speed * dt (FallEnemies), then the ones that left the bottom are recycled
+// above the screen (RecycleEnemies), or deactivated while there are more than targetEnemies.
+// The collision test goes in between: an enemy that crossed the player and left the screen
+// in one long tick must still be where it fell to when the swept test looks at it.
+// -----------------------------------------------------------------------------------------
+template <typename K> inline void FallEnemyBucket(Game &game, float dt) {
+    EnemyBucket &b = game.enemies.kinds[K::KIND];
+
+    // Fall down by speed * dt (no branches, so this vectorizes)
+    float *y = b.y.data();
+    const float *speedY = b.speedY.data();
+    if (game.fixedPoint) dt = FixedToFloat(FixedDt(dt), FIXED_DT_ONE);   // then speed*dt and the sum are exact (fixed.h)
+    int i = 0;
+    for (; i + ENEMY_SIMD_WIDTH <= b.count; i += ENEMY_SIMD_WIDTH) {
+        float next[ENEMY_SIMD_WIDTH];
+        for (int j = 0; j < ENEMY_SIMD_WIDTH; ++j) next[j] = y[i + j] + speedY[i + j]*dt;
+        for (int j = 0; j < ENEMY_SIMD_WIDTH; ++j) y[i + j] = next[j];
+    }
+    for (; i < b.count; ++i) y[i] += speedY[i]*dt;
+}
+
+// Recycle the few that went below the bottom: back above, new X, new speed in the kind's range
+template <typename K> inline void RecycleEnemyBucket(Game &game) {
+    EnemyPool &pool = game.enemies;
+    EnemyBucket &b = pool.kinds[K::KIND];
+    const float *y = b.y.data();
+    const float bottom = SCREEN_H + 10;
+    const bool hashing = game.hashTicks;
+    unsigned long long sum = game.tickHash.writeSum, sums = game.tickHash.writeSums;   // in registers (RandomValue() writes memory)
+    for (int i = 0; i < b.count; ) {
+        if (i + ENEMY_SIMD_WIDTH <= b.count) {
+            int below = 0;
+            for (int j = 0; j < ENEMY_SIMD_WIDTH; ++j) below |= (y[i + j] > bottom);
+            if (!below) { i += ENEMY_SIMD_WIDTH; continue; }   // common case: skip the whole block
+        }
+        if (y[i] <= bottom) { ++i; continue; }
+
+        if (pool.count > game.targetEnemies) {
+            EnemyPoolDeactivate(pool, K::KIND, i);   // last live enemy moved into slot i: visit it next
+            if (hashing) HashEnemyWrite(sum, sums, K::KIND, i);
+            continue;
+        }
+        b.y[i] = (float)RandomValue(game.rng, -200, -20);
+        b.x[i] = (float)RandomValue(game.rng, 0, SCREEN_W - (int)b.w[i]);
+        b.speedY[i] = RandomEnemySpeed<K>(game);
+        if (b.speedY[i] > b.maxSpeedY) b.maxSpeedY = b.speedY[i];
+        if (hashing) HashEnemyWrite(sum, sums, K::KIND, i);
+        ++i;
+    }
+    game.tickHash.writeSum = sum;
+    game.tickHash.writeSums = sums;
+}
+
+inline void FallEnemies(Game &game, float dt) {
+    ForEachEnemyKind([&](auto k) { FallEnemyBucket<decltype(k)>(game, dt); });
+}
+
+inline void RecycleEnemies(Game &game) {
+    ForEachEnemyKind([&](auto k) { RecycleEnemyBucket<decltype(k)>(game); });
+
+    // Difficulty went up: activate more (they start above the screen)
+    while (game.enemies.count < game.targetEnemies && SpawnEnemy(game, PickEnemyKind(game))) {}
+}
+
+// -----------------------------------------------------------------------------------------
+// Collision shapes, matching what main.cpp draws:
+//   - player: rounded rect (DrawRectangleRounded with PLAYER_ROUNDNESS)
+//   - sun:    circle inscribed in its rect
+//   - cloud:  three circles (CLOUD_* below), which stick out of its rect at the sides/bottom
+//   - rain:   its rect
+// -----------------------------------------------------------------------------------------
+static const float PLAYER_ROUNDNESS = 0.2f;     // must stay > 0 (rain is tested against the corner radius)
+
+static const float CLOUD_CENTER_Y = 0.6f;       // middle circle centre, fraction of height
+static const float CLOUD_RADIUS   = 0.55f;      // middle circle radius, fraction of height
+static const float CLOUD_SIDE_R   = 0.85f;      // side circle radius, fraction of the middle radius
+static const float CLOUD_SIDE_DX  = 0.9f;       // side circle offset, fraction of the middle radius
+static const float CLOUD_SIDE_DY  = 2.0f;       // side circles sit this many pixels lower
+
+// The rounded rect is an inner rect grown by the corner radius
+struct PlayerShape {
+    Rectangle bounds;            // covers the player's whole move this tick (prevRect to rect)
+    float cx, cy;                // centre, end of the tick
+    float moveX, moveY;          // movement this tick
+    float innerHw, innerHh;      // inner rect half extents
+    float radius;                // corner radius
+};
+
+inline PlayerShape MakePlayerShape(const Player &player) {
+    const Rectangle &r = player.rect, &prev = player.prevRect;
+    PlayerShape p;
+    p.bounds.x = (r.x < prev.x) ? r.x : prev.x;     // not fminf: that is a libm call at -O2
+    p.bounds.y = (r.y < prev.y) ? r.y : prev.y;
+    p.bounds.width = r.width + fabsf(r.x - prev.x);
+    p.bounds.height = r.height + fabsf(r.y - prev.y);
+    p.radius = PLAYER_ROUNDNESS*((r.width < r.height) ? r.width : r.height)*0.5f;
+    p.cx = r.x + r.width*0.5f;
+    p.cy = r.y + r.height*0.5f;
+    p.moveX = r.x - prev.x;
+    p.moveY = r.y - prev.y;
+    p.innerHw = r.width*0.5f - p.radius;
+    p.innerHh = r.height*0.5f - p.radius;
+    return p;
+}
+
+// ENEMY_SIMD_WIDTH enemies of one bucket, one per lane, at the end of the tick
+struct EnemyBlock {
+    F32x4 x, y, w, h;
+    F32x4 fall;                  // distance fallen this tick (speedY*dt), the only way enemies move
+};
+
+// --- : Swept tests. Everything is relative to the player, so a shape moving against a moving
+// player becomes a point moving along a segment (from s to s + d, t in [0, 1]) against a
+// fixed rounded rect centred on the origin (the Minkowski sum of the two shapes).
+
+// Relative motion d of one block, shared by all the segments tested for it
+struct Sweep {
+    F32x4 dx, dy;
+    F32x4 invDx, invDy;          // 1/d per axis (1 where d is 0)
+    I32x4 stillX, stillY;        // no movement on that axis
+    F32x4 invLen2;               // 1/|d|^2 (1 when not moving)
+};
+
+// The enemies fall by e.fall while the player moves by (moveX, moveY)
+inline Sweep MakeSweep(const PlayerShape &p, const EnemyBlock &e) {
+    Sweep m;
+    m.dx = SplatF32x4(-p.moveX);
+    m.dy = e.fall - p.moveY;
+    m.stillX = (m.dx == 0.0f);
+    m.stillY = (m.dy == 0.0f);
+    m.invDx = 1.0f/SelectF32x4(m.stillX, SplatF32x4(1.0f), m.dx);
+    m.invDy = 1.0f/SelectF32x4(m.stillY, SplatF32x4(1.0f), m.dy);
+    F32x4 len2 = m.dx*m.dx + m.dy*m.dy;
+    m.invLen2 = 1.0f/SelectF32x4(len2 > 0.0f, len2, SplatF32x4(1.0f));
+    return m;
+}
+
+// Clips [t0, t1] to the part of the segment inside the slab -e < s + t*d < e
+inline void ClipSegmentToSlab(F32x4 s, F32x4 inv, I32x4 still, F32x4 e, F32x4 &t0, F32x4 &t1) {
+    F32x4 a = (-e - s)*inv, b = (e - s)*inv;
+    F32x4 lo = MinF32x4(a, b), hi = MaxF32x4(a, b);
+
+    // Not moving on this axis: inside the slab for the whole tick, or never
+    I32x4 inside = (s > -e) & (s < e);
+    lo = SelectF32x4(still, SelectF32x4(inside, SplatF32x4(-1.0e30f), SplatF32x4(1.0e30f)), lo);
+    hi = SelectF32x4(still, SelectF32x4(inside, SplatF32x4(1.0e30f), SplatF32x4(-1.0e30f)), hi);
+    t0 = MaxF32x4(t0, lo);
+    t1 = MinF32x4(t1, hi);
+}
+
+// Segment from (sx, sy) vs the box with half extents (ex, ey)
+inline I32x4 SegmentHitsBox(const Sweep &m, F32x4 sx, F32x4 sy, F32x4 ex, F32x4 ey) {
+    F32x4 t0 = SplatF32x4(0.0f), t1 = SplatF32x4(1.0f);
+    ClipSegmentToSlab(sx, m.invDx, m.stillX, ex, t0, t1);
+    ClipSegmentToSlab(sy, m.invDy, m.stillY, ey, t0, t1);
+    return t0 < t1;
+}
+
+// Segment from (fx, fy), relative to a circle's centre, vs that circle: closest point of the segment
+inline I32x4 SegmentHitsCircle(const Sweep &m, F32x4 fx, F32x4 fy, F32x4 r) {
+    F32x4 t = -(fx*m.dx + fy*m.dy)*m.invLen2;
+    t = MinF32x4(Max0F32x4(t), SplatF32x4(1.0f));
+    F32x4 px = fx + t*m.dx, py = fy + t*m.dy;
+    return px*px + py*py < r*r;
+}
+
+// Segment from (sx, sy) vs the rounded rect with inner half extents (hw, hh) and corner
+// radius r: two boxes (the rect grown sideways and vertically) plus the four corner circles
+inline I32x4 SegmentHitsRoundedRect(const Sweep &m, F32x4 sx, F32x4 sy, F32x4 hw, F32x4 hh, F32x4 r) {
+    return SegmentHitsBox(m, sx, sy, hw + r, hh) |
+           SegmentHitsBox(m, sx, sy, hw, hh + r) |
+           SegmentHitsCircle(m, sx + hw, sy + hh, r) |
+           SegmentHitsCircle(m, sx - hw, sy + hh, r) |
+           SegmentHitsCircle(m, sx + hw, sy - hh, r) |
+           SegmentHitsCircle(m, sx - hw, sy - hh, r);
+}
+
+// Circles (centre at the end of the tick, radius r) vs the player over the tick
+inline I32x4 PlayerCircleHit(const PlayerShape &p, const Sweep &m, F32x4 x, F32x4 y, F32x4 r) {
+    return SegmentHitsRoundedRect(m, x - p.cx - m.dx, y - p.cy - m.dy,
+                                  SplatF32x4(p.innerHw), SplatF32x4(p.innerHh), r + p.radius);
+}
+
+inline I32x4 BoundsOverlap(const Rectangle &a, const EnemyBlock &b) {
+    return (a.x < b.x + b.w) & (a.x + a.width > b.x) & (a.y < b.y + b.h) & (a.y + a.height > b.y);
+}
+
+// Broadphase box of each enemy at the end of the tick (contains its whole shape)
+template <typename K> inline EnemyBlock EnemyBounds(const EnemyBlock &e) {
+    return e;
+}
+
+template <> inline EnemyBlock EnemyBounds<CloudKind>(const EnemyBlock &e) {
+    F32x4 cx = e.x + e.w*0.5f, cy = e.y + e.h*CLOUD_CENTER_Y;
+    F32x4 r = e.h*CLOUD_RADIUS, side = r*CLOUD_SIDE_R;
+    F32x4 halfW = r*CLOUD_SIDE_DX + side;
+    F32x4 top = cy - r;
+    F32x4 bottom = MaxF32x4(cy + r, cy + CLOUD_SIDE_DY + side);
+    return EnemyBlock{ cx - halfW, top, halfW*2.0f, bottom - top, e.fall };
+}
+
+// Narrowphase: exact shape vs the player's rounded rect over the tick, lane mask
+template <typename K> inline I32x4 EnemyShapeHit(const PlayerShape &p, const EnemyBlock &e);
+
+template <> inline I32x4 EnemyShapeHit<SunKind>(const PlayerShape &p, const EnemyBlock &e) {
+    const Sweep m = MakeSweep(p, e);
+    F32x4 r = e.w*0.5f;
+    return PlayerCircleHit(p, m, e.x + r, e.y + r, r);
+}
+
+template <> inline I32x4 EnemyShapeHit<CloudKind>(const PlayerShape &p, const EnemyBlock &e) {
+    F32x4 cx = e.x + e.w*0.5f, cy = e.y + e.h*CLOUD_CENTER_Y;
+    F32x4 r = e.h*CLOUD_RADIUS, side = r*CLOUD_SIDE_R, dx = r*CLOUD_SIDE_DX;
+    const Sweep m = MakeSweep(p, e);
+    return PlayerCircleHit(p, m, cx, cy, r) |
+           PlayerCircleHit(p, m, cx - dx, cy + CLOUD_SIDE_DY, side) |
+           PlayerCircleHit(p, m, cx + dx, cy + CLOUD_SIDE_DY, side);
+}
+
+// Rect vs rounded rect: the rect's centre vs the inner rect grown by the rect, with the corner radius
+template <> inline I32x4 EnemyShapeHit<RainKind>(const PlayerShape &p, const EnemyBlock &e) {
+    const Sweep m = MakeSweep(p, e);
+    F32x4 hw = e.w*0.5f, hh = e.h*0.5f;
+    return SegmentHitsRoundedRect(m, e.x + hw - p.cx - m.dx, e.y + hh - p.cy - m.dy,
+                                  hw + p.innerHw, hh + p.innerHh, SplatF32x4(p.radius));
+}
+
+// -----------------------------------------------------------------------------------------
+// Collision: true if any enemy's shape touched the player's at any time during the last tick
+// (swept, so a long frame cannot carry a fast enemy through the player).
+// Broadphase: enemy boxes vs the box covering the player's move, grown down by the bucket's
+// fastest fall (so speeds are only loaded for candidates), ENEMY_SIMD_WIDTH at a time.
+// Narrowphase: only for blocks with a candidate, the exact swept test on the whole block at once.
+// -----------------------------------------------------------------------------------------
+template <typename K> inline I32x4 EnemyBlockHit(const PlayerShape &p, const Rectangle &reach,
+                                                 EnemyBlock &e, const float *speedY, float dt) {
+    I32x4 candidates = BoundsOverlap(reach, EnemyBounds<K>(e));
+    if (!AnyI32x4(candidates)) return I32x4{};   // the common case
+
+    e.fall = LoadF32x4(speedY)*dt;
+    return candidates & EnemyShapeHit<K>(p, e);
+}
+
+template <typename K> inline bool EnemyBucketHit(const EnemyBucket &b, const PlayerShape &p, float dt) {
+    Rectangle reach = p.bounds;
+    reach.height += b.maxSpeedY*dt;   // an enemy that ends below the player may have started above it
+
+    I32x4 hit = {};
+    int i = 0;
+    for (; i + ENEMY_SIMD_WIDTH <= b.count; i += ENEMY_SIMD_WIDTH) {
+        EnemyBlock e = { LoadF32x4(&b.x[i]), LoadF32x4(&b.y[i]), LoadF32x4(&b.w[i]), LoadF32x4(&b.h[i]),
+                         SplatF32x4(0.0f) };
+        hit |= EnemyBlockHit<K>(p, reach, e, &b.speedY[i], dt);
+    }
+
+    // Last partial block: the storage is padded, so load it whole and drop the free lanes
+    if (i < b.count) {
+        EnemyBlock e = { LoadF32x4(&b.x[i]), LoadF32x4(&b.y[i]), LoadF32x4(&b.w[i]), LoadF32x4(&b.h[i]),
+                         SplatF32x4(0.0f) };
+        hit |= (LaneIndexI32x4() < b.count - i) & EnemyBlockHit<K>(p, reach, e, &b.speedY[i], dt);
+    }
+    return AnyI32x4(hit);
+}
+
+// dt: the tick the enemies just fell for (0 tests the current positions only)
+inline bool PlayerHit(const Player &player, const EnemyPool &enemies, float dt) {
+    const PlayerShape p = MakePlayerShape(player);
+    bool hit = false;
+    ForEachEnemyKind([&](auto k) {
+        using K = decltype(k);
+        hit = hit || EnemyBucketHit<K>(enemies.kinds[K::KIND], p, dt);
+    });
+    return hit;
+}
+
+// -----------------------------------------------------------------------------------------
+// Fixed-point collision (Game::fixedPoint): the float broadphase above, grown by
+// FIXED_BROAD_MARGIN so its rounding can only add candidates, then the same swept shapes in
+// integers (fixed.h) for each candidate enemy. Candidates are rare, so that part is scalar.
+// -----------------------------------------------------------------------------------------
+static const float FIXED_BROAD_MARGIN = 1.0f;   // px, far above any float rounding here
+
+// The player's rounded rect and move in 1/16 px
+struct PlayerShapeFixed {
+    long long cx, cy;
+    long long moveX, moveY;
+    long long innerHw, innerHh;
+    long long radius;
+};
+
+inline PlayerShapeFixed MakePlayerShapeFixed(const Player &player) {
+    const Rectangle &r = player.rect, &prev = player.prevRect;
+    PlayerShapeFixed p;
+    long long halfW = FixedNarrow(r.width*0.5f), halfH = FixedNarrow(r.height*0.5f);
+    p.radius = FixedNarrow(PLAYER_ROUNDNESS*((r.width < r.height) ? r.width : r.height)*0.5f);
+    p.cx = FixedNarrow(r.x) + halfW;
+    p.cy = FixedNarrow(r.y) + halfH;
+    p.moveX = FixedNarrow(r.x) - FixedNarrow(prev.x);
+    p.moveY = FixedNarrow(r.y) - FixedNarrow(prev.y);
+    p.innerHw = halfW - p.radius;
+    p.innerHh = halfH - p.radius;
+    return p;
+}
+
+// A circle (centre at the end of the tick) vs the player; (dx, dy) is the relative motion
+inline bool PlayerCircleHitFixed(const PlayerShapeFixed &p, long long dx, long long dy,
+                                 long long x, long long y, long long r) {
+    return FixedSegmentHitsRoundedRect(x - p.cx - dx, y - p.cy - dy, dx, dy, p.innerHw, p.innerHh, r + p.radius);
+}
+
+// One enemy (x, y, w, h as stored) that fell `fall` (1/16 px) this tick
+template <typename K> inline bool EnemyShapeHitFixed(const PlayerShapeFixed &p, float x, float y, float w, float h, long long fall);
+
+template <> inline bool EnemyShapeHitFixed<SunKind>(const PlayerShapeFixed &p, float x, float y, float w, float, long long fall) {
+    long long r = FixedNarrow(w*0.5f);
+    return PlayerCircleHitFixed(p, -p.moveX, fall - p.moveY, FixedNarrow(x) + r, FixedNarrow(y) + r, r);
+}
+
+template <> inline bool EnemyShapeHitFixed<CloudKind>(const PlayerShapeFixed &p, float x, float y, float w, float h, long long fall) {
+    long long cx = FixedNarrow(x) + FixedNarrow(w*0.5f), cy = FixedNarrow(y) + FixedNarrow(h*CLOUD_CENTER_Y);
+    long long r = FixedNarrow(h*CLOUD_RADIUS), side = FixedNarrow(h*CLOUD_RADIUS*CLOUD_SIDE_R);
+    long long dx = FixedNarrow(h*CLOUD_RADIUS*CLOUD_SIDE_DX), below = cy + FixedNarrow(CLOUD_SIDE_DY);
+    long long mx = -p.moveX, my = fall - p.moveY;
+    return PlayerCircleHitFixed(p, mx, my, cx, cy, r) ||
+           PlayerCircleHitFixed(p, mx, my, cx - dx, below, side) ||
+           PlayerCircleHitFixed(p, mx, my, cx + dx, below, side);
+}
+
+template <> inline bool EnemyShapeHitFixed<RainKind>(const PlayerShapeFixed &p, float x, float y, float w, float h, long long fall) {
+    long long hw = FixedNarrow(w*0.5f), hh = FixedNarrow(h*0.5f);
+    long long mx = -p.moveX, my = fall - p.moveY;
+    return FixedSegmentHitsRoundedRect(FixedNarrow(x) + hw - p.cx - mx, FixedNarrow(y) + hh - p.cy - my, mx, my,
+                                       hw + p.innerHw, hh + p.innerHh, p.radius);
+}
+
+// Candidate lanes of one block, each through the integer narrowphase
+template <typename K> inline bool EnemyCandidatesHitFixed(const EnemyBucket &b, int i, I32x4 candidates,
+                                                          const PlayerShapeFixed &p, int dtq) {
+    for (int j = 0; j < ENEMY_SIMD_WIDTH; ++j) {
+        int k = i + j;
+        if (candidates[j] && EnemyShapeHitFixed<K>(p, b.x[k], b.y[k], b.w[k], b.h[k],
+                                                   FixedStep(b.speedY[k], dtq) >> FIXED_NARROW_SHIFT)) return true;
+    }
+    return false;
+}
+
+template <typename K> inline bool EnemyBucketHitFixed(const EnemyBucket &b, const Rectangle &bounds,
+                                                      const PlayerShapeFixed &p, float dt, int dtq) {
+    Rectangle reach = { bounds.x - FIXED_BROAD_MARGIN, bounds.y - FIXED_BROAD_MARGIN,
+                        bounds.width + 2.0f*FIXED_BROAD_MARGIN, bounds.height + 2.0f*FIXED_BROAD_MARGIN };
+    reach.height += b.maxSpeedY*dt;
+
+    int i = 0;
+    for (; i + ENEMY_SIMD_WIDTH <= b.count; i += ENEMY_SIMD_WIDTH) {
+        EnemyBlock e = { LoadF32x4(&b.x[i]), LoadF32x4(&b.y[i]), LoadF32x4(&b.w[i]), LoadF32x4(&b.h[i]),
+                         SplatF32x4(0.0f) };
+        I32x4 candidates = BoundsOverlap(reach, EnemyBounds<K>(e));
+        if (AnyI32x4(candidates) && EnemyCandidatesHitFixed<K>(b, i, candidates, p, dtq)) return true;
+    }
+    if (i < b.count) {
+        EnemyBlock e = { LoadF32x4(&b.x[i]), LoadF32x4(&b.y[i]), LoadF32x4(&b.w[i]), LoadF32x4(&b.h[i]),
+                         SplatF32x4(0.0f) };
+        I32x4 candidates = (LaneIndexI32x4() < b.count - i) & BoundsOverlap(reach, EnemyBounds<K>(e));
+        if (AnyI32x4(candidates) && EnemyCandidatesHitFixed<K>(b, i, candidates, p, dtq)) return true;
+    }
+    return false;
+}
+
+// PlayerHit for a fixed-point game (dt as in GameInput)
+inline bool PlayerHitFixed(const Player &player, const EnemyPool &enemies, float dt) {
+    const Rectangle bounds = MakePlayerShape(player).bounds;
+    const PlayerShapeFixed p = MakePlayerShapeFixed(player);
+    const int dtq = FixedDt(dt);
+    bool hit = false;
+    ForEachEnemyKind([&](auto k) {
+        using K = decltype(k);
+        hit = hit || EnemyBucketHitFixed<K>(enemies.kinds[K::KIND], bounds, p, dt, dtq);
+    });
+    return hit;
+}
+
+// -----------------------------------------------------------------------------------------
+// Tick hash (Game::hashTicks): the small parts whole, the enemies from this tick's writes
+// and y windows
+// -----------------------------------------------------------------------------------------
+
+// y bits of enemies [first, last) into a sum and a sum of sums per lane (so order counts)
+inline void SumEnemyY(const float *y, int first, int last, I32x4 &sum, I32x4 &sums) {
+    int i = first;
+    for (; i + SIMD_WIDTH <= last; i += SIMD_WIDTH) {
+        sum += (I32x4)LoadF32x4(&y[i]);
+        sums += sum;
+    }
+    for (; i < last; ++i) {
+        int bits;
+        memcpy(&bits, &y[i], sizeof(bits));
+        sum[0] += bits;
+        sums[0] += sum[0];
+    }
+}
+
+inline void FinishTickHash(Game &game) {
+    TickHash &t = game.tickHash;
+    const Rectangle &r = game.player.rect;
+    t.field[TICK_HASH_PLAYER] = HashFloat(HashFloat(HashFloat(HashFloat(TICK_HASH_SEED, r.x), r.y), r.width), r.height);
+
+    unsigned long long h = HashMix(HashMix(TICK_HASH_SEED, t.writeSum), t.writeSums);
+    t.enemyWindows = 1;
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        const EnemyBucket &b = game.enemies.kinds[k];
+        int windows = (b.count + TICK_HASH_WINDOW - 1)/TICK_HASH_WINDOW;
+        if (windows > t.enemyWindows) t.enemyWindows = windows;
+        int first = (b.count > TICK_HASH_WINDOW) ? (int)((unsigned long long)game.ticks*TICK_HASH_WINDOW % b.count) : 0;
+        int last = first + ((b.count < TICK_HASH_WINDOW) ? b.count : TICK_HASH_WINDOW);
+        I32x4 sum = {}, sums = {};
+        SumEnemyY(b.y.data(), first, (last < b.count) ? last : b.count, sum, sums);
+        if (last > b.count) SumEnemyY(b.y.data(), 0, last - b.count, sum, sums);   // wrapped around
+
+        h = HashMix(h, (unsigned)b.count);
+        for (int j = 0; j < SIMD_WIDTH; ++j) h = HashMix(h, ((unsigned long long)(unsigned)sum[j] << 32) | (unsigned)sums[j]);
+    }
+    t.field[TICK_HASH_ENEMIES] = h;
+
+    h = HashMix(HashMix(TICK_HASH_SEED, (unsigned)game.state), (unsigned)game.weather);
+    h = HashMix(HashFloat(HashFloat(h, game.score), game.speedScale), (unsigned)game.bestScore);
+    t.field[TICK_HASH_SCORE] = HashMix(h, (unsigned)game.targetEnemies);
+
+    t.field[TICK_HASH_RNG] = HashMix(TICK_HASH_SEED, game.rng.state);
+}
+
+// -----------------------------------------------------------------------------------------
+// One tick of the update loop (handle input, move entities, detect collisions, update score)
+// -----------------------------------------------------------------------------------------
+inline void StepGame(Game &game, const GameInput &in) {
+    if (in.weather >= 0) game.weather = (WeatherKind)in.weather;
+    game.ticks++;
+    game.tickHash.writeSum = game.tickHash.writeSums = 0;
+
+    if (game.state == GameState::MENU) {
+        // On menu, wait for SPACE/ENTER to start a new game
+        if (in.keys & KEYS_START) {
+            ResetGame(game);
+            ChangeState(game, GameState::PLAYING);
+        }
+    }
+    else if (game.state == GameState::PLAYING) {
+        // ------------------------------
+        // 1) Player movement
+        // ------------------------------
+        Vector2 move = KeysToMove(in.keys);
+
+        {
+            PROFILE_SCOPE(PROF_PLAYER);
+
+            // Normalise, move by speed * dt, clamp on screen
+            if (game.fixedPoint) UpdatePlayerFixed(game.player, move, FixedDt(in.dt));
+            else UpdatePlayer(game.player, move, in.dt);
+        }
+
+        // ------------------------------
+        // 2) Enemies: fall, collide, then recycle
+        // ------------------------------
+        {
+            PROFILE_SCOPE(PROF_ENEMIES);
+
+            // Fall down by speed * dt
+            UpdateDifficulty(game);
+            FallEnemies(game, in.dt);
+        }
+
+        {
+            PROFILE_SCOPE(PROF_COLLISION);
+
+            // Collision: if any enemy overlapped the player during the tick, game over.
+            // Before the recycle, so an enemy that fell through the player and off the
+            // bottom in one long tick is still tested where it fell
+            bool hit = game.fixedPoint ? PlayerHitFixed(game.player, game.enemies, in.dt)
+                                       : PlayerHit(game.player, game.enemies, in.dt);
+            if (hit && !game.invincible) {
+                ChangeState(game, GameState::GAME_OVER);
+
+                // Update best score if current score is higher
+                if ((int)game.score > game.bestScore) game.bestScore = (int)game.score;
+            }
+        }
+
+        {
+            PROFILE_SCOPE(PROF_ENEMIES);
+
+            // Recycle above the screen once below the bottom, and follow the difficulty
+            // curve's enemy count
+            RecycleEnemies(game);
+        }
+
+        // ------------------------------
+        // 3) Scoring
+        // ------------------------------
+        // Score increases as long as you survive.
+        // add 60 per second to feel like "points per second"
+        if (game.fixedPoint) game.score += FixedToFloat((60LL*FixedDt(in.dt)) >> 2, FIXED_SCORE_ONE);   // Q12 -> Q10
+        else game.score += 60.0f * in.dt;
+    }
+    else if (game.state == GameState::GAME_OVER) {
+        // From the GAME OVER screen, allow restart or return to menu
+        if (in.keys & KEYS_RESTART) {
+            ResetGame(game);
+            ChangeState(game, GameState::PLAYING);
+        }
+        if (in.keys & KEYS_MENU) {
+            // ESC to go back to the MENU from GAME OVER
+            ChangeState(game, GameState::MENU);
+        }
+    }
+
+    if (game.hashTicks) FinishTickHash(game);
+}
+
+// -----------------------------------------------------------------------------------------
+// FNV-1a over the bits of the observable state (player rect, enemies, score, state, RNG):
+// identical runs give identical checksums, any gameplay change shows up immediately
+// -----------------------------------------------------------------------------------------
+inline unsigned long long HashBytes(unsigned long long h, const void *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) { h ^= p[i]; h *= 0x100000001B3ull; }
+    return h;
+}
+
+inline unsigned long long GameChecksum(const Game &game) {
+    unsigned long long h = 0xCBF29CE484222325ull;
+    int state = (int)game.state, weather = (int)game.weather;
+    h = HashBytes(h, &state, sizeof(state));
+    h = HashBytes(h, &weather, sizeof(weather));
+    h = HashBytes(h, &game.player.rect, sizeof(game.player.rect));
+    h = HashBytes(h, &game.score, sizeof(game.score));
+    h = HashBytes(h, &game.bestScore, sizeof(game.bestScore));
+    h = HashBytes(h, &game.rng.state, sizeof(game.rng.state));
+    for (const EnemyBucket &b : game.enemies.kinds) {
+        size_t n = (size_t)b.count*sizeof(float);
+        h = HashBytes(h, &b.count, sizeof(b.count));
+        h = HashBytes(h, b.x.data(), n);
+        h = HashBytes(h, b.y.data(), n);
+        h = HashBytes(h, b.w.data(), n);
+        h = HashBytes(h, b.h.data(), n);
+        h = HashBytes(h, b.speedY.data(), n);
+    }
+    return h;
+}
@@ -0,0 +1,412 @@
+/*******************************************************************************************
+* ghost.h - ghost runs: the best run's player trajectory, replayed as a translucent player
+*
+*   The trajectory is sampled at a fixed GHOST_HZ (positions interpolated between ticks, so
+*   the stream does not depend on the frame rate), in 1/16 px units, and delta-coded twice:
+*   a sample's step (position - previous position) is predicted to repeat the previous step,
+*   and only samples that break the prediction are written, as varint-prefixed tokens:
+*
+*     token   byte (run << 4 | code), [varint run - 15 when run == 15], payload
+*             = `run` predicted samples, then one sample whose new step is
+*     code    0..12  palette[code]: one of the 13 most recently written steps (1 byte total)
+*             13     an explicit step: zigzag varints x, y (pushed onto the palette)
+*             14     a blend of the previous step and palette[i] (a direction change part way
+*                    between two samples): one byte i << 4 | f, step = (prev*f + new*(16-f))/16
+*             15     no sample: the run ends the stream
+*
+*   - The encoder accepts the prediction (or the cheapest token) while it stays within
+*     GHOST_TOLERANCE of the real position. Straight movement costs nothing and the player's
+*     few distinct steps (8 directions, wall slides) land in the palette, so a direction
+*     change costs about 3 bytes; a 10-minute run is a few kilobytes.
+*   - Recording writes into a buffer reserved up front (GHOST_MAX_BYTES) and stops there, so
+*     PLAYING frames never allocate; decoding walks the stream in place, a few samples per
+*     frame, with no allocation either
+*   - Ghost files (GHOST_FILE, stored by savedata.h) are a GhostHeader followed by the
+*     stream; little-endian, like .rec files
+*******************************************************************************************/
+
+#pragma once
+
+#include "raylib.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static const char GHOST_MAGIC[8] = { 'D', 'O', 'D', 'G', 'E', 'G', 'H', 'O' };
+static const int GHOST_VERSION = 1;
+static const int GHOST_HZ = 30;                       // samples per second of play
+static const int GHOST_UNITS = 16;                    // sub-pixel units per pixel
+static const int GHOST_TOLERANCE = GHOST_UNITS;       // largest accepted prediction error (1 px)
+static const int GHOST_MAX_BYTES = 64*1024;           // ~2 hours of typical play
+static const int GHOST_MAX_TOKEN = 16;                // header byte + 3 varints of at most 5 bytes
+static const int GHOST_PALETTE = 13;                  // recent steps a 1-byte token can name
+enum { GHOST_CODE_STEP = 13, GHOST_CODE_BLEND = 14, GHOST_CODE_END = 15 };
+#define GHOST_FILE "best.ghost"
+
+struct GhostHeader {
+    char magic[8];
+    int version;
+    int hz;
+    int samples;                        // sample 0 is (x0, y0), at the start of the run
+    int x0, y0;                         // GHOST_UNITS
+    int width, height;                  // player size, pixels
+    int score;                          // the run's score
+    int bytes;                          // stream size
+    int reserved;
+};
+
+// A finished ghost: header + stream
+struct Ghost {
+    GhostHeader header = {};
+    std::vector<unsigned char> stream;
+};
+
+// -----------------------------------------------------------------------------------------
+// Varints (LEB128) and zigzag
+// -----------------------------------------------------------------------------------------
+inline unsigned int GhostZigzag(int v) { return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31); }
+inline int GhostUnzigzag(unsigned int v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+inline unsigned char *GhostPutVarint(unsigned char *p, unsigned int v)
+{
+    while (v >= 0x80) { *p++ = (unsigned char)(v | 0x80); v >>= 7; }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+// False when the stream ends inside the varint
+inline bool GhostGetVarint(const unsigned char *data, int size, int &pos, unsigned int &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+        unsigned char b = data[pos++];
+        v |= (unsigned int)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------
+// Coder state, mirrored exactly by the encoder and the decoder
+// -----------------------------------------------------------------------------------------
+struct GhostCoder {
+    int x = 0, y = 0;                   // position of the last sample, units
+    int dx = 0, dy = 0;                 // its step: the prediction for the next one
+    int palette[GHOST_PALETTE][2] = {}; // recent steps, most recent first
+};
+
+inline void GhostCoderReset(GhostCoder &c, int x0, int y0)
+{
+    c = GhostCoder{};
+    c.x = x0;
+    c.y = y0;
+}
+
+inline void GhostCoderMove(GhostCoder &c, int sx, int sy)
+{
+    c.dx = sx;
+    c.dy = sy;
+    c.x += sx;
+    c.y += sy;
+}
+
+// Palette entry i moves to the front and becomes the step
+inline void GhostCoderUsePalette(GhostCoder &c, int i)
+{
+    int sx = c.palette[i][0], sy = c.palette[i][1];
+    for (; i > 0; --i) { c.palette[i][0] = c.palette[i - 1][0]; c.palette[i][1] = c.palette[i - 1][1]; }
+    c.palette[0][0] = sx;
+    c.palette[0][1] = sy;
+    GhostCoderMove(c, sx, sy);
+}
+
+inline void GhostCoderPushStep(GhostCoder &c, int sx, int sy)
+{
+    for (int i = GHOST_PALETTE - 1; i > 0; --i) { c.palette[i][0] = c.palette[i - 1][0]; c.palette[i][1] = c.palette[i - 1][1]; }
+    c.palette[0][0] = sx;
+    c.palette[0][1] = sy;
+    GhostCoderMove(c, sx, sy);
+}
+
+// f/16 of the previous step and (16 - f)/16 of palette entry i (integer, identical on both sides)
+inline int GhostBlend(int prev, int next, int f) { return (prev*f + next*(16 - f))/16; }
+
+// -----------------------------------------------------------------------------------------
+// Recording
+// -----------------------------------------------------------------------------------------
+struct GhostRecorder {
+    Ghost ghost;                        // stream reserved to GHOST_MAX_BYTES once
+    GhostCoder coder;                   // what the decoder will reconstruct
+    bool recording = false, full = false;
+    double time = 0.0;                  // seconds since the run started
+    float prevX = 0.0f, prevY = 0.0f;   // player position (pixels) at `time`
+    int lastX = 0, lastY = 0;           // real position of the last sample, units
+    int run = 0;                        // predicted samples not written yet
+};
+
+inline void GhostRecordBegin(GhostRecorder &rec, Rectangle player)
+{
+    if (rec.ghost.stream.capacity() < (size_t)GHOST_MAX_BYTES) rec.ghost.stream.reserve(GHOST_MAX_BYTES);
+    rec.ghost.stream.clear();
+
+    GhostHeader &h = rec.ghost.header;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, GHOST_MAGIC, sizeof(h.magic));
+    h.version = GHOST_VERSION;
+    h.hz = GHOST_HZ;
+    h.samples = 1;
+    h.x0 = (int)lroundf(player.x*GHOST_UNITS);
+    h.y0 = (int)lroundf(player.y*GHOST_UNITS);
+    h.width = (int)player.width;
+    h.height = (int)player.height;
+
+    GhostCoderReset(rec.coder, h.x0, h.y0);
+    rec.recording = true;
+    rec.full = false;
+    rec.time = 0.0;
+    rec.prevX = player.x;
+    rec.prevY = player.y;
+    rec.lastX = h.x0;
+    rec.lastY = h.y0;
+    rec.run = 0;
+}
+
+// Token header (+ run extension); the payload is appended by the caller
+inline unsigned char *GhostPutTokenHeader(unsigned char *p, int run, int code)
+{
+    *p++ = (unsigned char)(((run < 15) ? run : 15) << 4 | code);
+    if (run >= 15) p = GhostPutVarint(p, (unsigned int)(run - 15));
+    return p;
+}
+
+inline void GhostAppend(GhostRecorder &rec, const unsigned char *token, const unsigned char *end)
+{
+    rec.ghost.stream.insert(rec.ghost.stream.end(), token, end);   // within the reserved capacity
+}
+
+inline int GhostError(const GhostCoder &c, int sx, int sy, int tx, int ty)
+{
+    int ex = abs(c.x + sx - tx), ey = abs(c.y + sy - ty);
+    return (ex > ey) ? ex : ey;
+}
+
+// One sample at the real position (sx, sy), pixels
+inline void GhostRecordSample(GhostRecorder &rec, float sx, float sy)
+{
+    GhostCoder &c = rec.coder;
+    int tx = (int)lroundf(sx*GHOST_UNITS), ty = (int)lroundf(sy*GHOST_UNITS);
+    int stepX = tx - rec.lastX, stepY = ty - rec.lastY;   // the real step
+    rec.lastX = tx;
+    rec.lastY = ty;
+    if (GhostError(c, c.dx, c.dy, tx, ty) <= GHOST_TOLERANCE) {
+        GhostCoderMove(c, c.dx, c.dy);
+        rec.run++;
+        rec.ghost.header.samples++;
+        return;
+    }
+
+    // Room for this token and the one GhostRecordEnd() may flush
+    if (rec.ghost.stream.size() + 2*GHOST_MAX_TOKEN > (size_t)GHOST_MAX_BYTES) { rec.full = true; return; }
+
+    // The cheapest token that lands within the tolerance, and among those the one closest to
+    // the real step (a step that is merely close enough would break the next prediction).
+    // The real step itself always fits: the coded position is within the tolerance already.
+    int bestCode = GHOST_CODE_STEP, bestIndex = 0, bestF = 0, bestDiff = 1 << 30;
+    for (int i = 0; i < GHOST_PALETTE; ++i) {
+        int diff = GhostError(c, c.palette[i][0], c.palette[i][1], c.x + stepX, c.y + stepY);
+        if (diff < bestDiff && GhostError(c, c.palette[i][0], c.palette[i][1], tx, ty) <= GHOST_TOLERANCE) {
+            bestCode = i;
+            bestDiff = diff;
+        }
+    }
+    for (int i = 0; i < GHOST_PALETTE && bestCode == GHOST_CODE_STEP; ++i) {
+        for (int f = 1; f < 16; ++f) {
+            int bx = GhostBlend(c.dx, c.palette[i][0], f), by = GhostBlend(c.dy, c.palette[i][1], f);
+            int diff = GhostError(c, bx, by, c.x + stepX, c.y + stepY);
+            if (diff < bestDiff && GhostError(c, bx, by, tx, ty) <= GHOST_TOLERANCE) {
+                bestIndex = i;
+                bestF = f;
+                bestDiff = diff;
+            }
+        }
+    }
+    if (bestCode == GHOST_CODE_STEP && bestDiff < (1 << 30)) bestCode = GHOST_CODE_BLEND;
+
+    unsigned char token[GHOST_MAX_TOKEN];
+    unsigned char *end = GhostPutTokenHeader(token, rec.run, bestCode);
+    if (bestCode < GHOST_PALETTE) {
+        GhostCoderUsePalette(c, bestCode);
+    } else if (bestCode == GHOST_CODE_BLEND) {
+        *end++ = (unsigned char)(bestIndex << 4 | bestF);
+        GhostCoderMove(c, GhostBlend(c.dx, c.palette[bestIndex][0], bestF), GhostBlend(c.dy, c.palette[bestIndex][1], bestF));
+    } else {
+        end = GhostPutVarint(end, GhostZigzag(stepX));
+        end = GhostPutVarint(end, GhostZigzag(stepY));
+        GhostCoderPushStep(c, stepX, stepY);
+    }
+    GhostAppend(rec, token, end);
+    rec.run = 0;
+    rec.ghost.header.samples++;
+}
+
+// After every PLAYING tick: the samples that fall inside the tick, interpolated
+inline void GhostRecordTick(GhostRecorder &rec, Rectangle player, float dt)
+{
+    if (!rec.recording || rec.full || !(dt > 0.0f)) return;
+    double end = rec.time + dt;
+    for (;;) {
+        double t = (double)rec.ghost.header.samples/GHOST_HZ;
+        if (t > end || rec.full) break;
+        float a = (float)((t - rec.time)/dt);
+        GhostRecordSample(rec, rec.prevX + (player.x - rec.prevX)*a, rec.prevY + (player.y - rec.prevY)*a);
+    }
+    rec.time = end;
+    rec.prevX = player.x;
+    rec.prevY = player.y;
+}
+
+// Flushes the pending predicted samples; the ghost is then complete
+inline void GhostRecordEnd(GhostRecorder &rec, int score)
+{
+    if (!rec.recording) return;
+    if (rec.run > 0) {
+        unsigned char token[GHOST_MAX_TOKEN];
+        GhostAppend(rec, token, GhostPutTokenHeader(token, rec.run, GHOST_CODE_END));
+    }
+    rec.run = 0;
+    rec.ghost.header.score = score;
+    rec.ghost.header.bytes = (int)rec.ghost.stream.size();
+    rec.recording = false;
+}
+
+// -----------------------------------------------------------------------------------------
+// Playback: walks the stream as time advances, never allocates
+// -----------------------------------------------------------------------------------------
+struct GhostPlayback {
+    const Ghost *ghost = nullptr;
+    GhostCoder coder;                   // the next sample (what (x, y) becomes next)
+    int pos = 0;                        // next stream byte
+    int sample = 0;                     // index of (x, y)
+    int x = 0, y = 0;                   // units
+    int run = 0;                        // predicted samples left in the current token
+    int code = GHOST_CODE_END;          // its closing sample (GHOST_CODE_END: none)
+    double time = 0.0;
+};
+
+// Decodes sample + 1 into pb.coder; false at the end of the stream
+inline bool GhostDecodeNext(GhostPlayback &pb)
+{
+    const unsigned char *data = pb.ghost->stream.data();
+    int size = (int)pb.ghost->stream.size();
+    GhostCoder &c = pb.coder;
+
+    while (pb.run == 0 && pb.code == GHOST_CODE_END) {
+        if (pb.pos >= size) return false;
+        unsigned char b = data[pb.pos++];
+        pb.run = b >> 4;
+        pb.code = b & 15;
+        if (pb.run == 15) {
+            unsigned int more;
+            if (!GhostGetVarint(data, size, pb.pos, more)) return false;
+            pb.run += (int)more;
+        }
+    }
+
+    if (pb.run > 0) {
+        pb.run--;
+        GhostCoderMove(c, c.dx, c.dy);
+        return true;
+    }
+
+    if (pb.code < GHOST_PALETTE) {
+        GhostCoderUsePalette(c, pb.code);
+    } else if (pb.code == GHOST_CODE_BLEND) {
+        if (pb.pos >= size) return false;
+        unsigned char b = data[pb.pos++];
+        int i = b >> 4, f = b & 15;
+        if (i >= GHOST_PALETTE) return false;
+        GhostCoderMove(c, GhostBlend(c.dx, c.palette[i][0], f), GhostBlend(c.dy, c.palette[i][1], f));
+    } else {
+        unsigned int sx, sy;
+        if (!GhostGetVarint(data, size, pb.pos, sx) || !GhostGetVarint(data, size, pb.pos, sy)) return false;
+        GhostCoderPushStep(c, GhostUnzigzag(sx), GhostUnzigzag(sy));
+    }
+    pb.code = GHOST_CODE_END;
+    return true;
+}
+
+inline void GhostPlayBegin(GhostPlayback &pb, const Ghost *ghost)
+{
+    pb = GhostPlayback{};
+    if (!ghost || ghost->header.samples < 1) return;
+    pb.ghost = ghost;
+    pb.x = ghost->header.x0;
+    pb.y = ghost->header.y0;
+    GhostCoderReset(pb.coder, pb.x, pb.y);
+    if (ghost->header.samples > 1) GhostDecodeNext(pb);
+}
+
+// Advances by dt; false once the ghost's run is over (it is then not drawn)
+inline bool GhostPlayAdvance(GhostPlayback &pb, float dt)
+{
+    if (!pb.ghost) return false;
+    pb.time += dt;
+    while (pb.time*GHOST_HZ >= pb.sample + 1) {
+        if (pb.sample + 1 >= pb.ghost->header.samples) { pb.ghost = nullptr; return false; }
+        pb.x = pb.coder.x;
+        pb.y = pb.coder.y;
+        pb.sample++;
+        if (pb.sample + 1 < pb.ghost->header.samples && !GhostDecodeNext(pb)) { pb.ghost = nullptr; return false; }
+    }
+    return true;
+}
+
+// Where the ghost player is now (between two samples)
+inline Rectangle GhostPlayRect(const GhostPlayback &pb)
+{
+    const GhostHeader &h = pb.ghost->header;
+    float a = (float)(pb.time*GHOST_HZ - pb.sample);
+    return Rectangle{ (pb.x + (pb.coder.x - pb.x)*a)/GHOST_UNITS, (pb.y + (pb.coder.y - pb.y)*a)/GHOST_UNITS,
+                      (float)h.width, (float)h.height };
+}
+
+// -----------------------------------------------------------------------------------------
+// Files
+// -----------------------------------------------------------------------------------------
+// File bytes: header + stream
+inline void GhostToBytes(const Ghost &ghost, std::vector<unsigned char> &bytes)
+{
+    bytes.resize(sizeof(GhostHeader) + ghost.stream.size());
+    memcpy(bytes.data(), &ghost.header, sizeof(GhostHeader));
+    if (!ghost.stream.empty()) memcpy(bytes.data() + sizeof(GhostHeader), ghost.stream.data(), ghost.stream.size());
+}
+
+inline bool ParseGhost(const unsigned char *data, size_t size, Ghost &ghost)
+{
+    if (size < sizeof(GhostHeader)) return false;
+    GhostHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, GHOST_MAGIC, sizeof(h.magic)) != 0 || h.version != GHOST_VERSION || h.hz != GHOST_HZ ||
+        h.samples < 1 || h.bytes < 0 || (size_t)h.bytes != size - sizeof(GhostHeader)) return false;
+    ghost.header = h;
+    ghost.stream.assign(data + sizeof(GhostHeader), data + size);
+    return true;
+}
+
+inline bool SaveGhost(const char *path, const Ghost &ghost)
+{
+    std::vector<unsigned char> bytes;
+    GhostToBytes(ghost, bytes);
+    return SaveFileData(path, bytes.data(), (int)bytes.size());
+}
+
+inline bool LoadGhost(const char *path, Ghost &ghost)
+{
+    if (!FileExists(path)) return false;
+    int size = 0;
+    unsigned char *data = LoadFileData(path, &size);
+    if (!data) return false;
+    bool ok = ParseGhost(data, (size_t)size, ghost);
+    UnloadFileData(data);
+    return ok;
+}
@@ -14,19 +14,55 @@
 *
 * STRUCTURE
 *   - ResetGame() initialises player, enemies, and score (random sizing and speed of enemies)
-*   - Update loop handles input, movement, collisions, and scoring
+*   - Update loop turns input into a GameInput and runs StepGame() (simulation lives in game.h)
+*   - Desktop: --record <file> saves every tick's input; tools/regress.cpp replays it headless,
+*     and <file>.hashes the per-tick state hashes (tickhash.h) for tools/desync.cpp
+*   - Desktop: --view <file> watches a recording or pack (replaypack.h): scrub, seek, 1x-100x
+*   - Desktop: --versus <0|1> plays another instance over UDP (versus.h, rollback netcode)
+*   - Desktop: --broadcast <port> streams to a spectator relay, --spectate <port> watches (spectate.h)
+*   - --fixed (or ?fixed=1 on web) runs the fixed-point tick (fixed.h): replays match on every build
+*   - --stress (or ?stress=1 on web) ramps the enemy count to find the max sustainable count
+*   - MENU attract mode: the lookahead bot (bot.h) plays a demo game behind the title
+*   - Ghost run: the best run's trajectory (ghost.h) replays as a translucent player
+*   - Best score, run history and best ghost persist (savedata.h: a file on desktop, IDBFS on web)
+*   - Enemy sizes/speeds come from enemy_profiles.txt (tuning.h), reloaded on save on desktop Linux
 *   - Draw section renders depending on current state -  Weather API Open-meteo used to check weather state
+*   - Frame-time percentiles (p50/p95/p99/max, missed vsyncs) via GetFrameStats() and on exit
+*   - Build with -DDODGE_PROFILE for per-phase frame timings (F4 overlay, profile.csv/json on exit)
+*   - Build with -DDODGE_TRACE for a Chrome trace (dodge_trace.json, F5 downloads it on web)
+*   - Build with -DDODGE_ALLOC_STATS to count heap allocations per frame/phase (PLAYING must not allocate)
 *******************************************************************************************/
 
 #include "raylib.h"
+#include "game.h"
+#include "replay.h"
+#include "tickhash.h"
+#include "replaypack.h"
+#include "stress.h"
+#include "tuning.h"
+#include "bot.h"
+#include "ghost.h"
+#include "savedata.h"
+#include "versus.h"
+#include "rollback.h"
+#include "spectate.h"
+#include "raster.h"
+#include "profiler.h"
+#include "framestats.h"
 #include <vector>
 //#include <string>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#ifndef __EMSCRIPTEN__
+  #include "net.h"
+#endif
 
 
 
 // --- : Weather bridge (lets JS set the current weather) -----------------
-enum class WeatherKind { SUNNY = 0, CLOUDY = 1, RAINY = 2 };
 static WeatherKind gWeather = WeatherKind::SUNNY; // default if fetch fails
 static const char* WeatherName()
 {
@@ -37,222 +73,686 @@ static const char* WeatherName()
     }
 }
 
+// All weather changes (JS bridge + debug keys) go through here so they can be traced
+static void ChangeWeather(WeatherKind kind)
+{
+    gWeather = kind;
+    TraceInstant("weather", "kind", WeatherName());
+}
+
+// --- : Frame-time stats bridge (JSON summary, polled by shell.html for monitoring)
+static char gFrameStatsBuf[256];
+
+// --- : Stress mode (command line / URL query, see stress.h)
+static StressConfig gStress;
+static StressState gStressState = {};
+
+// --- : Attract mode (the bot plays its own Game behind the MENU; the real game is untouched)
+static Game gDemo;
+static Bot gDemoBot;
+static bool gDemoRunning = false;
+static unsigned long long gDemoSeed = 0;
+
+// --- : Ghost run (the best run so far, recorded/replayed by ghost.h)
+static Ghost gGhost;                 // best ghost (this session's, or the stored one once loaded)
+static GhostRecorder gGhostRec;      // the current run
+static GhostPlayback gGhostPlay;     // gGhost, in step with the current run
+static bool gGhostDirty = false;     // gGhost beaten, not saved yet
+static const float GHOST_ALPHA = 0.35f;
+
+// --- : Saved data (best score + run history, see savedata.h; the ghost is saved alongside)
+static SaveData gSave;               // this session's runs, merged with the stored ones once loaded
+static bool gSaveDirty = false;      // runs added, not saved yet
+static float gRunSeconds = 0.0f;     // current run, game time
+static std::vector<unsigned char> gSaveBytes;   // file bytes being handed to savedata.h
+
 #ifdef __EMSCRIPTEN__
   #include <emscripten/emscripten.h>
-  extern "C" { EMSCRIPTEN_KEEPALIVE void SetWeather(int kind) { gWeather = (WeatherKind)kind; } }
+  extern "C" { EMSCRIPTEN_KEEPALIVE void SetWeather(int kind) { ChangeWeather((WeatherKind)kind); } }
+  extern "C" { EMSCRIPTEN_KEEPALIVE const char *GetFrameStats() { return FrameStatsJSON(gFrameStatsBuf, sizeof(gFrameStatsBuf)); } }
+  extern "C" { EMSCRIPTEN_KEEPALIVE int GetStressResult() { return gStressState.done ? gStressState.sustainable : -1; } }
 #else
   // Desktop stub (so it compiles/runs without emscripten)
-  extern "C" void SetWeather(int kind) { gWeather = (WeatherKind)kind; }
+  extern "C" void SetWeather(int kind) { ChangeWeather((WeatherKind)kind); }
+  extern "C" const char *GetFrameStats() { return FrameStatsJSON(gFrameStatsBuf, sizeof(gFrameStatsBuf)); }
+  extern "C" int GetStressResult() { return gStressState.done ? gStressState.sustainable : -1; }
 #endif
 
+// Held direction keys -> KEYS_LEFT/RIGHT/UP/DOWN (also versus mode's whole input)
+static unsigned char ReadMoveKeys()
+{
+    unsigned char keys = 0;
+
+    // Support both Arrows and WASD
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) keys |= KEYS_RIGHT;
+    if (IsKeyDown(KEY_LEFT)  || IsKeyDown(KEY_A)) keys |= KEYS_LEFT;
+    if (IsKeyDown(KEY_DOWN)  || IsKeyDown(KEY_S)) keys |= KEYS_DOWN;
+    if (IsKeyDown(KEY_UP)    || IsKeyDown(KEY_W)) keys |= KEYS_UP;
+    return keys;
+}
+
 // -----------------------------------------------------------------------------------------
-// Data types 
+// Keyboard -> GameInput for this frame (the simulation never reads the keyboard itself)
 // -----------------------------------------------------------------------------------------
+static GameInput ReadInput(const Game &game)
+{
+    GameInput in{};
+    in.keys = ReadMoveKeys();
+
+    if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) in.keys |= KEYS_START;
+    if (IsKeyPressed(KEY_R))      in.keys |= KEYS_RESTART;
+    if (IsKeyPressed(KEY_ESCAPE)) in.keys |= KEYS_MENU;
+
+    // Debug keys (desktop/web) to cycle weather quickly (optional)
+    if (game.state == GameState::PLAYING) {
+        if (IsKeyPressed(KEY_F1)) { ChangeWeather(WeatherKind::SUNNY); }
+        if (IsKeyPressed(KEY_F2)) { ChangeWeather(WeatherKind::CLOUDY); }
+        if (IsKeyPressed(KEY_F3)) { ChangeWeather(WeatherKind::RAINY); }
+    }
 
-// Player data: a rectangle for position/size and a movement speed in pixels/sec
-struct Player {
-    Rectangle rect;      // x, y, width, height
-    float speed = 260.0f;
-};
+    // Weather from JS or the debug keys reaches the simulation as input, so recordings keep it
+    in.weather = (gWeather != game.weather) ? (signed char)gWeather : -1;
+    in.dt = GetFrameTime();
+    return in;
+}
 
-// --- : Enemy has a kind so we can draw sun/cloud/rain
-struct Enemy {
-    Rectangle rect;
-    float speedY;
-    int kind; // 0 sun, 1 cloud, 2 rain (mirrors WeatherKind)
-};
+// -----------------------------------------------------------------------------------------
+// Enemy draw kernels, one per kind (kind traits are in game.h)
+// -----------------------------------------------------------------------------------------
+template <typename K> static void DrawEnemyBucket(const EnemyBucket &b);
+
+// RAIN: blue thin rect
+template <> void DrawEnemyBucket<RainKind>(const EnemyBucket &b)
+{
+    for (int i = 0; i < b.count; ++i) {
+        DrawRectangleRec(Rectangle{ b.x[i], b.y[i], b.w[i], b.h[i] }, SCENE_RAIN);
+    }
+}
+
+// CLOUD: three overlapping white circles inside the rect area
+template <> void DrawEnemyBucket<CloudKind>(const EnemyBucket &b)
+{
+    for (int i = 0; i < b.count; ++i) {
+        float cx = b.x[i] + b.w[i]*0.5f;
+        float cy = b.y[i] + b.h[i]*CLOUD_CENTER_Y;
+        float r1 = b.h[i]*CLOUD_RADIUS;
+        float r2 = r1*CLOUD_SIDE_R, r3 = r1*CLOUD_SIDE_R;
+        DrawCircle((int)cx,                        (int)cy,                   (int)r1, SCENE_CLOUD);
+        DrawCircle((int)(cx - r1*CLOUD_SIDE_DX),   (int)(cy + CLOUD_SIDE_DY), (int)r2, SCENE_CLOUD);
+        DrawCircle((int)(cx + r1*CLOUD_SIDE_DX),   (int)(cy + CLOUD_SIDE_DY), (int)r3, SCENE_CLOUD);
+    }
+}
+
+// SUN: yellow circle
+template <> void DrawEnemyBucket<SunKind>(const EnemyBucket &b)
+{
+    for (int i = 0; i < b.count; ++i) {
+        float r = b.w[i]*0.5f;
+        DrawCircle((int)(b.x[i] + r), (int)(b.y[i] + r), (int)r, SCENE_SUN);
+    }
+}
+
+static void DrawEnemies(const EnemyPool &enemies)
+{
+    // --- : Draw enemies by type (sun/cloud/rain), one kernel per bucket
+    ForEachEnemyKind([&](auto k) {
+        using K = decltype(k);
+        DrawEnemyBucket<K>(enemies.kinds[K::KIND]);
+    });
+}
+
+// Player + enemies of a game (the PLAYING screen, and the attract-mode demo under the MENU)
+static void DrawWorld(const Game &game, const Rectangle *ghost = nullptr)
+{
+    // Ghost run: the same shape as the player, translucent, so it shares the player's batch
+    if (ghost) DrawRectangleRounded(*ghost, PLAYER_ROUNDNESS, 6, Fade(SCENE_PLAYER, GHOST_ALPHA));
 
-// Simple game-state enum to control which screen/logic is active
-enum class GameState { MENU, PLAYING, GAME_OVER };
+    // Draw player (rounded green square)
+    DrawRectangleRounded(game.player.rect, PLAYER_ROUNDNESS, 6, SCENE_PLAYER);
+    DrawEnemies(game.enemies);
+}
 
 // -----------------------------------------------------------------------------------------
-// screen size 
+// Attract mode: while the real game sits at the MENU, the bot plays a demo run. It steps
+// with BotSimTick (no state changes or trace events) and restarts as soon as it is hit.
 // -----------------------------------------------------------------------------------------
-static const int SCREEN_W = 800;
-static const int SCREEN_H = 450;
+static void UpdateAttractMode(const Game &game, float dt)
+{
+    if (game.state != GameState::MENU || gStress.enabled) { gDemoRunning = false; return; }
+
+    if (!gDemoRunning) {
+        gDemo.profiles = game.profiles;
+        InitGame(gDemo, ++gDemoSeed, game.enemyCount, gWeather);
+        gDemo.state = GameState::PLAYING;
+        gDemoBot.keys = 0;
+        gDemoBot.holdTicks = 0;
+        gDemoRunning = true;
+    }
+    gDemo.weather = gWeather;
+    if (BotSimTick(gDemo, BotKeys(gDemoBot, gDemo), dt)) ResetGame(gDemo);
+}
 
 // -----------------------------------------------------------------------------------------
-// Reset everything needed for a new run:
-//   - Centre player near bottom
-//   - Spawn enemies above the screen with random sizes/speeds
-//   - Reset score
+// Ghost run: every run is recorded; the best one plays back alongside the next runs.
+// Runs start/end on the tick the state changes (prevState is the state before StepGame).
+// A new best only swaps buffers on the GAME_OVER tick; UpdateSaveData() saves it from the
+// next frame, outside the PLAYING frames that must not allocate.
 // -----------------------------------------------------------------------------------------
-void ResetGame(Player &player, std::vector<Enemy> &enemies, int enemyCount, float &score) {
-    // Player rectangle: centered horizontally, a bit above the bottom
-    player.rect = { SCREEN_W/2.0f - 18.0f, SCREEN_H - 70.0f, 36.0f, 36.0f };
-
-    // Start with a clean enemy list
-    enemies.clear();
-    enemies.reserve(enemyCount);
-
-    // --- : spawn based on current weather kind
-    for (int i = 0; i < enemyCount; ++i) {
-        int kind = (int)gWeather;
-        float x = (float)GetRandomValue(0, SCREEN_W - 40);
-        float y = (float)GetRandomValue(-SCREEN_H, -20);
-
-        float w, h, speed;
-        if (kind == 2) {
-            // RAIN: thin, long drops
-            w = (float)GetRandomValue(3, 6);
-            h = (float)GetRandomValue(14, 24);
-            speed = 180.0f + (float)GetRandomValue(40, 180);
-        } else if (kind == 1) {
-            // CLOUD: wider, slower puffs
-            w = (float)GetRandomValue(40, 72);
-            h = (float)GetRandomValue(24, 40);
-            speed = 100.0f + (float)GetRandomValue(20, 80);
-        } else {
-            // SUN: circles (use rect as bounds), medium
-            w = h = (float)GetRandomValue(18, 30);
-            speed = 140.0f + (float)GetRandomValue(20, 120);
+static void UpdateGhost(GameState prevState, const Game &game, float dt)
+{
+    if (gStress.enabled) return;
+
+    if (game.state == GameState::PLAYING) {
+        if (prevState != GameState::PLAYING) {
+            GhostRecordBegin(gGhostRec, game.player.rect);
+            GhostPlayBegin(gGhostPlay, &gGhost);
+            return;
+        }
+        GhostRecordTick(gGhostRec, game.player.rect, dt);
+        GhostPlayAdvance(gGhostPlay, dt);
+        return;
+    }
+
+    if (prevState == GameState::PLAYING) {
+        GhostRecordTick(gGhostRec, game.player.rect, dt);
+        GhostRecordEnd(gGhostRec, (int)game.score);
+        gGhostPlay = GhostPlayback{};
+        if (gGhostRec.ghost.header.score > gGhost.header.score) {
+            std::swap(gGhost, gGhostRec.ghost);
+            gGhostDirty = true;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+// Saved data: the GAME_OVER tick only adds the run in place. Frames that did not start in
+// PLAYING (they may allocate) take the stored files once they have loaded and queue what
+// changed; savedata.h writes it in the background.
+// -----------------------------------------------------------------------------------------
+static void UpdateSaveData(GameState prevState, const Game &game, float dt)
+{
+    if (gStress.enabled) return;
+
+    if (prevState == GameState::PLAYING) {
+        gRunSeconds += dt;
+        if (game.state != GameState::PLAYING) {
+            RunRecord run = { (long long)time(nullptr), (int)game.score, gRunSeconds, (int)game.weather, game.enemies.count };
+            SaveDataAddRun(gSave, run);
+            gSaveDirty = true;
+        }
+        return;
+    }
+    if (game.state == GameState::PLAYING) gRunSeconds = 0.0f;   // a run starts (this frame may still allocate)
+
+    // Stored files (once): merge the history, keep the better ghost (not while one plays back)
+    if (SaveTakeLoaded(SAVE_SLOT_DATA, gSaveBytes)) {
+        SaveData stored;
+        if (ParseSaveData(gSaveBytes, stored)) SaveDataMerge(gSave, stored);
+        else TraceLog(LOG_WARNING, "SAVE: ignoring %s (not a save file)", SAVE_PATHS[SAVE_SLOT_DATA]);
+    }
+    if (game.state != GameState::PLAYING && SaveTakeLoaded(SAVE_SLOT_GHOST, gSaveBytes)) {
+        Ghost stored;
+        if (!ParseGhost(gSaveBytes.data(), gSaveBytes.size(), stored)) {
+            TraceLog(LOG_WARNING, "SAVE: ignoring %s (not a ghost file)", SAVE_PATHS[SAVE_SLOT_GHOST]);
+        } else if (stored.header.score >= gGhost.header.score) {
+            gGhost = std::move(stored);
+            gGhostDirty = false;
+        }
+    }
+
+    if (gSaveDirty) {
+        gSaveBytes.resize(sizeof(SaveData));
+        memcpy(gSaveBytes.data(), &gSave, sizeof(SaveData));
+        SaveWrite(SAVE_SLOT_DATA, gSaveBytes);
+        gSaveDirty = false;
+    }
+    if (gGhostDirty) {
+        GhostToBytes(gGhost, gSaveBytes);
+        SaveWrite(SAVE_SLOT_GHOST, gSaveBytes);
+        gGhostDirty = false;
+    }
+    SavePoll();
+}
+
+// -----------------------------------------------------------------------------------------
+// Replay viewer (--view <file.dpk|file.rec>): runs instead of the game. Each frame steps as
+// many ticks as the speed asks for and draws only the last one; jumping anywhere on the
+// timeline is one block of the pack (replaypack.h), never a re-run from the start.
+//   SPACE pause, UP/DOWN speed, LEFT/RIGHT -/+5 s, HOME/END, click or drag the timeline
+// -----------------------------------------------------------------------------------------
+static const int VIEW_SPEEDS[] = { 1, 2, 5, 10, 25, 50, 100 };
+static const int VIEW_SPEED_COUNT = (int)(sizeof(VIEW_SPEEDS)/sizeof(VIEW_SPEEDS[0]));
+static const double VIEW_SEEK_SECONDS = 5.0;
+static const Rectangle VIEW_TIMELINE = { 20, SCREEN_H - 26, SCREEN_W - 40, 10 };
+
+// A pack as is, or a plain .rec packed on load (one run through the recording)
+static bool LoadViewerPack(const char *path, ReplayPack &pack)
+{
+    if (LoadReplayPack(path, pack)) return true;
+    Replay replay;
+    return LoadReplay(path, replay) && BuildReplayPack(replay, pack);
+}
+
+static int RunReplayViewer(const char *path)
+{
+    ReplayPack pack;
+    if (!LoadViewerPack(path, pack)) {
+        TraceLog(LOG_WARNING, "VIEW: %s is neither a recording nor a pack", path);
+        return 2;
+    }
+    const double duration = pack.header.duration;
+
+    Game game;
+    PackCursor cursor;
+    if (!PackSeek(pack, cursor, game, 0.0)) {
+        TraceLog(LOG_WARNING, "VIEW: %s is damaged", path);
+        return 2;
+    }
+    double target = 0.0;            // replay time the view is heading for
+    int speed = 0;
+    bool paused = false;
+
+    while (!WindowShouldClose()) {
+        // --- : controls (seeks are absolute; playback moves the target by speed * frame time)
+        double seekTo = -1.0;
+        if (IsKeyPressed(KEY_SPACE)) paused = !paused;
+        if (IsKeyPressed(KEY_UP) && speed < VIEW_SPEED_COUNT - 1) speed++;
+        if (IsKeyPressed(KEY_DOWN) && speed > 0) speed--;
+        if (IsKeyPressed(KEY_RIGHT)) seekTo = target + VIEW_SEEK_SECONDS;
+        if (IsKeyPressed(KEY_LEFT))  seekTo = fmax(target - VIEW_SEEK_SECONDS, 0.0);
+        if (IsKeyPressed(KEY_HOME))  seekTo = 0.0;
+        if (IsKeyPressed(KEY_END))   seekTo = duration;
+
+        Vector2 mouse = GetMousePosition();
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && mouse.y >= VIEW_TIMELINE.y - 12 && mouse.y <= VIEW_TIMELINE.y + VIEW_TIMELINE.height + 12) {
+            seekTo = duration*fmin(fmax((mouse.x - VIEW_TIMELINE.x)/VIEW_TIMELINE.width, 0.0), 1.0);
+        }
+
+        if (seekTo >= 0.0) {
+            target = fmin(seekTo, duration);
+            // Backwards or past the current block: restart from the target's keyframe
+            if (target < cursor.time || PackFindBlock(pack, target) != cursor.block) PackSeek(pack, cursor, game, target);
+        } else if (!paused) {
+            target = fmin(target + GetFrameTime()*VIEW_SPEEDS[speed], duration);
+        }
+
+        // Fast-forward: intermediate ticks are simulated, never drawn
+        while (cursor.time < target && PackStep(pack, cursor, game)) {}
+        if (target >= duration) paused = true;
+
+        // --- : draw the state the view landed on
+        BeginDrawing();
+        ClearBackground(SceneBackground(game.weather));
+        DrawWorld(game);
+        if (game.state != GameState::PLAYING) {
+            DrawRectangle(0, 0, SCREEN_W, SCREEN_H, SCENE_GAME_OVER_DIM);
+            const char *label = STATE_NAMES[(int)game.state];
+            DrawText(label, SCREEN_W/2 - MeasureText(label, 40)/2, 150, 40, RAYWHITE);
+        }
+
+        DrawText(TextFormat("Score: %d   Best: %d", (int)game.score, game.bestScore), 10, 10, 20, RAYWHITE);
+        DrawText(TextFormat("%02d:%04.1f / %02d:%04.1f   x%d%s", (int)(cursor.time/60), fmod(cursor.time, 60.0),
+                            (int)(duration/60), fmod(duration, 60.0), VIEW_SPEEDS[speed], paused ? "   PAUSED" : ""),
+                 10, SCREEN_H - 56, 20, RAYWHITE);
+        DrawText("SPACE pause  UP/DOWN speed  LEFT/RIGHT 5 s  drag timeline", SCREEN_W - 560, SCREEN_H - 56, 16, LIGHTGRAY);
+
+        // Timeline: a mark per keyframe, the playhead on top
+        DrawRectangleRec(VIEW_TIMELINE, Color{ 0, 0, 0, 120 });
+        for (const PackBlock &b : pack.index) {
+            float x = VIEW_TIMELINE.x + VIEW_TIMELINE.width*(float)(b.startTime/duration);
+            DrawRectangle((int)x, (int)VIEW_TIMELINE.y, 1, (int)VIEW_TIMELINE.height, GRAY);
+        }
+        float head = (duration > 0.0) ? (float)(cursor.time/duration) : 0.0f;
+        DrawRectangle((int)VIEW_TIMELINE.x, (int)VIEW_TIMELINE.y, (int)(VIEW_TIMELINE.width*head), (int)VIEW_TIMELINE.height, SCENE_PLAYER);
+        EndDrawing();
+    }
+    return 0;
+}
+
+#ifndef __EMSCRIPTEN__
+// Desktop network options: versus, broadcasting to a spectator relay, spectating
+static const int VERSUS_PORT = 47700;
+
+struct NetOptions {
+    int versusPlayer = -1;              // --versus 0|1 (-1 = no versus)
+    const char *peer = "127.0.0.1";     // --peer: the other player, or the relay
+    int port = VERSUS_PORT;             // --port: versus base port
+    float lagMs = 0.0f, lossPct = 0.0f; // --lag, --loss: versus test conditions
+    int broadcastPort = 0;              // --broadcast: the relay's source port (tools/relay.cpp)
+    int spectatePort = 0;               // --spectate: the relay's spectator port
+};
+
+static SpecSource gSpec;                // --broadcast: this game's stream to the relay
+
+// -----------------------------------------------------------------------------------------
+// Versus (--versus <0|1>): runs instead of the game. Player p listens on port + p and
+// talks to the other instance at --peer (default 127.0.0.1) on port + 1 - p; player 0's
+// seed is used. Ticks run at a fixed VERSUS_DT (rollback.h keeps the two sims in step);
+// --lag ms / --loss percent make the link worse on purpose (NetLag) for testing.
+// -----------------------------------------------------------------------------------------
+static const int VERSUS_CATCH_UP = 4;                          // most ticks per frame after a hitch
+static const Color VERSUS_REMOTE = { 240, 120, 200, 255 };      // the other player (pink)
+
+static int RunVersus(const NetOptions &opt, int enemies)
+{
+    const int local = opt.versusPlayer, remote = 1 - opt.versusPlayer;
+    int fd = NetBindUdp("0.0.0.0", opt.port + local);
+    sockaddr_in peer;
+    if (fd < 0 || !NetAddress(opt.peer, opt.port + remote, peer)) {
+        TraceLog(LOG_WARNING, "VERSUS: cannot bind port %d or bad peer address %s", opt.port + local, opt.peer);
+        NetClose(fd);
+        return 2;
+    }
+    std::unique_ptr<NetLag> lag(new NetLag);
+    lag->latency = opt.lagMs/1000.0;
+    lag->loss = opt.lossPct/100.0f;
+
+    std::unique_ptr<RollbackSession> session(new RollbackSession);
+    std::unique_ptr<Versus> versus(new Versus);
+    RollbackSession &s = *session;
+    Versus &v = *versus;
+    RollbackInit(s, local, (unsigned long long)time(nullptr));
+    bool playing = false;
+    double clock = 0.0, pending = 0.0;  // real time; time owed to the sim
+
+    while (!WindowShouldClose()) {
+        const float frameTime = GetFrameTime();
+        clock += frameTime;
+
+        // --- : network in, then up to VERSUS_CATCH_UP fixed ticks (each one settles rollbacks first)
+        unsigned char buffer[256];
+        int n;
+        while ((n = NetRecvUdp(fd, buffer, sizeof(buffer))) >= 0) RollbackOnPacket(s, buffer, n);
+        if (s.started && !playing) {
+            VersusInit(v, s.seed, enemies);
+            playing = true;
+        }
+
+        const unsigned char keys = ReadMoveKeys();
+        if (playing) pending = fmin(pending + frameTime, VERSUS_CATCH_UP*(double)VERSUS_DT);
+        for (int t = 0; t < VERSUS_CATCH_UP && pending >= VERSUS_DT; ++t) {
+            if (!RollbackAdvance(s, v, keys)) break;       // waiting for the peer: the time stays owed
+            pending -= VERSUS_DT;
         }
 
-        enemies.push_back({ Rectangle{ x, y, w, h }, speed, kind });
+        RollbackPacket pkt;
+        RollbackMakePacket(s, pkt);
+        NetLagSend(*lag, fd, peer, &pkt, sizeof(pkt), clock);
+        NetLagFlush(*lag, fd, peer, clock);
+
+        // --- : draw (the predicted present; a rollback may move things a little next frame)
+        const VersusPlayers &p = v.players;
+        BeginDrawing();
+        ClearBackground(SceneBackground(WeatherKind::SUNNY));
+        if (!playing) {
+            const char *wait = TextFormat("Player %d: waiting for %s:%d", local + 1, opt.peer, opt.port + remote);
+            DrawText(wait, SCREEN_W/2 - MeasureText(wait, 24)/2, 200, 24, LIGHTGRAY);
+            EndDrawing();
+            continue;
+        }
+
+        DrawEnemies(v.field.enemies);
+        DrawRectangleRounded(p.player[remote].rect, PLAYER_ROUNDNESS, 6, Fade(VERSUS_REMOTE, p.alive[remote] ? 1.0f : 0.3f));
+        DrawRectangleRounded(p.player[local].rect, PLAYER_ROUNDNESS, 6, Fade(SCENE_PLAYER, p.alive[local] ? 1.0f : 0.3f));
+
+        DrawText(TextFormat("You: %d", (int)p.score[local]), 10, 10, 22, SCENE_PLAYER);
+        DrawText(TextFormat("Them: %d", (int)p.score[remote]), 10, 36, 22, VERSUS_REMOTE);
+        const char *wins = TextFormat("Round %d   Wins %d - %d", p.round + 1, p.wins[local], p.wins[remote]);
+        DrawText(wins, SCREEN_W - MeasureText(wins, 20) - 10, 10, 20, RAYWHITE);
+        DrawText(TextFormat("ahead %d   rollbacks %d (max %d)   stalls %d", RollbackAhead(s), s.stats.rollbacks,
+                            s.stats.maxDepth, s.stats.stalls), 10, SCREEN_H - 24, 16, GRAY);
+
+        if (p.overTicks >= 0) {
+            DrawRectangle(0, 0, SCREEN_W, SCREEN_H, SCENE_GAME_OVER_DIM);
+            const char *result = (p.score[local] > p.score[remote]) ? "YOU WIN" :
+                                 (p.score[local] < p.score[remote]) ? "THEY WIN" : "DRAW";
+            DrawText(result, SCREEN_W/2 - MeasureText(result, 50)/2, 150, 50, RAYWHITE);
+        }
+        EndDrawing();
+    }
+    NetClose(fd);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------
+// Spectator (--spectate <port>): runs instead of the game and draws the stream a relay
+// (tools/relay.cpp) forwards from a game started with --broadcast (spectate.h)
+// -----------------------------------------------------------------------------------------
+static int RunSpectator(const NetOptions &opt)
+{
+    int fd = NetConnectTcp(opt.peer, opt.spectatePort);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "SPECTATE: no relay at %s:%d", opt.peer, opt.spectatePort);
+        return 2;
     }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    std::unique_ptr<SpecReader> reader(new SpecReader);
+    std::unique_ptr<SpecState> state(new SpecState);
+    Game game;
+    bool shown = false, ended = false;
+    unsigned long errors = 0;
+
+    while (!WindowShouldClose()) {
+        // --- : every frame that arrived is decoded (deltas chain), only the last one is drawn
+        unsigned char buffer[16*1024];
+        ssize_t n;
+        while (!ended && (n = recv(fd, buffer, sizeof(buffer), 0)) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ended = (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+            SpecReaderFeed(*reader, buffer, (size_t)n);
+            const unsigned char *frame;
+            size_t size;
+            int got;
+            while ((got = SpecReaderNext(*reader, frame, size)) == 1) {
+                if (SpecDecode(*state, frame, size)) shown = true;
+                else if (state->valid || SpecIsKeyframe(frame)) errors++;   // not just waiting for a keyframe
+            }
+            if (got < 0) ended = true;
+        }
+        if (n == 0) ended = true;
+        if (shown) SpecToGame(*state, game);
 
-    // Score is time-based (accumulates while you survive)
-    score = 0.0f;
+        BeginDrawing();
+        ClearBackground(SceneBackground(game.weather));
+        if (shown) {
+            DrawWorld(game);
+            if (game.state != GameState::PLAYING) {
+                DrawRectangle(0, 0, SCREEN_W, SCREEN_H, SCENE_GAME_OVER_DIM);
+                const char *label = STATE_NAMES[(int)game.state];
+                DrawText(label, SCREEN_W/2 - MeasureText(label, 40)/2, 150, 40, RAYWHITE);
+            }
+            DrawText(TextFormat("Score: %d   Best: %d", (int)game.score, game.bestScore), 10, 10, 20, RAYWHITE);
+        } else {
+            const char *wait = "Waiting for the next keyframe...";
+            DrawText(wait, SCREEN_W/2 - MeasureText(wait, 24)/2, 200, 24, LIGHTGRAY);
+        }
+        DrawText(TextFormat("Spectating %s:%d   tick %u%s%s", opt.peer, opt.spectatePort, state->tick,
+                            state->valid ? "" : "   (resyncing)", ended ? "   STREAM ENDED" : ""), 10, SCREEN_H - 24, 16, GRAY);
+        if (errors > 0) DrawText(TextFormat("%lu damaged frames", errors), SCREEN_W - 180, SCREEN_H - 24, 16, GRAY);
+        EndDrawing();
+    }
+    NetClose(fd);
+    return 0;
 }
+#endif
+
+int main(int argc, char **argv) {
+    // -------------------------------------------------------------------------------------
+    // Command line (desktop) / URL query (web), parsed once:
+    //   --record <file> writes every tick's input for the headless tools (and <file>.hashes)
+    //   --view <file> opens the replay viewer instead of the game
+    //   --versus <0|1> [--peer ip] [--port n] [--lag ms] [--loss pct] plays another instance
+    //   --broadcast <port> streams the game to a spectator relay at --peer (tools/relay.cpp)
+    //   --spectate <port> watches a relay's stream instead of playing
+    //   --fixed (?fixed=1) uses the fixed-point tick; recordings remember it (stress.h parses it)
+    //   --stress ... see stress.h
+    // -------------------------------------------------------------------------------------
+    const char *recordPath = nullptr, *viewPath = nullptr;
+#ifndef __EMSCRIPTEN__
+    NetOptions netOpt;
+#endif
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc) recordPath = argv[++i];
+        if (!strcmp(argv[i], "--view") && i + 1 < argc) viewPath = argv[++i];
+#ifndef __EMSCRIPTEN__
+        if (!strcmp(argv[i], "--versus") && i + 1 < argc) netOpt.versusPlayer = (atoi(argv[++i]) == 1) ? 1 : 0;
+        if (!strcmp(argv[i], "--peer") && i + 1 < argc) netOpt.peer = argv[++i];
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) netOpt.port = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--lag") && i + 1 < argc) netOpt.lagMs = (float)atof(argv[++i]);
+        if (!strcmp(argv[i], "--loss") && i + 1 < argc) netOpt.lossPct = (float)atof(argv[++i]);
+        if (!strcmp(argv[i], "--broadcast") && i + 1 < argc) netOpt.broadcastPort = atoi(argv[++i]);
+        if (!strcmp(argv[i], "--spectate") && i + 1 < argc) netOpt.spectatePort = atoi(argv[++i]);
+#endif
+    }
+    StressParseArgs(gStress, argc, argv);
+#ifdef __EMSCRIPTEN__
+    {
+        const char *query = emscripten_run_script_string("window.location.search");
+        StressParseQuery(gStress, query);
+    }
+#endif
+    if (gStress.enabled && recordPath) {
+        TraceLog(LOG_WARNING, "REPLAY: --record is ignored in stress mode (the ramp is not part of the input)");
+        recordPath = nullptr;
+    }
+#ifndef __EMSCRIPTEN__
+    if (gStress.enabled && netOpt.broadcastPort > 0) {
+        TraceLog(LOG_WARNING, "SPECTATE: --broadcast is ignored in stress mode");
+        netOpt.broadcastPort = 0;
+    }
+#endif
+    if (recordPath) {
+        TraceLog(LOG_WARNING, "TUNING: %s is ignored while recording (replays use the built-in profiles)", TUNING_FILE);
+    }
 
-int main() {
     // -------------------------------------------------------------------------------------
     // Window + timing setup
     // -------------------------------------------------------------------------------------
     InitWindow(SCREEN_W, SCREEN_H, "Dodge");
-    SetTargetFPS(60); // lock to 60 FPS; GetFrameTime() still gives real delta-time
+    SetTargetFPS(gStress.enabled ? 0 : 60); // lock to 60 FPS; GetFrameTime() still gives real delta-time (stress: uncapped)
+    FrameStatsReset(60);
+    if (viewPath) {
+        int code = RunReplayViewer(viewPath);
+        CloseWindow();
+        return code;
+    }
+#ifndef __EMSCRIPTEN__
+    if (netOpt.versusPlayer >= 0) {
+        int code = RunVersus(netOpt, gStress.enemies);
+        CloseWindow();
+        return code;
+    }
+    if (netOpt.spectatePort > 0) {
+        int code = RunSpectator(netOpt);
+        CloseWindow();
+        return code;
+    }
+#endif
+    TraceOpen();
 
     // -------------------------------------------------------------------------------------
-    // Game state + entities + score
+    // Game state + entities + score (see game.h)
+    //   - starts at the MENU; the first run is reset already so there is a baseline
     // -------------------------------------------------------------------------------------
-    GameState state = GameState::MENU;   // start at menu
+    const unsigned long long seed = (unsigned long long)time(nullptr);
+    gDemoSeed = seed*0x9E3779B97F4A7C15ull;   // demo runs differ from the real ones
 
-    Player player{};                     // will be positioned in ResetGame()
-    std::vector<Enemy> enemies;          // container for falling enemies
-    float score = 0.0f;                  // current run score (seconds * 60)
-    int bestScore = 0;                   // best score across runs (integer)
-
-    const int ENEMY_COUNT = 10;          // how many enemies to manage
-
-    // Initialise the first run (even though start is MENU, this sets baseline)
-    ResetGame(player, enemies, ENEMY_COUNT, score);
+    Game game;
+    if (!recordPath) {
+        TuningLoad(game.profiles);
+        TuningWatchStart(game.profiles);
+    }
+    game.fixedPoint = gStress.fixedPoint;
+    InitGame(game, seed, gStress.enemies, gWeather);   // 10 enemies unless --enemies says otherwise
+    StressSetup(gStress, game);
+
+    // Saved best score/history/ghost: loading starts now and lands a few frames later
+    SaveDataInit(gSave);
+    if (!gStress.enabled) SaveStart();
+
+    ReplayRecorder recorder;
+    TickHashRecorder hashRecorder;
+    if (recordPath && !ReplayRecordBegin(recorder, recordPath, game, seed)) {
+        TraceLog(LOG_WARNING, "REPLAY: could not write %s", recordPath);
+    }
+    if (recorder.file) {
+        char hashPath[512];
+        snprintf(hashPath, sizeof(hashPath), "%s.hashes", recordPath);
+        game.hashTicks = TickHashRecordBegin(hashRecorder, hashPath);
+    }
+#ifndef __EMSCRIPTEN__
+    if (netOpt.broadcastPort > 0 && !SpecSourceOpen(gSpec, netOpt.peer, netOpt.broadcastPort, game.enemies.capacity())) {
+        TraceLog(LOG_WARNING, "SPECTATE: no relay at %s:%d", netOpt.peer, netOpt.broadcastPort);
+    }
+#endif
 
     // -------------------------------------------------------------------------------------
     // Main game loop
     //   - Runs until the user closes the window (Esc or close button)
     // -------------------------------------------------------------------------------------
     while (!WindowShouldClose()) {
+        TraceFrameBegin();
+        bool steadyFrame = (game.state == GameState::PLAYING);   // no ResetGame / setup this frame
+
+        // Record last frame's duration (includes the vsync wait, so hitches show up)
+        FrameStatsAdd(GetFrameTime());
+
         // =============================================================================
         // UPDATE (handle input, move entities, detect collisions, update score)
         // =============================================================================
 
-        if (state == GameState::MENU) {
-            // On menu, wait for SPACE/ENTER to start a new game
-            if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) {
-                ResetGame(player, enemies, ENEMY_COUNT, score);
-                state = GameState::PLAYING;
-            }
-        }
-        else if (state == GameState::PLAYING) {
-            // ------------------------------
-            // 1) Player input and movement
-            // ------------------------------
-
-            // Movement direction vector (unit-length after normalisation)
-            Vector2 move{0, 0};
-
-            // Support both Arrows and WASD
-            if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) move.x += 1;
-            if (IsKeyDown(KEY_LEFT)  || IsKeyDown(KEY_A)) move.x -= 1;
-            if (IsKeyDown(KEY_DOWN)  || IsKeyDown(KEY_S)) move.y += 1;
-            if (IsKeyDown(KEY_UP)    || IsKeyDown(KEY_W)) move.y -= 1;
-
-            // Normalise diagonal movement so speed stays consistent in all directions
-            if (move.x != 0 || move.y != 0) {
-                float len = sqrtf(move.x*move.x + move.y*move.y);
-                move.x /= len; 
-                move.y /= len;
-            }
+        ProfileHandleInput();
+        TraceHandleInput();
 
-            // Move the player by (speed * deltaTime)
-            float dt = GetFrameTime();
-            player.rect.x += move.x * player.speed * dt;
-            player.rect.y += move.y * player.speed * dt;
-
-            // Keep player fully on screen (clamp)
-            if (player.rect.x < 0) player.rect.x = 0;
-            if (player.rect.y < 0) player.rect.y = 0;
-            if (player.rect.x + player.rect.width > SCREEN_W) 
-                player.rect.x = SCREEN_W - player.rect.width;
-            if (player.rect.y + player.rect.height > SCREEN_H) 
-                player.rect.y = SCREEN_H - player.rect.height;
-
-            // Debug keys (desktop/web) to cycle weather quickly (optional)
-            if (IsKeyPressed(KEY_F1)) { gWeather = WeatherKind::SUNNY; }
-            if (IsKeyPressed(KEY_F2)) { gWeather = WeatherKind::CLOUDY; }
-            if (IsKeyPressed(KEY_F3)) { gWeather = WeatherKind::RAINY; }
-
-            // ------------------------------
-            // 2) Enemies: fall + recycle + collide
-            // ------------------------------
-            for (auto &e : enemies) {
-                // Fall down by speed * dt
-                e.rect.y += e.speedY * dt;
-
-                // If this enemy goes below the bottom, recycle it above the screen
-                if (e.rect.y > SCREEN_H + 10) {
-                    e.rect.y = (float)GetRandomValue(-200, -20);              // back above
-                    e.rect.x = (float)GetRandomValue(0, SCREEN_W - (int)e.rect.width); // new X
-
-                    // keep same kind, new speed within kind range
-                    if (e.kind == 2) e.speedY = 180.0f + (float)GetRandomValue(40, 180);
-                    else if (e.kind == 1) e.speedY = 100.0f + (float)GetRandomValue(20, 80);
-                    else e.speedY = 140.0f + (float)GetRandomValue(20, 120);
-                }
-
-                // Collision: if any enemy overlaps the player, game over
-                if (CheckCollisionRecs(player.rect, e.rect)) {
-                    state = GameState::GAME_OVER;
-
-                    // Update best score if current score is higher
-                    if ((int)score > bestScore) bestScore = (int)score;
-                }
-            }
+        GameInput input;
+        {
+            PROFILE_SCOPE(PROF_INPUT);
+            input = ReadInput(game);
+        }
 
-            // ------------------------------
-            // 3) Scoring
-            // ------------------------------
-            // Score increases as long as you survive.
-            // add 60 per second to feel like "points per second" 
-            score += 60.0f * dt;
+        TuningPoll(game);   // profiles saved since last frame (hot reload)
+        ReplayRecordTick(recorder, input);
+        const GameState prevState = game.state;
+        StepGame(game, input);
+        if (game.hashTicks) TickHashRecordTick(hashRecorder, game.tickHash);
+        UpdateGhost(prevState, game, input.dt);
+        UpdateSaveData(prevState, game, input.dt);
+        StressUpdate(gStress, gStressState, game, input.dt);
+#ifndef __EMSCRIPTEN__
+        SpecSourceTick(gSpec, game);
+#endif
+        UpdateAttractMode(game, input.dt);
 
-        }
-        else if (state == GameState::GAME_OVER) {
-            // From the GAME OVER screen, allow restart or return to menu
-            if (IsKeyPressed(KEY_R)) {
-                ResetGame(player, enemies, ENEMY_COUNT, score);
-                state = GameState::PLAYING;
-            }
-            if (IsKeyPressed(KEY_ESCAPE)) {
-                // ESC to go back to the MENU from GAME OVER
-                state = GameState::MENU;
-            }
-        }
+        // Short names for the draw code below
+        const GameState state = game.state;
+        const float score = game.score;
+        const int bestScore = (gSave.bestScore > game.bestScore) ? gSave.bestScore : game.bestScore;
 
         // =============================================================================
         // DRAW (render the current state)
         // =============================================================================
         BeginDrawing();
 
-        // --- : background colour depends on weather 
-        Color bg = {18,18,18,255};
-        if (gWeather == WeatherKind::SUNNY)      bg = Color{ 20, 24, 34, 255 };  // bluish
-        else if (gWeather == WeatherKind::CLOUDY) bg = Color{ 35, 35, 45, 255 }; // dark grey
-        else if (gWeather == WeatherKind::RAINY)  bg = Color{ 15, 18, 30, 255 }; // deep blue
-        ClearBackground(bg);
+        {
+            PROFILE_SCOPE(PROF_DRAW);
+
+            // --- : background colour depends on weather (SCENE_* colours are shared with raster.h)
+            ClearBackground(SceneBackground(gWeather));
+        }
 
         if (state == GameState::MENU) {
             // -------------- MENU SCREEN --------------
+            if (gDemoRunning) {
+                PROFILE_SCOPE(PROF_DRAW);
+                DrawWorld(gDemo);
+                DrawRectangle(0, 0, SCREEN_W, SCREEN_H, Color{ 0, 0, 0, 150 });   // keep the text readable
+            }
+
+            PROFILE_SCOPE(PROF_HUD);
             const char *title = "DODGE THE WEATHER";
             int titleSize = 60;
             int tw = MeasureText(title, titleSize);
@@ -263,36 +763,25 @@ int main() {
             DrawText("Press SPACE to start",          280, 280, 24, LIGHTGRAY);
 
             DrawText(TextFormat("Best: %d", bestScore), 10, 10, 20, GRAY);
+            if (gSave.runs > 0) {
+                const RunRecord &last = SaveDataRecent(gSave, 0);
+                DrawText(TextFormat("Runs: %d   Last: %d (%.0f s)", gSave.runs, last.score, last.seconds), 10, 34, 20, GRAY);
+            }
+            if (gDemoRunning) DrawText(TextFormat("Demo: %d", (int)gDemo.score), 10, SCREEN_H - 30, 20, GRAY);
         }
 
         if (state == GameState::PLAYING) {
             // -------------- GAMEPLAY RENDER --------------
 
-            // Draw player (rounded green square)
-            DrawRectangleRounded(player.rect, 0.2f, 6, Color{ 80, 200, 120, 255 });
-
-            // --- : Draw enemies by type (sun/cloud/rain)
-            for (auto &e : enemies) {
-                if (e.kind == 2) {
-                    // RAIN: blue thin rect
-                    DrawRectangleRec(e.rect, Color{ 70, 140, 255, 255 });
-                } else if (e.kind == 1) {
-                    // CLOUD: three overlapping white circles inside the rect area
-                    float cx = e.rect.x + e.rect.width*0.5f;
-                    float cy = e.rect.y + e.rect.height*0.6f;
-                    float r1 = e.rect.height*0.55f;
-                    float r2 = r1*0.85f, r3 = r1*0.85f;
-                    DrawCircle((int)cx,               (int)cy,   (int)r1, RAYWHITE);
-                    DrawCircle((int)(cx - r1*0.9f),   (int)(cy+2),(int)r2, RAYWHITE);
-                    DrawCircle((int)(cx + r1*0.9f),   (int)(cy+2),(int)r3, RAYWHITE);
-                } else {
-                    // SUN: yellow circle
-                    float r = e.rect.width * 0.5f;
-                    DrawCircle((int)(e.rect.x + r), (int)(e.rect.y + r), (int)r, Color{ 250, 210, 60, 255 });
-                }
+            {
+                PROFILE_SCOPE(PROF_DRAW);
+                Rectangle ghost;
+                if (gGhostPlay.ghost) ghost = GhostPlayRect(gGhostPlay);
+                DrawWorld(game, gGhostPlay.ghost ? &ghost : nullptr);
             }
 
             // HUD: Score and FPS
+            PROFILE_SCOPE(PROF_HUD);
             DrawText(TextFormat("Score: %d", (int)score), 10, 10, 22, RAYWHITE);
             DrawText(TextFormat("London weather: %s", WeatherName()), 10, 40, 20, RAYWHITE);
 
@@ -300,9 +789,10 @@ int main() {
 
         if (state == GameState::GAME_OVER) {
             // -------------- GAME OVER OVERLAY --------------
+            PROFILE_SCOPE(PROF_HUD);
 
             // Dim the current frame
-            DrawRectangle(0, 0, SCREEN_W, SCREEN_H, Color{0, 0, 0, 130});
+            DrawRectangle(0, 0, SCREEN_W, SCREEN_H, SCENE_GAME_OVER_DIM);
 
             // Big title
             const char* over = "GAME OVER";
@@ -317,12 +807,35 @@ int main() {
             DrawText("Press ESC for Menu", SCREEN_W/2 - 120, 300, 20, GRAY);
         }
 
-        EndDrawing();
+        // Profiler overlay (F4) and stress readout - drawn outside the timed phases
+        ProfileDrawOverlay(SCREEN_W);
+        StressDrawOverlay(gStress, gStressState, game);
+
+        {
+            PROFILE_SCOPE(PROF_PRESENT);
+            EndDrawing();
+        }
+        ProfileEndFrame();
+        AllocStatsEndFrame(steadyFrame);
+        TraceFrameEnd();
+        TraceFlushIfIdle(state == GameState::PLAYING);
     }
 
     // -------------------------------------------------------------------------------------
     // 
     // -------------------------------------------------------------------------------------
+    ProfileDump("profile.csv", "profile.json");
+    FrameStatsPrint();
+    PrintEnemyPoolStats(game.enemies);
+    TraceClose();
+    ReplayRecordEnd(recorder);
+    TickHashRecordEnd(hashRecorder);
+#ifndef __EMSCRIPTEN__
+    SpecSourceClose(gSpec);
+#endif
+    TuningWatchStop();
+    SaveStop();
+    unsigned long allocatingFrames = AllocStatsReport(PROF_NAMES, PROF_PHASE_COUNT);
     CloseWindow();
-    return 0;
+    return (allocatingFrames > 0) ? 1 : 0;   // only non-zero in a DODGE_ALLOC_STATS build
 }
@@ -0,0 +1,196 @@
+/*******************************************************************************************
+* net.h - thin socket helpers for the desktop/headless tools (POSIX sockets)
+*
+*   - TCP: NetListenTcp() / NetAccept() / NetConnectTcp(), then NetSendAll() / NetRecvAll()
+*     move whole messages (they loop over partial reads and writes)
+*   - UDP: NetBindUdp() gives a non-blocking socket; NetSendUdp() / NetRecvUdp() move one
+*     datagram. NetLag delays, reorders and drops outgoing datagrams to test netcode on loopback.
+*   - Sockets are plain file descriptors; -1 is "no socket"
+*   - Sends never raise SIGPIPE: a closed peer shows up as a false return
+*   - Not used by the web build (no raw sockets in the browser)
+*******************************************************************************************/
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#ifndef MSG_NOSIGNAL
+  #define MSG_NOSIGNAL 0
+#endif
+
+inline bool NetAddress(const char *host, int port, sockaddr_in &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    return inet_pton(AF_INET, host, &addr.sin_addr) == 1;
+}
+
+inline void NetClose(int fd)
+{
+    if (fd >= 0) close(fd);
+}
+
+// Small request/response messages: send each one now instead of waiting to batch (Nagle)
+inline void NetNoDelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// -----------------------------------------------------------------------------------------
+// TCP
+// -----------------------------------------------------------------------------------------
+inline int NetListenTcp(const char *host, int port, int backlog)
+{
+    sockaddr_in addr;
+    if (!NetAddress(host, port, addr)) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, backlog) != 0) {
+        NetClose(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int NetAccept(int listenFd)
+{
+    int fd;
+    do fd = accept(listenFd, nullptr, nullptr); while (fd < 0 && errno == EINTR);
+    if (fd >= 0) NetNoDelay(fd);
+    return fd;
+}
+
+inline int NetConnectTcp(const char *host, int port)
+{
+    sockaddr_in addr;
+    if (!NetAddress(host, port, addr)) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        NetClose(fd);
+        return -1;
+    }
+    NetNoDelay(fd);
+    return fd;
+}
+
+inline bool NetSendAll(int fd, const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// False on error or when the peer closed before size bytes arrived
+inline bool NetRecvAll(int fd, void *data, size_t size)
+{
+    char *p = (char *)data;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// UDP
+// -----------------------------------------------------------------------------------------
+inline int NetBindUdp(const char *host, int port)
+{
+    sockaddr_in addr;
+    if (!NetAddress(host, port, addr)) return -1;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        NetClose(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool NetSendUdp(int fd, const sockaddr_in &to, const void *data, size_t size)
+{
+    return sendto(fd, data, size, MSG_NOSIGNAL, (const sockaddr *)&to, sizeof(to)) == (ssize_t)size;
+}
+
+// Bytes of the next datagram, or -1 when none is waiting (never blocks)
+inline int NetRecvUdp(int fd, void *data, size_t capacity)
+{
+    ssize_t n;
+    do n = recv(fd, data, capacity, 0); while (n < 0 && errno == EINTR);
+    return (n < 0) ? -1 : (int)n;
+}
+
+// -----------------------------------------------------------------------------------------
+// NetLag: a bad network between two sockets on one machine. Outgoing datagrams are dropped
+// with probability `loss`, the rest held back for latency + up to `jitter` seconds (so they
+// can arrive out of order). Times are the caller's clock, in seconds. Fixed storage.
+// -----------------------------------------------------------------------------------------
+static const int NET_LAG_SLOTS = 256;
+static const int NET_LAG_BYTES = 128;
+
+struct NetLagSlot {
+    double due;
+    int size;
+    unsigned char bytes[NET_LAG_BYTES];
+};
+
+struct NetLag {
+    double latency = 0.0, jitter = 0.0;     // seconds, one way
+    float loss = 0.0f;                      // 0..1
+    unsigned long long rng = 0x9E3779B97F4A7C15ull;
+    NetLagSlot slots[NET_LAG_SLOTS];
+    int count = 0;
+    unsigned long sent = 0, dropped = 0;
+};
+
+inline double NetLagRandom(NetLag &lag)
+{
+    lag.rng ^= lag.rng << 13;
+    lag.rng ^= lag.rng >> 7;
+    lag.rng ^= lag.rng << 17;
+    return (double)(lag.rng >> 11)*(1.0/9007199254740992.0);
+}
+
+inline void NetLagSend(NetLag &lag, int fd, const sockaddr_in &to, const void *data, size_t size, double now)
+{
+    lag.sent++;
+    if (NetLagRandom(lag) < lag.loss || size > NET_LAG_BYTES || lag.count == NET_LAG_SLOTS) { lag.dropped++; return; }
+    if (lag.latency <= 0.0 && lag.jitter <= 0.0) { NetSendUdp(fd, to, data, size); return; }
+
+    NetLagSlot &slot = lag.slots[lag.count++];
+    slot.due = now + lag.latency + lag.jitter*NetLagRandom(lag);
+    slot.size = (int)size;
+    memcpy(slot.bytes, data, size);
+}
+
+// Sends whatever is due by `now`
+inline void NetLagFlush(NetLag &lag, int fd, const sockaddr_in &to, double now)
+{
+    for (int i = 0; i < lag.count; ) {
+        if (lag.slots[i].due > now) { ++i; continue; }
+        NetSendUdp(fd, to, lag.slots[i].bytes, (size_t)lag.slots[i].size);
+        lag.slots[i] = lag.slots[--lag.count];
+    }
+}
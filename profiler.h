@@ -0,0 +1,175 @@
+/*******************************************************************************************
+* profiler.h - per-phase frame profiler for "Dodge!"
+*
+*   - PROFILE_SCOPE(phase) times the enclosing block and adds it to the current frame
+*   - ProfileEndFrame() pushes the frame into a rolling window (averages + max)
+*   - F4 toggles an on-screen overlay, ProfileDump() writes CSV + JSON on exit
+*
+* Compile-time switch: build with -DDODGE_PROFILE to enable. Without it every macro
+* expands to nothing, so the shipped game pays zero cost. With -DDODGE_TRACE the same
+* PROFILE_SCOPE blocks also emit trace events (see trace.h), and with -DDODGE_ALLOC_STATS
+* they count heap allocations per phase (see allocstats.h).
+*******************************************************************************************/
+
+#pragma once
+
+#include "trace.h"
+#include "allocstats.h"
+
+// Phases of one frame of the main loop (order = overlay/CSV column order)
+enum ProfilePhase {
+    PROF_INPUT = 0,     // key polling
+    PROF_PLAYER,        // player movement + clamp
+    PROF_ENEMIES,       // fall + recycle
+    PROF_COLLISION,     // player vs enemies
+    PROF_DRAW,          // background + entities
+    PROF_HUD,           // text (TextFormat + DrawText)
+    PROF_PRESENT,       // EndDrawing (buffer swap + frame pacing wait)
+    PROF_PHASE_COUNT
+};
+
+static const char *const PROF_NAMES[PROF_PHASE_COUNT] = {
+    "input", "player", "enemies", "collision", "draw", "hud", "present"
+};
+
+#ifdef DODGE_PROFILE
+
+#include "raylib.h"
+#include <chrono>
+#include <cstdio>
+
+static const int PROF_WINDOW  = 120;   // frames in the rolling average (2 s at 60 FPS)
+static const int PROF_HISTORY = 3600;  // frames kept for the CSV dump (1 min at 60 FPS)
+
+struct ProfileData {
+    double current[PROF_PHASE_COUNT];                // ms spent this frame
+    float  history[PROF_HISTORY][PROF_PHASE_COUNT];  // ring of past frames (ms)
+    double windowSum[PROF_PHASE_COUNT];              // sum of the last PROF_WINDOW frames
+    double total[PROF_PHASE_COUNT];                  // whole-session sum
+    double maxMs[PROF_PHASE_COUNT];                  // whole-session max
+    long   frames;                                   // frames recorded so far
+    bool   overlay;
+};
+
+static ProfileData gProfile = {};
+
+static inline double ProfileNowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Times the enclosing scope and accumulates it into the current frame
+struct ProfileScope {
+    ProfilePhase phase;
+    double start;
+    explicit ProfileScope(ProfilePhase p) : phase(p), start(ProfileNowMs()) {}
+    ~ProfileScope() { gProfile.current[phase] += ProfileNowMs() - start; }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_TIMER_SCOPE(phase) ProfileScope PROFILE_CONCAT(_profScope, __LINE__)(phase)
+
+// Close the current frame: move it into the ring and update rolling/session stats
+static void ProfileEndFrame()
+{
+    ProfileData &p = gProfile;
+    int slot = (int)(p.frames % PROF_HISTORY);
+    // The ring slot PROF_WINDOW frames back leaves the rolling window now
+    int oldSlot = (int)((p.frames - PROF_WINDOW + PROF_HISTORY) % PROF_HISTORY);
+
+    for (int i = 0; i < PROF_PHASE_COUNT; ++i) {
+        double ms = p.current[i];
+        if (p.frames >= PROF_WINDOW) p.windowSum[i] -= p.history[oldSlot][i];
+        p.history[slot][i] = (float)ms;
+        p.windowSum[i] += (float)ms;
+        p.total[i] += ms;
+        if (ms > p.maxMs[i]) p.maxMs[i] = ms;
+        p.current[i] = 0.0;
+    }
+    p.frames++;
+}
+
+static void ProfileHandleInput()
+{
+    if (IsKeyPressed(KEY_F4)) gProfile.overlay = !gProfile.overlay;
+}
+
+// Small table in the top-right corner: rolling average, rolling max, session max
+static void ProfileDrawOverlay(int screenW)
+{
+    const ProfileData &p = gProfile;
+    if (!p.overlay) return;
+
+    int n = (p.frames < PROF_WINDOW) ? (int)p.frames : PROF_WINDOW;
+    if (n == 0) return;
+
+    const int x = screenW - 290, lineH = 14;
+    int y = 70;
+    DrawRectangle(x - 6, y - 4, 292, lineH*(PROF_PHASE_COUNT + 2) + 6, Color{ 0, 0, 0, 170 });
+    DrawText("phase        avg ms   max ms   peak ms", x, y, 10, LIGHTGRAY);
+    y += lineH;
+
+    double frameAvg = 0.0;
+    for (int i = 0; i < PROF_PHASE_COUNT; ++i) {
+        double windowMax = 0.0;
+        for (int k = 1; k <= n; ++k) {
+            int slot = (int)((p.frames - k) % PROF_HISTORY);
+            if (p.history[slot][i] > windowMax) windowMax = p.history[slot][i];
+        }
+        double avg = p.windowSum[i]/n;
+        frameAvg += avg;
+        DrawText(TextFormat("%-10s %8.3f %8.3f %8.3f", PROF_NAMES[i], avg, windowMax, p.maxMs[i]),
+                 x, y, 10, RAYWHITE);
+        y += lineH;
+    }
+    DrawText(TextFormat("frame      %8.3f ms (%d frames)", frameAvg, n), x, y, 10, YELLOW);
+}
+
+// Write the retained per-frame history (CSV) and a per-phase summary (JSON)
+static void ProfileDump(const char *csvPath, const char *jsonPath)
+{
+    const ProfileData &p = gProfile;
+    if (p.frames == 0) return;
+
+    if (FILE *f = fopen(csvPath, "w")) {
+        fprintf(f, "frame");
+        for (int i = 0; i < PROF_PHASE_COUNT; ++i) fprintf(f, ",%s_ms", PROF_NAMES[i]);
+        fprintf(f, "\n");
+
+        long first = (p.frames > PROF_HISTORY) ? p.frames - PROF_HISTORY : 0;
+        for (long fr = first; fr < p.frames; ++fr) {
+            fprintf(f, "%ld", fr);
+            for (int i = 0; i < PROF_PHASE_COUNT; ++i) fprintf(f, ",%.4f", p.history[fr % PROF_HISTORY][i]);
+            fprintf(f, "\n");
+        }
+        fclose(f);
+    }
+
+    if (FILE *f = fopen(jsonPath, "w")) {
+        fprintf(f, "{\n  \"frames\": %ld,\n  \"phases\": {\n", p.frames);
+        for (int i = 0; i < PROF_PHASE_COUNT; ++i) {
+            fprintf(f, "    \"%s\": { \"avg_ms\": %.4f, \"max_ms\": %.4f, \"total_ms\": %.3f }%s\n",
+                    PROF_NAMES[i], p.total[i]/p.frames, p.maxMs[i], p.total[i],
+                    (i + 1 < PROF_PHASE_COUNT) ? "," : "");
+        }
+        fprintf(f, "  }\n}\n");
+        fclose(f);
+    }
+
+    TraceLog(LOG_INFO, "PROFILE: wrote %s and %s (%ld frames)", csvPath, jsonPath, p.frames);
+}
+
+#else // !DODGE_PROFILE
+
+#define PROFILE_TIMER_SCOPE(phase)    ((void)0)
+#define ProfileEndFrame()             ((void)0)
+#define ProfileHandleInput()          ((void)0)
+#define ProfileDrawOverlay(screenW)   ((void)0)
+#define ProfileDump(csvPath, jsonPath) ((void)0)
+
+#endif // DODGE_PROFILE
+
+// One phase scope feeds every enabled backend (each part is ((void)0) when its flag is off)
+#define PROFILE_SCOPE(phase) PROFILE_TIMER_SCOPE(phase); TRACE_SCOPE(PROF_NAMES[phase]); ALLOC_SCOPE(phase)
@@ -0,0 +1,221 @@
+/*******************************************************************************************
+* raster.h - CPU software rasterizer: the game scene into an 8-bit luminance buffer
+*
+*   Renders what main.cpp's draw section shows (weather background, rounded-square player,
+*   suns, clouds, raindrops, the GAME_OVER dim) at any resolution, without a GPU or window:
+*   observation frames for pixel-based agents (e.g. 84x84) and golden images (800x450).
+*
+*   - Scene colours live here (SCENE_*) and main.cpp draws with the same constants; the
+*     rasterizer stores their luminance (Rec. 601), one byte per pixel, row-major
+*   - The 800x450 world is scaled to the target (non-uniformly for 84x84); every shape is
+*     sampled at pixel centres, one horizontal span per row
+*   - Spans are filled 16 pixels per store (U8x16, simd.h); short spans use 8/4-byte stores;
+*     the GAME_OVER dim blends 16 pixels at a time as well
+*   - Text (score, menu, game over) is not drawn; the MENU frame is the background only
+*   - RasterGameBatch() renders many games into one contiguous frames buffer; the vector
+*     env (env/dodge_env.h) spreads it over its worker threads
+*******************************************************************************************/
+
+#pragma once
+
+#include "raylib.h"
+#include "game.h"
+#include "simd.h"
+#include <cmath>
+#include <cstring>
+
+// -----------------------------------------------------------------------------------------
+// Scene colours (main.cpp's draw section uses these too)
+// -----------------------------------------------------------------------------------------
+static const Color SCENE_BG_SUNNY  = { 20, 24, 34, 255 };     // bluish
+static const Color SCENE_BG_CLOUDY = { 35, 35, 45, 255 };     // dark grey
+static const Color SCENE_BG_RAINY  = { 15, 18, 30, 255 };     // deep blue
+static const Color SCENE_PLAYER    = { 80, 200, 120, 255 };   // green
+static const Color SCENE_SUN       = { 250, 210, 60, 255 };   // yellow
+static const Color SCENE_CLOUD     = { 245, 245, 245, 255 };  // RAYWHITE
+static const Color SCENE_RAIN      = { 70, 140, 255, 255 };   // blue
+static const Color SCENE_GAME_OVER_DIM = { 0, 0, 0, 130 };    // drawn over the GAME_OVER screen
+
+inline Color SceneBackground(WeatherKind weather) {
+    if (weather == WeatherKind::CLOUDY) return SCENE_BG_CLOUDY;
+    if (weather == WeatherKind::RAINY) return SCENE_BG_RAINY;
+    return SCENE_BG_SUNNY;
+}
+
+inline unsigned char RasterLuma(Color c) {
+    return (unsigned char)((299*c.r + 587*c.g + 114*c.b + 500)/1000);
+}
+
+// -----------------------------------------------------------------------------------------
+// Target: width x height bytes, row-major, showing the whole SCREEN_W x SCREEN_H world
+// -----------------------------------------------------------------------------------------
+struct RasterTarget {
+    unsigned char *pixels;
+    int width, height;
+    float sx, sy;                // world -> pixels
+    float invSy;                 // pixels -> world (rows)
+};
+
+inline RasterTarget MakeRasterTarget(unsigned char *pixels, int width, int height) {
+    RasterTarget t;
+    t.pixels = pixels;
+    t.width = width;
+    t.height = height;
+    t.sx = (float)width/SCREEN_W;
+    t.sy = (float)height/SCREEN_H;
+    t.invSy = (float)SCREEN_H/height;
+    return t;
+}
+
+// First pixel whose centre is at or right of a pixel-space edge (ceil(x - 0.5) without libm)
+inline int RasterEdge(float x) {
+    x -= 0.5f;
+    int i = (int)x;
+    return i + (x > (float)i);
+}
+
+inline int RasterClamp(int v, int lo, int hi) { return (v < lo) ? lo : (v > hi) ? hi : v; }
+
+// -----------------------------------------------------------------------------------------
+// Span fill: pixels [x0, x1) of one row
+// -----------------------------------------------------------------------------------------
+inline void RasterFillSpan(unsigned char *row, int x0, int x1, unsigned char v) {
+    int n = x1 - x0;
+    if (n <= 0) return;
+    unsigned char *p = row + x0;
+
+    if (n >= 16) {
+        U8x16 fill = SplatU8x16(v);
+        for (int i = 0; i + 16 <= n; i += 16) StoreU8x16(p + i, fill);
+        StoreU8x16(p + n - 16, fill);          // the tail as one overlapping store
+    } else if (n >= 8) {
+        unsigned long long fill = v*0x0101010101010101ull;
+        memcpy(p, &fill, 8);
+        memcpy(p + n - 8, &fill, 8);
+    } else if (n >= 4) {
+        unsigned int fill = v*0x01010101u;
+        memcpy(p, &fill, 4);
+        memcpy(p + n - 4, &fill, 4);
+    } else {
+        for (int i = 0; i < n; ++i) p[i] = v;
+    }
+}
+
+// World-space span [xl, xr) on pixel row py
+inline void RasterWorldSpan(const RasterTarget &t, int py, float xl, float xr, unsigned char v) {
+    int x0 = RasterClamp(RasterEdge(xl*t.sx), 0, t.width);
+    int x1 = RasterClamp(RasterEdge(xr*t.sx), 0, t.width);
+    RasterFillSpan(t.pixels + (size_t)py*t.width, x0, x1, v);
+}
+
+// Pixel rows whose centres fall in the world-space range [yt, yb)
+inline void RasterRows(const RasterTarget &t, float yt, float yb, int &py0, int &py1) {
+    py0 = RasterClamp(RasterEdge(yt*t.sy), 0, t.height);
+    py1 = RasterClamp(RasterEdge(yb*t.sy), 0, t.height);
+}
+
+// -----------------------------------------------------------------------------------------
+// Shapes (world coordinates)
+// -----------------------------------------------------------------------------------------
+inline void RasterClear(const RasterTarget &t, unsigned char v) {
+    for (int py = 0; py < t.height; ++py) RasterFillSpan(t.pixels + (size_t)py*t.width, 0, t.width, v);
+}
+
+inline void RasterRect(const RasterTarget &t, Rectangle r, unsigned char v) {
+    int py0, py1;
+    RasterRows(t, r.y, r.y + r.height, py0, py1);
+    for (int py = py0; py < py1; ++py) RasterWorldSpan(t, py, r.x, r.x + r.width, v);
+}
+
+inline void RasterCircle(const RasterTarget &t, float cx, float cy, float radius, unsigned char v) {
+    int py0, py1;
+    RasterRows(t, cy - radius, cy + radius, py0, py1);
+    float r2 = radius*radius;
+    for (int py = py0; py < py1; ++py) {
+        float dy = (py + 0.5f)*t.invSy - cy;
+        float d = r2 - dy*dy;
+        if (d <= 0.0f) continue;
+        float hw = sqrtf(d);
+        RasterWorldSpan(t, py, cx - hw, cx + hw, v);
+    }
+}
+
+// DrawRectangleRounded: corner radius = roundness * the shorter side / 2
+inline void RasterRoundedRect(const RasterTarget &t, Rectangle r, float roundness, unsigned char v) {
+    float radius = roundness*((r.width < r.height) ? r.width : r.height)*0.5f;
+    float top = r.y + radius, bottom = r.y + r.height - radius;
+    int py0, py1;
+    RasterRows(t, r.y, r.y + r.height, py0, py1);
+    for (int py = py0; py < py1; ++py) {
+        float wy = (py + 0.5f)*t.invSy;
+        float dy = (wy < top) ? top - wy : (wy > bottom) ? wy - bottom : 0.0f;
+        float inset = 0.0f;
+        if (dy > 0.0f) {
+            float d = radius*radius - dy*dy;
+            inset = radius - ((d > 0.0f) ? sqrtf(d) : 0.0f);
+        }
+        RasterWorldSpan(t, py, r.x + inset, r.x + r.width - inset, v);
+    }
+}
+
+// Alpha-blend black over everything (the GAME_OVER overlay): v*(255 - a)/255, rounded
+inline void RasterDim(const RasterTarget &t, unsigned char alpha) {
+    size_t n = (size_t)t.width*t.height, i = 0;
+    unsigned char keep = (unsigned char)(255 - alpha);
+    for (; i + 16 <= n; i += 16) StoreU8x16(t.pixels + i, ScaleU8x16(LoadU8x16(t.pixels + i), keep));
+    for (; i < n; ++i) t.pixels[i] = (unsigned char)((t.pixels[i]*keep + 127u)/255u);
+}
+
+// -----------------------------------------------------------------------------------------
+// Enemy kernels, one per kind, mirroring DrawEnemyBucket in main.cpp (same integer casts)
+// -----------------------------------------------------------------------------------------
+template <typename K> inline void RasterEnemyBucket(const RasterTarget &t, const EnemyBucket &b);
+
+template <> inline void RasterEnemyBucket<RainKind>(const RasterTarget &t, const EnemyBucket &b) {
+    unsigned char v = RasterLuma(SCENE_RAIN);
+    for (int i = 0; i < b.count; ++i) RasterRect(t, Rectangle{ b.x[i], b.y[i], b.w[i], b.h[i] }, v);
+}
+
+template <> inline void RasterEnemyBucket<CloudKind>(const RasterTarget &t, const EnemyBucket &b) {
+    unsigned char v = RasterLuma(SCENE_CLOUD);
+    for (int i = 0; i < b.count; ++i) {
+        float cx = b.x[i] + b.w[i]*0.5f;
+        float cy = b.y[i] + b.h[i]*CLOUD_CENTER_Y;
+        float r1 = b.h[i]*CLOUD_RADIUS;
+        float r2 = r1*CLOUD_SIDE_R;
+        RasterCircle(t, (float)(int)cx, (float)(int)cy, (float)(int)r1, v);
+        RasterCircle(t, (float)(int)(cx - r1*CLOUD_SIDE_DX), (float)(int)(cy + CLOUD_SIDE_DY), (float)(int)r2, v);
+        RasterCircle(t, (float)(int)(cx + r1*CLOUD_SIDE_DX), (float)(int)(cy + CLOUD_SIDE_DY), (float)(int)r2, v);
+    }
+}
+
+template <> inline void RasterEnemyBucket<SunKind>(const RasterTarget &t, const EnemyBucket &b) {
+    unsigned char v = RasterLuma(SCENE_SUN);
+    for (int i = 0; i < b.count; ++i) {
+        float r = b.w[i]*0.5f;
+        RasterCircle(t, (float)(int)(b.x[i] + r), (float)(int)(b.y[i] + r), (float)(int)r, v);
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+// The scene of one game, as main.cpp draws it for the game's state
+// -----------------------------------------------------------------------------------------
+inline void RasterGame(const Game &game, const RasterTarget &t) {
+    RasterClear(t, RasterLuma(SceneBackground(game.weather)));
+
+    if (game.state == GameState::PLAYING) {
+        RasterRoundedRect(t, game.player.rect, PLAYER_ROUNDNESS, RasterLuma(SCENE_PLAYER));
+        ForEachEnemyKind([&](auto k) {
+            using K = decltype(k);
+            RasterEnemyBucket<K>(t, game.enemies.kinds[K::KIND]);
+        });
+    } else if (game.state == GameState::GAME_OVER) {
+        RasterDim(t, SCENE_GAME_OVER_DIM.a);
+    }
+}
+
+// games[0..count) into frames[count][height][width]
+inline void RasterGameBatch(const Game *games, int count, unsigned char *frames, int width, int height) {
+    size_t frameSize = (size_t)width*height;
+    for (int i = 0; i < count; ++i) RasterGame(games[i], MakeRasterTarget(frames + i*frameSize, width, height));
+}
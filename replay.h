@@ -0,0 +1,138 @@
+/*******************************************************************************************
+* replay.h - recorded input files (.rec) for "Dodge!"
+*
+*   A recording is the seed and settings a Game was initialised with, followed by one
+*   GameInput per tick. Re-running StepGame() over it reproduces the run exactly.
+*
+*   Layout (little-endian):
+*     ReplayHeader                      32 bytes
+*     { keys u8, weather i8, dt f32 }   6 bytes per tick, until end of file
+*
+*   - ReplayRecorder streams ticks straight to the file (no growing buffer, no per-frame allocation)
+*   - LoadReplay() reads a whole file for the headless tools, ParseReplay() one already in memory
+*   - flags record how the Game ran: REPLAY_FIXED_POINT replays through the fixed-point tick
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const char REPLAY_MAGIC[8] = { 'D', 'O', 'D', 'G', 'E', 'R', 'E', 'C' };
+static const int REPLAY_VERSION = 1;
+static const int REPLAY_TICK_SIZE = 6;
+
+enum ReplayFlags {
+    REPLAY_FIXED_POINT = 1 << 0,        // Game::fixedPoint (fixed.h)
+};
+
+struct ReplayHeader {
+    char magic[8];
+    int version;
+    int enemyCount;
+    unsigned long long seed;
+    int weather;                        // WeatherKind at InitGame
+    int flags;                          // ReplayFlags (0 in files from before there were any)
+};
+
+struct Replay {
+    ReplayHeader header;
+    std::vector<GameInput> ticks;
+};
+
+// -----------------------------------------------------------------------------------------
+// Recording (desktop: main --record <file>)
+// -----------------------------------------------------------------------------------------
+struct ReplayRecorder {
+    FILE *file = nullptr;
+    unsigned long ticks = 0;
+};
+
+inline bool ReplayRecordBegin(ReplayRecorder &rec, const char *path, const Game &game, unsigned long long seed)
+{
+    rec.file = fopen(path, "wb");
+    if (!rec.file) return false;
+
+    ReplayHeader h = {};
+    memcpy(h.magic, REPLAY_MAGIC, sizeof(h.magic));
+    h.version = REPLAY_VERSION;
+    h.enemyCount = game.enemyCount;
+    h.seed = seed;
+    h.weather = (int)game.weather;
+    h.flags = game.fixedPoint ? REPLAY_FIXED_POINT : 0;
+    fwrite(&h, sizeof(h), 1, rec.file);
+    rec.ticks = 0;
+    return true;
+}
+
+inline void ReplayRecordTick(ReplayRecorder &rec, const GameInput &in)
+{
+    if (!rec.file) return;
+    unsigned char buf[REPLAY_TICK_SIZE];
+    buf[0] = in.keys;
+    buf[1] = (unsigned char)in.weather;
+    memcpy(buf + 2, &in.dt, sizeof(float));
+    fwrite(buf, sizeof(buf), 1, rec.file);
+    rec.ticks++;
+}
+
+inline void ReplayRecordEnd(ReplayRecorder &rec)
+{
+    if (!rec.file) return;
+    fclose(rec.file);
+    rec.file = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------
+// Loading (headless tools)
+// -----------------------------------------------------------------------------------------
+inline GameInput ReplayDecodeTick(const unsigned char *buf)
+{
+    GameInput in;
+    in.keys = buf[0];
+    in.weather = (signed char)buf[1];
+    memcpy(&in.dt, buf + 2, sizeof(float));
+    return in;
+}
+
+inline bool ReplayHeaderValid(const ReplayHeader &h)
+{
+    return memcmp(h.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0 && h.version == REPLAY_VERSION;
+}
+
+inline bool LoadReplay(const char *path, Replay &replay)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    bool ok = (fread(&replay.header, sizeof(replay.header), 1, f) == 1) && ReplayHeaderValid(replay.header);
+
+    replay.ticks.clear();
+    unsigned char buf[REPLAY_TICK_SIZE];
+    while (ok && fread(buf, sizeof(buf), 1, f) == 1) replay.ticks.push_back(ReplayDecodeTick(buf));
+    fclose(f);
+    return ok;
+}
+
+// A whole .rec file already in memory (e.g. received over a socket); reuses replay.ticks' capacity
+inline bool ParseReplay(const void *data, size_t size, Replay &replay)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    if (size < sizeof(ReplayHeader)) return false;
+    memcpy(&replay.header, p, sizeof(ReplayHeader));
+    if (!ReplayHeaderValid(replay.header)) return false;
+
+    size_t n = (size - sizeof(ReplayHeader))/REPLAY_TICK_SIZE;
+    replay.ticks.resize(n);
+    for (size_t i = 0; i < n; ++i) replay.ticks[i] = ReplayDecodeTick(p + sizeof(ReplayHeader) + i*REPLAY_TICK_SIZE);
+    return true;
+}
+
+// Fresh Game exactly as the recording started
+inline void InitGameFromReplay(Game &game, const Replay &replay)
+{
+    game.fixedPoint = (replay.header.flags & REPLAY_FIXED_POINT) != 0;
+    InitGame(game, replay.header.seed, replay.header.enemyCount, (WeatherKind)replay.header.weather);
+}
@@ -0,0 +1,314 @@
+/*******************************************************************************************
+* replaypack.h - packed replays (.dpk): a recording plus keyframes, compressed and seekable
+*
+*   A .rec file (replay.h) can only be watched from the start. A pack cuts the same run into
+*   blocks of PACK_KEYFRAME_SECONDS of game time; each block starts with a keyframe (a full
+*   save state, snapshot.h) and carries that block's inputs, so any moment of the run is
+*   one block away: decompress the block, load its keyframe, step at most one block of ticks.
+*
+*   Layout (little-endian):
+*     PackHeader                        56 bytes: the .rec header fields + block count
+*     PackBlock[blockCount]             32 bytes each: the index (where, when, how big)
+*     compressed blocks                 raylib CompressData() (DEFLATE), one per index entry
+*
+*   Block, before compression:
+*     u32 keyframe size, keyframe       SaveGameSnapshot() of the state before firstTick
+*     one entry per tick                flags u8 (PACK_KEYS/PACK_WEATHER/PACK_DT), then only
+*                                       what changed: keys u8, weather i8, dt bits ^ previous
+*                                       dt bits (u32); "previous" restarts at every block
+*
+*   - The seed and inputs are the truth, keyframes are a cache: a keyframe that does not
+*     load in this build (snapshot layout changed) makes seeking replay from the start
+*   - BuildReplayPack() runs the recording once to take the keyframes (headless tools, viewer)
+*   - Seeking and stepping allocate (decompression); they are for the viewer, not PLAYING
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "raylib.h"
+#include <cstring>
+#include <vector>
+
+static const char PACK_MAGIC[8] = { 'D', 'O', 'D', 'G', 'E', 'P', 'A', 'K' };
+static const int PACK_VERSION = 2;                 // 2: ReplayHeader flags
+static const float PACK_KEYFRAME_SECONDS = 5.0f;
+
+enum PackTickFlags {
+    PACK_KEYS    = 1 << 0,          // keys differ from the previous tick
+    PACK_WEATHER = 1 << 1,          // a weather change (GameInput::weather >= 0)
+    PACK_DT      = 1 << 2,          // dt differs from the previous tick
+};
+
+struct PackHeader {
+    char magic[8];
+    int version;
+    int enemyCount;
+    unsigned long long seed;
+    int weather;                    // WeatherKind at InitGame
+    int ticks;                      // whole recording
+    int blockCount;
+    float keyframeSeconds;
+    int flags;                      // ReplayHeader::flags
+    int reserved;
+    double duration;                // whole recording, game time
+};
+
+struct PackBlock {
+    unsigned long long offset;      // compressed block, from the start of the file
+    int compressedSize, rawSize;
+    int firstTick, tickCount;
+    double startTime;               // game time (sum of dt) before firstTick
+};
+
+static_assert(sizeof(PackHeader) == 56 && sizeof(PackBlock) == 32, "the file layout is the struct layout");
+
+struct ReplayPack {
+    PackHeader header = {};
+    std::vector<PackBlock> index;
+    std::vector<unsigned char> file;    // the whole .dpk (header, index, compressed blocks)
+};
+
+// Where a viewer is: the decoded inputs of one block and the next tick to step
+struct PackCursor {
+    int block = -1;
+    std::vector<GameInput> inputs;  // block's ticks (capacity reused)
+    int tick = 0;                   // next tick to step, whole recording
+    double time = 0.0;              // game time before `tick`
+};
+
+// -----------------------------------------------------------------------------------------
+// Block coding
+// -----------------------------------------------------------------------------------------
+inline void PackPutU32(std::vector<unsigned char> &out, unsigned int v)
+{
+    unsigned char b[4];
+    memcpy(b, &v, sizeof(b));
+    out.insert(out.end(), b, b + 4);
+}
+
+inline void PackEncodeTicks(std::vector<unsigned char> &out, const GameInput *ticks, int count)
+{
+    unsigned char keys = 0;
+    unsigned int dtBits = 0;
+    for (int i = 0; i < count; ++i) {
+        const GameInput &in = ticks[i];
+        unsigned int bits;
+        memcpy(&bits, &in.dt, sizeof(bits));
+        unsigned char flags = (unsigned char)((in.keys != keys ? PACK_KEYS : 0) | (in.weather >= 0 ? PACK_WEATHER : 0) |
+                                              (bits != dtBits ? PACK_DT : 0));
+        out.push_back(flags);
+        if (flags & PACK_KEYS) out.push_back(in.keys);
+        if (flags & PACK_WEATHER) out.push_back((unsigned char)in.weather);
+        if (flags & PACK_DT) PackPutU32(out, bits ^ dtBits);
+        keys = in.keys;
+        dtBits = bits;
+    }
+}
+
+// False if the block is truncated or corrupt
+inline bool PackDecodeTicks(const unsigned char *p, const unsigned char *end, int count, std::vector<GameInput> &ticks)
+{
+    ticks.resize((size_t)count);
+    unsigned char keys = 0;
+    unsigned int dtBits = 0;
+    for (int i = 0; i < count; ++i) {
+        if (p >= end) return false;
+        unsigned char flags = *p++;
+        int need = ((flags & PACK_KEYS) ? 1 : 0) + ((flags & PACK_WEATHER) ? 1 : 0) + ((flags & PACK_DT) ? 4 : 0);
+        if (end - p < need) return false;
+        if (flags & PACK_KEYS) keys = *p++;
+        GameInput &in = ticks[i];
+        in.keys = keys;
+        in.weather = (flags & PACK_WEATHER) ? (signed char)*p++ : -1;
+        if (flags & PACK_DT) {
+            unsigned int x;
+            memcpy(&x, p, sizeof(x));
+            p += 4;
+            dtBits ^= x;
+        }
+        memcpy(&in.dt, &dtBits, sizeof(in.dt));
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Building (runs the recording once, keyframe at every block start)
+// -----------------------------------------------------------------------------------------
+inline bool BuildReplayPack(const Replay &replay, ReplayPack &pack, float keyframeSeconds = PACK_KEYFRAME_SECONDS)
+{
+    PackHeader &h = pack.header;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PACK_MAGIC, sizeof(h.magic));
+    h.version = PACK_VERSION;
+    h.enemyCount = replay.header.enemyCount;
+    h.seed = replay.header.seed;
+    h.weather = replay.header.weather;
+    h.flags = replay.header.flags;
+    h.ticks = (int)replay.ticks.size();
+    h.keyframeSeconds = keyframeSeconds;
+    pack.index.clear();
+
+    Game game;
+    InitGameFromReplay(game, replay);
+    GameSnapshot snap;
+    std::vector<unsigned char> raw;
+    std::vector<unsigned char> blocks;
+    double time = 0.0;
+    int tick = 0;
+    while (tick < h.ticks || pack.index.empty()) {
+        PackBlock b = {};
+        b.firstTick = tick;
+        b.startTime = time;
+
+        // Game time decides the cut, so fast-forward is smooth whatever the frame rate was
+        double end = time + keyframeSeconds;
+        while (tick < h.ticks && (tick == b.firstTick || time < end)) time += replay.ticks[tick++].dt;
+        b.tickCount = tick - b.firstTick;
+
+        SaveGameSnapshot(game, snap);
+        raw.clear();
+        PackPutU32(raw, (unsigned int)snap.size);
+        raw.insert(raw.end(), snap.bytes.data(), snap.bytes.data() + snap.size);
+        PackEncodeTicks(raw, replay.ticks.data() + b.firstTick, b.tickCount);
+        for (int i = b.firstTick; i < tick; ++i) StepGame(game, replay.ticks[i]);
+
+        int compressedSize = 0;
+        unsigned char *compressed = CompressData(raw.data(), (int)raw.size(), &compressedSize);
+        if (!compressed) return false;
+        b.offset = blocks.size();
+        b.compressedSize = compressedSize;
+        b.rawSize = (int)raw.size();
+        blocks.insert(blocks.end(), compressed, compressed + compressedSize);
+        MemFree(compressed);
+        pack.index.push_back(b);
+    }
+    h.blockCount = (int)pack.index.size();
+    h.duration = time;
+
+    // Offsets so far are relative to the first block
+    size_t base = sizeof(PackHeader) + pack.index.size()*sizeof(PackBlock);
+    for (PackBlock &b : pack.index) b.offset += base;
+    pack.file.resize(base + blocks.size());
+    memcpy(pack.file.data(), &h, sizeof(h));
+    memcpy(pack.file.data() + sizeof(h), pack.index.data(), pack.index.size()*sizeof(PackBlock));
+    memcpy(pack.file.data() + base, blocks.data(), blocks.size());
+    return true;
+}
+
+inline bool SaveReplayPack(const char *path, const ReplayPack &pack)
+{
+    return SaveFileData(path, (void *)pack.file.data(), (int)pack.file.size());
+}
+
+// Takes the bytes (a whole .dpk) and checks the header and index against them
+inline bool ParseReplayPack(std::vector<unsigned char> &&bytes, ReplayPack &pack)
+{
+    if (bytes.size() < sizeof(PackHeader)) return false;
+    PackHeader h;
+    memcpy(&h, bytes.data(), sizeof(h));
+    if (memcmp(h.magic, PACK_MAGIC, sizeof(h.magic)) != 0 || h.version != PACK_VERSION || h.blockCount < 1 || h.ticks < 0) return false;
+    if ((bytes.size() - sizeof(PackHeader))/sizeof(PackBlock) < (size_t)h.blockCount) return false;
+
+    std::vector<PackBlock> index((size_t)h.blockCount);
+    memcpy(index.data(), bytes.data() + sizeof(PackHeader), index.size()*sizeof(PackBlock));
+    int tick = 0;
+    for (const PackBlock &b : index) {
+        if (b.firstTick != tick || b.tickCount < 0 || b.compressedSize < 0 || b.rawSize < 4 ||
+            b.offset > bytes.size() || (unsigned long long)b.compressedSize > bytes.size() - b.offset) return false;
+        tick += b.tickCount;
+    }
+    if (tick != h.ticks) return false;
+
+    pack.header = h;
+    pack.index = std::move(index);
+    pack.file = std::move(bytes);
+    return true;
+}
+
+inline bool LoadReplayPack(const char *path, ReplayPack &pack)
+{
+    int size = 0;
+    unsigned char *data = LoadFileData(path, &size);
+    if (!data) return false;
+    std::vector<unsigned char> bytes(data, data + size);
+    UnloadFileData(data);
+    return ParseReplayPack(std::move(bytes), pack);
+}
+
+// -----------------------------------------------------------------------------------------
+// Seeking and stepping (viewer)
+// -----------------------------------------------------------------------------------------
+
+// Decompresses block b into the cursor; loads its keyframe into `game` when asked
+inline bool PackOpenBlock(const ReplayPack &pack, int b, PackCursor &cursor, Game *game)
+{
+    const PackBlock &block = pack.index[(size_t)b];
+    int rawSize = 0;
+    unsigned char *raw = DecompressData(pack.file.data() + block.offset, block.compressedSize, &rawSize);
+    if (!raw) return false;
+
+    bool ok = rawSize == block.rawSize;
+    unsigned int snapSize = 0;
+    if (ok) {
+        memcpy(&snapSize, raw, sizeof(snapSize));
+        ok = snapSize <= (unsigned int)rawSize - 4 &&
+             PackDecodeTicks(raw + 4 + snapSize, raw + rawSize, block.tickCount, cursor.inputs);
+    }
+    if (ok && game) ok = LoadGameSnapshot(*game, raw + 4, snapSize);
+    MemFree(raw);
+    if (!ok) return false;
+
+    cursor.block = b;
+    cursor.tick = block.firstTick;
+    cursor.time = block.startTime;
+    return true;
+}
+
+// Steps one tick; false at the end of the recording
+inline bool PackStep(const ReplayPack &pack, PackCursor &cursor, Game &game)
+{
+    if (cursor.tick >= pack.header.ticks || cursor.block < 0) return false;
+    const PackBlock *block = &pack.index[(size_t)cursor.block];
+    if (cursor.tick >= block->firstTick + block->tickCount) {
+        if (!PackOpenBlock(pack, cursor.block + 1, cursor, nullptr)) return false;   // game carries on, no keyframe
+        block = &pack.index[(size_t)cursor.block];
+    }
+    const GameInput &in = cursor.inputs[(size_t)(cursor.tick - block->firstTick)];
+    StepGame(game, in);
+    cursor.time += in.dt;
+    cursor.tick++;
+    return true;
+}
+
+// The last block starting at or before `time`
+inline int PackFindBlock(const ReplayPack &pack, double time)
+{
+    int lo = 0, hi = (int)pack.index.size() - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1)/2;
+        if (pack.index[(size_t)mid].startTime <= time) lo = mid; else hi = mid - 1;
+    }
+    return lo;
+}
+
+// Puts `game` at the last tick boundary at or before `time`: one block decompressed, at most one
+// block of ticks stepped. Without a usable keyframe it replays from the start (slow, still right).
+inline bool PackSeek(const ReplayPack &pack, PackCursor &cursor, Game &game, double time)
+{
+    int b = PackFindBlock(pack, time);
+    if (!PackOpenBlock(pack, b, cursor, &game)) {
+        game.fixedPoint = (pack.header.flags & REPLAY_FIXED_POINT) != 0;
+        InitGame(game, pack.header.seed, pack.header.enemyCount, (WeatherKind)pack.header.weather);
+        if (!PackOpenBlock(pack, 0, cursor, nullptr)) return false;
+    }
+    while (cursor.tick < pack.header.ticks) {
+        const PackBlock &block = pack.index[(size_t)cursor.block];
+        int i = cursor.tick - block.firstTick;
+        if (i < block.tickCount && cursor.time + cursor.inputs[(size_t)i].dt > time) break;
+        if (!PackStep(pack, cursor, game)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,223 @@
+/*******************************************************************************************
+* rollback.h - rollback netcode for versus mode (GGPO-style), transport-agnostic
+*
+*   Each peer simulates both players every tick without waiting for the network:
+*     - Local keys are scheduled ROLLBACK_INPUT_DELAY ticks ahead, which hides that much
+*       latency without any rollback
+*     - The remote player's keys are predicted (they keep holding what they last sent) until
+*       the real ones arrive. A real input that differs from the prediction rolls back: load
+*       the save state from before that tick and re-simulate to the present, all in one frame.
+*     - The sim never runs more than ROLLBACK_MAX_FRAMES ahead of the last confirmed remote
+*       input; past that it waits (a stall) instead of predicting further
+*
+*   Packets (RollbackPacket, one per frame, UDP) carry every local input the peer has not
+*   acknowledged yet, so a lost packet is covered by the next one; there is no retransmit.
+*   Player 0 picks the seed; player 1 adopts it from the first packet it gets.
+*
+*   - A tick is "confirmed" once both players' inputs for it are known and it was simulated
+*     with them: confirmedHash chains VersusChecksum() of every confirmed tick, so two peers
+*     that agree on confirmedTick must agree on confirmedHash (desync check)
+*   - Fixed-size state: after the snapshots reach the field's size nothing allocates
+*******************************************************************************************/
+
+#pragma once
+
+#include "versus.h"
+#include <climits>
+#include <cstring>
+
+static const int ROLLBACK_MAX_FRAMES = 12;          // prediction window, ticks
+static const int ROLLBACK_INPUT_DELAY = 2;          // ticks
+static const int ROLLBACK_RING = 64;                // input history, ticks (power of two)
+static const int ROLLBACK_SNAPSHOTS = ROLLBACK_MAX_FRAMES + 2;
+static const int ROLLBACK_MAX_RESEND = 32;          // inputs per packet
+
+// Unacknowledged local inputs never exceed 2*window + 2*delay + 2 ticks (each side stops
+// within the window of what it heard last), so one packet always carries all of them
+static_assert(2*ROLLBACK_MAX_FRAMES + 2*ROLLBACK_INPUT_DELAY + 2 <= ROLLBACK_MAX_RESEND, "resend window too small");
+static_assert(ROLLBACK_MAX_RESEND*2 <= ROLLBACK_RING, "input ring too small");
+
+static const char ROLLBACK_MAGIC[4] = { 'D', 'V', 'R', 'B' };
+
+struct RollbackPacket {
+    char magic[4];
+    unsigned char player;               // sender
+    unsigned char count;                // inputs that follow
+    unsigned short reserved;
+    unsigned long long seed;            // player 0's seed
+    int firstTick;                      // inputs[0] is the sender's keys for this tick
+    int ackTick;                        // sender has the receiver's keys for every tick before this
+    unsigned char inputs[ROLLBACK_MAX_RESEND];
+};
+
+static_assert(sizeof(RollbackPacket) == 56, "the wire layout is the struct layout");
+
+struct RollbackStats {
+    int rollbacks = 0;                  // frames that re-simulated
+    int resimTicks = 0;                 // ticks re-simulated, total
+    int maxDepth = 0;                   // most ticks re-simulated in one frame
+    int stalls = 0;                     // frames spent waiting at the window edge
+    int predicted = 0;                  // remote inputs predicted, then confirmed
+    int mispredicted = 0;               // ... of which the prediction was wrong
+};
+
+struct RollbackSession {
+    int local = 0;                      // this peer's player index
+    unsigned long long seed = 0;
+    bool started = false;               // heard from the peer (player 1: seed adopted)
+    int tick = 0;                       // next tick to simulate
+    int stopTick = INT_MAX;             // never simulate this tick (end of a test run)
+    int remoteConfirmed = 0;            // remote keys known for every tick before this
+    int peerAck = 0;                    // peer has our keys for every tick before this
+    int rollbackFrom = INT_MAX;         // earliest tick simulated with a wrong prediction
+    unsigned char localInputs[ROLLBACK_RING] = {};
+    unsigned char remoteInputs[ROLLBACK_RING] = {};
+    unsigned char usedRemote[ROLLBACK_RING] = {};           // what the sim used for tick k
+    unsigned long long stateHash[ROLLBACK_RING] = {};       // VersusChecksum after tick k
+    VersusSnapshot snapshots[ROLLBACK_SNAPSHOTS];           // state before tick k
+    int confirmedTick = 0;
+    unsigned long long confirmedHash = 0xCBF29CE484222325ull;
+    RollbackStats stats;
+};
+
+// A new match; snapshot buffers are kept. `seed` only matters for player 0.
+inline void RollbackInit(RollbackSession &s, int local, unsigned long long seed)
+{
+    s.local = local;
+    s.seed = (local == 0) ? seed : 0;
+    s.started = false;
+    s.tick = 0;
+    s.stopTick = INT_MAX;
+    s.remoteConfirmed = 0;
+    s.peerAck = 0;
+    s.rollbackFrom = INT_MAX;
+    memset(s.localInputs, 0, sizeof(s.localInputs));
+    memset(s.remoteInputs, 0, sizeof(s.remoteInputs));
+    memset(s.usedRemote, 0, sizeof(s.usedRemote));
+    memset(s.stateHash, 0, sizeof(s.stateHash));
+    s.confirmedTick = 0;
+    s.confirmedHash = 0xCBF29CE484222325ull;
+    s.stats = RollbackStats{};
+}
+
+// Ticks simulated beyond the last confirmed remote input (0 = fully in sync)
+inline int RollbackAhead(const RollbackSession &s)
+{
+    return (s.tick > s.remoteConfirmed) ? s.tick - s.remoteConfirmed : 0;
+}
+
+// -----------------------------------------------------------------------------------------
+// Network side
+// -----------------------------------------------------------------------------------------
+
+// This frame's packet: every local input from the peer's ack on (or a hello before start)
+inline void RollbackMakePacket(const RollbackSession &s, RollbackPacket &pkt)
+{
+    memset(&pkt, 0, sizeof(pkt));
+    memcpy(pkt.magic, ROLLBACK_MAGIC, sizeof(pkt.magic));
+    pkt.player = (unsigned char)s.local;
+    pkt.seed = s.seed;
+    pkt.ackTick = s.remoteConfirmed;
+    pkt.firstTick = s.peerAck;
+    if (!s.started) return;
+
+    int scheduled = s.tick + ROLLBACK_INPUT_DELAY;      // local keys exist for every tick before this
+    int count = scheduled - s.peerAck;
+    if (count > ROLLBACK_MAX_RESEND) count = ROLLBACK_MAX_RESEND;
+    for (int i = 0; i < count; ++i) pkt.inputs[i] = s.localInputs[(s.peerAck + i) & (ROLLBACK_RING - 1)];
+    pkt.count = (unsigned char)((count > 0) ? count : 0);
+}
+
+// Takes a received datagram; false if it is not a packet from the peer
+inline bool RollbackOnPacket(RollbackSession &s, const void *data, int size)
+{
+    RollbackPacket pkt;
+    if (size != (int)sizeof(pkt)) return false;
+    memcpy(&pkt, data, sizeof(pkt));
+    if (memcmp(pkt.magic, ROLLBACK_MAGIC, sizeof(pkt.magic)) != 0 || pkt.player != 1 - s.local ||
+        pkt.count > ROLLBACK_MAX_RESEND) return false;
+
+    if (!s.started) {
+        if (s.local == 1) s.seed = pkt.seed;
+        s.started = true;
+    }
+    if (pkt.ackTick > s.peerAck) s.peerAck = pkt.ackTick;
+
+    // Only the next unknown tick onwards, in order: older ones are repeats, a gap waits for a resend
+    for (int i = 0; i < pkt.count; ++i) {
+        int k = pkt.firstTick + i;
+        if (k < s.remoteConfirmed) continue;
+        if (k > s.remoteConfirmed) break;
+        int slot = k & (ROLLBACK_RING - 1);
+        s.remoteInputs[slot] = pkt.inputs[i];
+        if (k < s.tick) {
+            s.stats.predicted++;
+            if (s.usedRemote[slot] != pkt.inputs[i]) {
+                s.stats.mispredicted++;
+                if (k < s.rollbackFrom) s.rollbackFrom = k;
+            }
+        }
+        s.remoteConfirmed++;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Simulation side
+// -----------------------------------------------------------------------------------------
+
+// Simulates tick k (== the state's next tick) with the best inputs known now
+inline void RollbackStepTick(RollbackSession &s, Versus &v, int k)
+{
+    int slot = k & (ROLLBACK_RING - 1);
+    SaveVersusSnapshot(v, s.snapshots[k % ROLLBACK_SNAPSHOTS]);
+
+    // Prediction: the remote player keeps holding their last confirmed keys
+    unsigned char remote = 0;
+    if (k < s.remoteConfirmed) remote = s.remoteInputs[slot];
+    else if (s.remoteConfirmed > 0) remote = s.remoteInputs[(s.remoteConfirmed - 1) & (ROLLBACK_RING - 1)];
+    s.usedRemote[slot] = remote;
+
+    unsigned char keys[VERSUS_PLAYERS];
+    keys[s.local] = s.localInputs[slot];
+    keys[1 - s.local] = remote;
+    VersusStep(v, keys);
+    s.stateHash[slot] = VersusChecksum(v);
+}
+
+inline void RollbackConfirm(RollbackSession &s)
+{
+    int last = (s.remoteConfirmed < s.tick) ? s.remoteConfirmed : s.tick;
+    for (; s.confirmedTick < last; s.confirmedTick++)
+        s.confirmedHash = HashBytes(s.confirmedHash, &s.stateHash[s.confirmedTick & (ROLLBACK_RING - 1)], sizeof(unsigned long long));
+}
+
+// Once per frame, after the frame's packets: rolls back if a prediction was wrong, then
+// schedules `localKeys` and simulates the next tick. False when it waited instead.
+inline bool RollbackAdvance(RollbackSession &s, Versus &v, unsigned char localKeys)
+{
+    if (!s.started) return false;
+
+    if (s.rollbackFrom < s.tick) {
+        int depth = s.tick - s.rollbackFrom;
+        s.stats.rollbacks++;
+        s.stats.resimTicks += depth;
+        if (depth > s.stats.maxDepth) s.stats.maxDepth = depth;
+        LoadVersusSnapshot(v, s.snapshots[s.rollbackFrom % ROLLBACK_SNAPSHOTS]);
+        for (int k = s.rollbackFrom; k < s.tick; ++k) RollbackStepTick(s, v, k);
+    }
+    s.rollbackFrom = INT_MAX;
+    RollbackConfirm(s);
+
+    if (s.tick >= s.stopTick) return false;
+    if (s.tick - s.remoteConfirmed >= ROLLBACK_MAX_FRAMES) {
+        s.stats.stalls++;
+        return false;
+    }
+
+    s.localInputs[(s.tick + ROLLBACK_INPUT_DELAY) & (ROLLBACK_RING - 1)] = localKeys;
+    RollbackStepTick(s, v, s.tick);
+    s.tick++;
+    RollbackConfirm(s);
+    return true;
+}
@@ -0,0 +1,326 @@
+/*******************************************************************************************
+* savedata.h - persistent best score, run history and best ghost, saved without blocking
+*
+*   Two small files (slots): SAVE_FILE (SaveData: best score + the last SAVE_HISTORY runs)
+*   and GHOST_FILE (ghost.h). Desktop keeps them in the working directory, web in an IDBFS
+*   mount (IndexedDB), so both survive a reload.
+*
+*   - Loading is lazy: SaveStart() only kicks it off (desktop: a storage thread reads the
+*     files; web: FS.syncfs() pulls IndexedDB into MEMFS). SaveTakeLoaded() hands each slot
+*     over once it is there; the first frame never waits for it.
+*   - Saving is asynchronous: SaveWrite() only queues the bytes. SavePoll() posts them to
+*     the storage thread (desktop: write a temp file, rename it over the old one) or writes
+*     MEMFS and starts a background FS.syncfs() (web). Like TuningPoll(), posting never
+*     waits for a lock: if the thread holds it, the bytes go on the next frame.
+*   - A slot is only written once its stored file was taken (merged by the game): writing
+*     earlier would replace a history the game has not seen yet
+*   - Nothing here runs during PLAYING frames: runs are added to SaveData in place on the
+*     GAME_OVER tick (no allocation) and written from the following frames
+*   - SaveStop() flushes queued writes on exit (desktop)
+*******************************************************************************************/
+
+#pragma once
+
+#include "raylib.h"
+#include "ghost.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+  #include <emscripten/emscripten.h>
+  #define SAVE_DIR "/save/"            // IDBFS mount (link with -lidbfs.js -s FORCE_FILESYSTEM=1)
+#else
+  #define SAVE_THREAD
+  #include <atomic>
+  #include <condition_variable>
+  #include <mutex>
+  #include <thread>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define SAVE_DIR ""                  // working directory
+#endif
+
+#define SAVE_FILE "dodge.sav"
+
+enum SaveSlot { SAVE_SLOT_DATA, SAVE_SLOT_GHOST, SAVE_SLOT_COUNT };
+static const char *const SAVE_PATHS[SAVE_SLOT_COUNT] = { SAVE_DIR SAVE_FILE, SAVE_DIR GHOST_FILE };
+
+static const char SAVE_MAGIC[8] = { 'D', 'O', 'D', 'G', 'E', 'S', 'A', 'V' };
+static const int SAVE_VERSION = 1;
+static const int SAVE_HISTORY = 64;
+
+// One finished run
+struct RunRecord {
+    long long when;                     // unix time at GAME_OVER
+    int score;
+    float seconds;                      // run length, game time
+    int weather;                        // WeatherKind at GAME_OVER
+    int enemies;                        // enemies on screen at GAME_OVER
+};
+
+// The whole save file (little-endian, like .rec files)
+struct SaveData {
+    char magic[8];
+    int version;
+    int bestScore;
+    int runs;                           // every run ever; history keeps the last SAVE_HISTORY
+    int reserved;
+    RunRecord history[SAVE_HISTORY];    // ring: run r (from 0) is history[r % SAVE_HISTORY]
+};
+
+static_assert(sizeof(RunRecord) == 24, "the file layout is the struct layout");
+
+inline void SaveDataInit(SaveData &data)
+{
+    memset(&data, 0, sizeof(data));
+    memcpy(data.magic, SAVE_MAGIC, sizeof(data.magic));
+    data.version = SAVE_VERSION;
+}
+
+// GAME_OVER tick: in place, no allocation
+inline void SaveDataAddRun(SaveData &data, const RunRecord &run)
+{
+    data.history[data.runs % SAVE_HISTORY] = run;
+    data.runs++;
+    if (run.score > data.bestScore) data.bestScore = run.score;
+}
+
+// The n-th most recent run (0 = last); n < SaveDataHistoryCount()
+inline int SaveDataHistoryCount(const SaveData &data) { return (data.runs < SAVE_HISTORY) ? data.runs : SAVE_HISTORY; }
+inline const RunRecord &SaveDataRecent(const SaveData &data, int n) { return data.history[(data.runs - 1 - n) % SAVE_HISTORY]; }
+
+inline bool ParseSaveData(const std::vector<unsigned char> &bytes, SaveData &data)
+{
+    if (bytes.size() != sizeof(SaveData)) return false;
+    SaveData d;
+    memcpy(&d, bytes.data(), sizeof(d));
+    if (memcmp(d.magic, SAVE_MAGIC, sizeof(d.magic)) != 0 || d.version != SAVE_VERSION || d.runs < 0) return false;
+    data = d;
+    return true;
+}
+
+// The stored file arrived after `session` already had runs: stored runs first, then this session's
+inline void SaveDataMerge(SaveData &session, const SaveData &stored)
+{
+    SaveData merged = stored;
+    int recent = SaveDataHistoryCount(session);
+    merged.runs = stored.runs + session.runs - recent;      // ring positions as if played in order
+    for (int n = recent - 1; n >= 0; --n) SaveDataAddRun(merged, SaveDataRecent(session, n));
+    if (session.bestScore > merged.bestScore) merged.bestScore = session.bestScore;
+    session = merged;
+}
+
+// -----------------------------------------------------------------------------------------
+// Main-thread queue (both platforms): bytes waiting for SavePoll()
+// -----------------------------------------------------------------------------------------
+struct SaveQueue {
+    std::vector<unsigned char> bytes[SAVE_SLOT_COUNT];
+    bool queued[SAVE_SLOT_COUNT] = {};
+    bool taken[SAVE_SLOT_COUNT] = {};   // loaded slot handed to the game already
+    bool started = false;
+};
+
+static SaveQueue gSaveQueue;
+
+// Queues the slot's new contents (swapped in: `bytes` gets the old buffer back)
+static void SaveWrite(SaveSlot slot, std::vector<unsigned char> &bytes)
+{
+    if (!gSaveQueue.started) return;
+    gSaveQueue.bytes[slot].swap(bytes);
+    gSaveQueue.queued[slot] = true;
+}
+
+#ifdef SAVE_THREAD
+
+// -----------------------------------------------------------------------------------------
+// Desktop: storage thread. Loads every slot once, then writes whatever is posted.
+// -----------------------------------------------------------------------------------------
+struct SaveStore {
+    std::thread thread;
+    std::mutex lock;                    // guards everything below except 'ready'
+    std::condition_variable wake;
+    bool stop = false;
+    std::vector<unsigned char> loaded[SAVE_SLOT_COUNT];
+    bool found[SAVE_SLOT_COUNT] = {};
+    std::vector<unsigned char> posted[SAVE_SLOT_COUNT];
+    bool pending[SAVE_SLOT_COUNT] = {};
+    std::atomic<bool> ready{ false };   // loads done
+};
+
+static SaveStore gSaveStore;
+
+// Storage thread I/O: plain open/read/write into buffers sized in SaveStart() (no stdio,
+// no heap), so the thread never allocates while PLAYING frames are being counted
+static const size_t SAVE_SLOT_MAX[SAVE_SLOT_COUNT] = { sizeof(SaveData), sizeof(GhostHeader) + GHOST_MAX_BYTES };
+
+static bool SaveReadFile(SaveSlot slot, std::vector<unsigned char> &bytes)
+{
+    int fd = open(SAVE_PATHS[slot], O_RDONLY);
+    if (fd < 0) return false;
+    bytes.resize(bytes.capacity());
+    size_t size = 0;
+    ssize_t n;
+    while (size < bytes.size() && (n = read(fd, bytes.data() + size, bytes.size() - size)) > 0) size += (size_t)n;
+    close(fd);
+    bytes.resize(size);
+    return true;
+}
+
+// Temp file + rename: a crash mid-write leaves the old file, never half of the new one
+static bool SaveWriteFile(SaveSlot slot, const std::vector<unsigned char> &bytes)
+{
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", SAVE_PATHS[slot]);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    ssize_t n = 0;
+    while (done < bytes.size() && (n = write(fd, bytes.data() + done, bytes.size() - done)) > 0) done += (size_t)n;
+    bool ok = (close(fd) == 0) && done == bytes.size();
+    return ok && rename(tmp, SAVE_PATHS[slot]) == 0;
+}
+
+static void SaveThread()
+{
+    {
+        std::lock_guard<std::mutex> guard(gSaveStore.lock);
+        for (int s = 0; s < SAVE_SLOT_COUNT; ++s) gSaveStore.found[s] = SaveReadFile((SaveSlot)s, gSaveStore.loaded[s]);
+    }
+    gSaveStore.ready.store(true, std::memory_order_release);
+
+    std::vector<unsigned char> bytes;
+    std::unique_lock<std::mutex> guard(gSaveStore.lock);
+    for (;;) {
+        int s = 0;
+        while (s < SAVE_SLOT_COUNT && !gSaveStore.pending[s]) s++;
+        if (s == SAVE_SLOT_COUNT) {
+            if (gSaveStore.stop) break;
+            gSaveStore.wake.wait(guard);
+            continue;
+        }
+        bytes.swap(gSaveStore.posted[s]);
+        gSaveStore.pending[s] = false;
+        guard.unlock();
+        if (!SaveWriteFile((SaveSlot)s, bytes)) TraceLog(LOG_WARNING, "SAVE: could not write %s", SAVE_PATHS[s]);
+        guard.lock();
+    }
+}
+
+static void SaveStart()
+{
+    gSaveQueue.started = true;
+    for (int s = 0; s < SAVE_SLOT_COUNT; ++s) gSaveStore.loaded[s].reserve(SAVE_SLOT_MAX[s]);
+    gSaveStore.thread = std::thread(SaveThread);
+}
+
+// Once per frame outside PLAYING: posts queued writes. Never blocks.
+static void SavePoll()
+{
+    if (!gSaveQueue.started) return;
+    std::unique_lock<std::mutex> guard(gSaveStore.lock, std::try_to_lock);
+    if (!guard.owns_lock()) return;          // the thread is busy with the lock: next frame
+
+    bool any = false;
+    for (int s = 0; s < SAVE_SLOT_COUNT; ++s) {
+        if (!gSaveQueue.queued[s] || !gSaveQueue.taken[s]) continue;
+        gSaveStore.posted[s].swap(gSaveQueue.bytes[s]);
+        gSaveStore.pending[s] = true;
+        gSaveQueue.queued[s] = false;
+        any = true;
+    }
+    if (any) gSaveStore.wake.notify_one();
+}
+
+// The stored slot, once: true with its bytes when the file was there
+static bool SaveTakeLoaded(SaveSlot slot, std::vector<unsigned char> &bytes)
+{
+    if (!gSaveQueue.started || gSaveQueue.taken[slot] || !gSaveStore.ready.load(std::memory_order_acquire)) return false;
+    std::unique_lock<std::mutex> guard(gSaveStore.lock, std::try_to_lock);
+    if (!guard.owns_lock()) return false;
+    gSaveQueue.taken[slot] = true;
+    bytes.swap(gSaveStore.loaded[slot]);
+    return gSaveStore.found[slot];
+}
+
+// Exit: hands over anything still queued and waits for the thread to write it
+static void SaveStop()
+{
+    if (!gSaveStore.thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(gSaveStore.lock);
+        for (int s = 0; s < SAVE_SLOT_COUNT; ++s) {
+            if (!gSaveQueue.queued[s] || !gSaveQueue.taken[s]) continue;
+            gSaveStore.posted[s].swap(gSaveQueue.bytes[s]);
+            gSaveStore.pending[s] = true;
+            gSaveQueue.queued[s] = false;
+        }
+        gSaveStore.stop = true;
+    }
+    gSaveStore.wake.notify_one();
+    gSaveStore.thread.join();
+}
+
+#else // web
+
+// -----------------------------------------------------------------------------------------
+// Web: IDBFS at /save. syncfs(true) fills MEMFS from IndexedDB once; each write goes to
+// MEMFS right away and syncfs(false) copies it back in the background (one at a time,
+// writes during a sync are picked up by one more sync).
+// -----------------------------------------------------------------------------------------
+static void SaveStart()
+{
+    gSaveQueue.started = true;
+    emscripten_run_script(
+        "Module.dodgeSave = { ready: false, syncing: false, again: false };"
+        "try { FS.mkdir('/save'); } catch (e) {}"
+        "FS.mount(IDBFS, {}, '/save');"
+        "FS.syncfs(true, function (err) { Module.dodgeSave.ready = true; });");
+}
+
+static bool SaveReady()
+{
+    return emscripten_run_script_int("(Module.dodgeSave && Module.dodgeSave.ready) ? 1 : 0") != 0;
+}
+
+static void SavePoll()
+{
+    if (!gSaveQueue.started) return;
+
+    bool any = false;
+    for (int s = 0; s < SAVE_SLOT_COUNT; ++s) {
+        if (!gSaveQueue.queued[s] || !gSaveQueue.taken[s]) continue;   // taken: the stored files are in
+        std::vector<unsigned char> &bytes = gSaveQueue.bytes[s];
+        if (!SaveFileData(SAVE_PATHS[s], bytes.data(), (int)bytes.size())) TraceLog(LOG_WARNING, "SAVE: could not write %s", SAVE_PATHS[s]);
+        gSaveQueue.queued[s] = false;
+        any = true;
+    }
+    if (!any) return;
+    emscripten_run_script(
+        "(function () {"
+        "  var s = Module.dodgeSave;"
+        "  function sync() {"
+        "    s.syncing = true;"
+        "    FS.syncfs(false, function (err) { s.syncing = false; if (s.again) { s.again = false; sync(); } });"
+        "  }"
+        "  if (s.syncing) s.again = true; else sync();"
+        "})();");
+}
+
+static bool SaveTakeLoaded(SaveSlot slot, std::vector<unsigned char> &bytes)
+{
+    if (!gSaveQueue.started || gSaveQueue.taken[slot] || !SaveReady()) return false;
+    gSaveQueue.taken[slot] = true;
+    if (!FileExists(SAVE_PATHS[slot])) return false;
+    int size = 0;
+    unsigned char *data = LoadFileData(SAVE_PATHS[slot], &size);
+    if (!data) return false;
+    bytes.assign(data, data + size);
+    UnloadFileData(data);
+    return true;
+}
+
+// Pending syncs finish on their own; the tab may close before, like any web storage
+static void SaveStop() {}
+
+#endif // SAVE_THREAD
@@ -0,0 +1,43 @@
+/*******************************************************************************************
+* simd.h - 4-wide float/int vectors for the hot loops (GCC/Clang vector extensions)
+*
+*   - Desktop: SSE on x86-64, NEON on ARM
+*   - Web: wasm simd128 when compiled with -msimd128; without it Emscripten lowers the
+*     same code to scalar wasm, so the flag is optional
+*   - Comparisons give lane masks (-1 true, 0 false) as I32x4
+*   - U8x16: 16 8-bit pixels for the software rasterizer's span fills and blends
+*******************************************************************************************/
+
+#pragma once
+
+#include <cstring>
+
+typedef float F32x4 __attribute__((vector_size(16)));
+typedef int   I32x4 __attribute__((vector_size(16)));
+typedef unsigned char U8x16 __attribute__((vector_size(16)));   // 8-bit pixels (raster.h)
+typedef unsigned short U16x16 __attribute__((vector_size(32)));  // U8x16 widened for products
+
+static const int SIMD_WIDTH = 4;
+
+static inline F32x4 LoadF32x4(const float *p) { F32x4 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void StoreF32x4(float *p, F32x4 v) { memcpy(p, &v, sizeof(v)); }
+static inline F32x4 SplatF32x4(float f) { return F32x4{ f, f, f, f }; }
+
+static inline F32x4 AbsF32x4(F32x4 v) { return (F32x4)((I32x4)v & 0x7FFFFFFF); }
+static inline F32x4 SelectF32x4(I32x4 mask, F32x4 a, F32x4 b) { return (F32x4)(((I32x4)a & mask) | ((I32x4)b & ~mask)); }
+static inline F32x4 MinF32x4(F32x4 a, F32x4 b) { return SelectF32x4(a < b, a, b); }
+static inline F32x4 MaxF32x4(F32x4 a, F32x4 b) { return SelectF32x4(a > b, a, b); }
+static inline F32x4 Max0F32x4(F32x4 v) { return (F32x4)((I32x4)v & (v > 0.0f)); }   // NaN -> 0
+
+static inline I32x4 LaneIndexI32x4() { return I32x4{ 0, 1, 2, 3 }; }
+static inline U8x16 SplatU8x16(unsigned char v) { return U8x16{} + v; }
+static inline U8x16 LoadU8x16(const unsigned char *p) { U8x16 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void StoreU8x16(unsigned char *p, U8x16 v) { memcpy(p, &v, sizeof(v)); }
+
+// v*scale/255 rounded, per pixel (exact: (x + 128 + ((x + 128) >> 8)) >> 8 for x <= 255*255)
+static inline U8x16 ScaleU8x16(U8x16 v, unsigned char scale) {
+    U16x16 x = __builtin_convertvector(v, U16x16)*(unsigned short)scale + (unsigned short)128;
+    return __builtin_convertvector((x + (x >> 8)) >> 8, U8x16);
+}
+
+static inline bool AnyI32x4(I32x4 mask) { return (mask[0] | mask[1] | mask[2] | mask[3]) != 0; }
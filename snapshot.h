@@ -0,0 +1,176 @@
+/*******************************************************************************************
+* snapshot.h - save states: the whole Game in one flat buffer (rewind, rollback, lookahead)
+*
+*   Layout (native endianness, in-memory only: not a file format, not portable):
+*     SnapshotHeader                    every Game field except the enemy arrays
+*     per kind: x[], y[], w[], h[], speedY[]   count floats each, live enemies only
+*
+*   - Save and load are a handful of memcpy calls: ~220 bytes + 20 bytes per enemy
+*   - SaveGameSnapshot() into a caller-owned buffer never allocates; the GameSnapshot
+*     overload grows its vector only when the enemy count beats the previous save
+*   - LoadGameSnapshot() restores into any Game (a clone for lookahead, the same Game for
+*     rollback); it only allocates when the target pool is smaller than the saved one
+*   - Restoring a snapshot and stepping the same inputs lands on the same GameChecksum()
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+static const int SNAPSHOT_VERSION = 3;
+
+struct SnapshotHeader {
+    int version;
+    int size;                                 // bytes, header included
+    GameState state;
+    unsigned int ticks;
+    Player player;
+    float score;
+    int bestScore;
+    int enemyCount, targetEnemies;
+    float speedScale;
+    bool difficultyRamp, invincible, fixedPoint;
+    WeatherKind weather;
+    GameRng rng;
+    int kindMix[3];
+    EnemyProfileTable profiles;
+    int poolCount, poolLimit, poolPeak;
+    int kindCount[ENEMY_KIND_COUNT];
+    float kindMaxSpeedY[ENEMY_KIND_COUNT];
+};
+
+static_assert(std::is_trivially_copyable<SnapshotHeader>::value, "snapshots are copied with memcpy");
+
+// Each live enemy is stored as this many floats (x, y, w, h, speedY)
+static const int SNAPSHOT_FLOATS_PER_ENEMY = 5;
+
+inline size_t GameSnapshotSize(const Game &game)
+{
+    return sizeof(SnapshotHeader) + (size_t)game.enemies.size()*SNAPSHOT_FLOATS_PER_ENEMY*sizeof(float);
+}
+
+// -----------------------------------------------------------------------------------------
+// Save: bytes written, 0 if 'capacity' is too small (see GameSnapshotSize())
+// -----------------------------------------------------------------------------------------
+inline size_t SaveGameSnapshot(const Game &game, void *buffer, size_t capacity)
+{
+    size_t size = GameSnapshotSize(game);
+    if (size > capacity) return 0;
+
+    SnapshotHeader h;
+    memset((void *)&h, 0, sizeof(h));        // padding too, so equal states give equal bytes
+    h.version = SNAPSHOT_VERSION;
+    h.size = (int)size;
+    h.state = game.state;
+    h.ticks = game.ticks;
+    h.player = game.player;
+    h.score = game.score;
+    h.bestScore = game.bestScore;
+    h.enemyCount = game.enemyCount;
+    h.targetEnemies = game.targetEnemies;
+    h.speedScale = game.speedScale;
+    h.difficultyRamp = game.difficultyRamp;
+    h.invincible = game.invincible;
+    h.fixedPoint = game.fixedPoint;
+    h.weather = game.weather;
+    h.rng = game.rng;
+    memcpy(h.kindMix, game.kindMix, sizeof(h.kindMix));
+    h.profiles = game.profiles;
+    h.poolCount = game.enemies.count;
+    h.poolLimit = game.enemies.limit;
+    h.poolPeak = game.enemies.peak;
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        h.kindCount[k] = game.enemies.kinds[k].count;
+        h.kindMaxSpeedY[k] = game.enemies.kinds[k].maxSpeedY;
+    }
+
+    unsigned char *out = (unsigned char *)buffer;
+    memcpy(out, &h, sizeof(h));
+    out += sizeof(h);
+    for (const EnemyBucket &b : game.enemies.kinds) {
+        size_t n = (size_t)b.count*sizeof(float);
+        memcpy(out, b.x.data(), n); out += n;
+        memcpy(out, b.y.data(), n); out += n;
+        memcpy(out, b.w.data(), n); out += n;
+        memcpy(out, b.h.data(), n); out += n;
+        memcpy(out, b.speedY.data(), n); out += n;
+    }
+    return size;
+}
+
+// -----------------------------------------------------------------------------------------
+// Load: false (game untouched) if the buffer is not a snapshot of this build's layout
+// -----------------------------------------------------------------------------------------
+inline bool LoadGameSnapshot(Game &game, const void *buffer, size_t size)
+{
+    if (size < sizeof(SnapshotHeader)) return false;
+    SnapshotHeader h;
+    memcpy(&h, buffer, sizeof(h));
+
+    int total = 0;
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        if (h.kindCount[k] < 0 || h.kindCount[k] > h.poolLimit) return false;
+        total += h.kindCount[k];
+    }
+    size_t expected = sizeof(h) + (size_t)total*SNAPSHOT_FLOATS_PER_ENEMY*sizeof(float);
+    if (h.version != SNAPSHOT_VERSION || (size_t)h.size != expected || size < expected || total != h.poolCount) return false;
+
+    game.state = h.state;
+    game.ticks = h.ticks;
+    game.player = h.player;
+    game.score = h.score;
+    game.bestScore = h.bestScore;
+    game.enemyCount = h.enemyCount;
+    game.targetEnemies = h.targetEnemies;
+    game.speedScale = h.speedScale;
+    game.difficultyRamp = h.difficultyRamp;
+    game.invincible = h.invincible;
+    game.fixedPoint = h.fixedPoint;
+    game.weather = h.weather;
+    game.rng = h.rng;
+    memcpy(game.kindMix, h.kindMix, sizeof(game.kindMix));
+    game.profiles = h.profiles;
+
+    EnemyPool &pool = game.enemies;
+    EnemyPoolReserve(pool, h.poolLimit);      // no-op unless the target pool is smaller
+    pool.limit = h.poolLimit;
+    pool.count = h.poolCount;
+    if (h.poolPeak > pool.peak) pool.peak = h.poolPeak;
+
+    const unsigned char *in = (const unsigned char *)buffer + sizeof(h);
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        EnemyBucket &b = pool.kinds[k];
+        b.count = h.kindCount[k];
+        b.maxSpeedY = h.kindMaxSpeedY[k];
+        size_t n = (size_t)b.count*sizeof(float);
+        memcpy(b.x.data(), in, n); in += n;
+        memcpy(b.y.data(), in, n); in += n;
+        memcpy(b.w.data(), in, n); in += n;
+        memcpy(b.h.data(), in, n); in += n;
+        memcpy(b.speedY.data(), in, n); in += n;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Owning snapshot: reuse one per slot (rewind ring, rollback history, lookahead root)
+// -----------------------------------------------------------------------------------------
+struct GameSnapshot {
+    std::vector<unsigned char> bytes;         // capacity only grows
+    size_t size = 0;
+};
+
+inline void SaveGameSnapshot(const Game &game, GameSnapshot &snap)
+{
+    size_t need = GameSnapshotSize(game);
+    if (snap.bytes.size() < need) snap.bytes.resize(need);
+    snap.size = SaveGameSnapshot(game, snap.bytes.data(), snap.bytes.size());
+}
+
+inline bool LoadGameSnapshot(Game &game, const GameSnapshot &snap)
+{
+    return snap.size > 0 && LoadGameSnapshot(game, snap.bytes.data(), snap.size);
+}
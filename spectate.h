@@ -0,0 +1,475 @@
+/*******************************************************************************************
+* spectate.h - spectator stream: the game's state, quantized to 16 bits and delta-coded
+*
+*   The playing game encodes one frame per tick (SpecEncode) and sends it to a relay
+*   (tools/relay.cpp), which copies the same bytes to every spectator: one encode per tick
+*   however many watch. Spectators decode (SpecDecode) and draw (SpecToGame).
+*
+*   Stream (TCP, little-endian): SpecHello, then frames. A frame is a SpecFrameHeader and
+*   `size` bytes of payload:
+*     varint score, bestScore
+*     zigzag player x, y, w, h              change since the previous frame
+*     per kind:
+*       varint count
+*       changes to x/w/h, in slot order     varint slot gap (from the previous change + 1;
+*                                           0 ends), u8 SpecChange mask, zigzag per field
+*       y of every slot                     zigzag (this step - last step): a falling enemy
+*                                           repeats its step, so most of these are 1 byte
+*
+*   - Positions and sizes are u16 in 1/16 px from -1024 px (SPEC_UNITS, SPEC_ORIGIN)
+*   - Deltas are against the previous frame, which every receiver has: TCP delivers in order
+*     and the relay starts each spectator at a keyframe. Keyframes (the same coding against
+*     an all-zero state) come every SPEC_KEYFRAME_TICKS, and after the source had to skip
+*     a tick, so a joining or lagging spectator is back in sync within 2 s
+*   - Each header carries a hash of the quantized state after the frame: a decoder that
+*     rebuilt anything else stops and waits for the next keyframe
+*   - SpecSource (desktop) sends from the main thread with non-blocking writes into a buffer
+*     reserved up front: no allocation, no waiting during PLAYING. If the relay falls
+*     SPEC_SOURCE_BACKLOG behind, ticks are skipped, never queued without bound.
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include <cstring>
+#include <vector>
+#ifndef __EMSCRIPTEN__
+  #include "net.h"
+#endif
+
+static const char SPEC_MAGIC[4] = { 'D', 'S', 'P', 'C' };
+static const int SPEC_VERSION = 1;
+static const int SPEC_KEYFRAME_TICKS = 120;
+static const float SPEC_UNITS = 16.0f;                // quantization steps per pixel
+static const float SPEC_ORIGIN = 1024.0f;             // quantized 0 is -1024 px (range -1024..3072 px)
+static const int SPEC_MAX_ENEMIES = 1 << 20;          // decoder limit per kind
+static const unsigned int SPEC_MAX_PAYLOAD = 1u << 26;
+static const int SPEC_SOURCE_BACKLOG = 256*1024;      // unsent bytes before the source skips ticks
+static const int SPEC_WORST_ENEMY = 5 + 5 + 1 + 3*5;  // y, gap, mask, x/w/h varints
+
+enum SpecFrameType { SPEC_KEYFRAME = 1, SPEC_DELTA = 2 };
+enum SpecChange { SPEC_X = 1 << 0, SPEC_W = 1 << 1, SPEC_H = 1 << 2 };
+
+struct SpecHello {
+    char magic[4];
+    int version;
+};
+
+struct SpecFrameHeader {
+    unsigned int size;                  // payload bytes after this header
+    unsigned char type;                 // SpecFrameType
+    unsigned char state;                // GameState
+    unsigned char weather;              // WeatherKind
+    unsigned char reserved;
+    unsigned int tick;                  // source tick (gaps are ticks the source skipped)
+    unsigned int check;                 // SpecStateHash() after this frame
+};
+
+static_assert(sizeof(SpecHello) == 8 && sizeof(SpecFrameHeader) == 16, "the wire layout is the struct layout");
+
+// The quantized state of one kind, and its coder state
+struct SpecBucket {
+    std::vector<unsigned short> x, y, w, h;
+    std::vector<int> dy;                // last y step per slot (the prediction for the next one)
+    std::vector<unsigned char> changed; // x/w/h changed this frame (scratch)
+    int count = 0;
+};
+
+// What a spectator knows, identical on both ends after every frame
+struct SpecState {
+    bool valid = false;                 // decoder: in sync (a keyframe arrived, nothing failed since)
+    unsigned int tick = 0;
+    unsigned char state = 0, weather = 0;
+    int score = 0, bestScore = 0;
+    unsigned short player[4] = {};      // x, y, w, h
+    SpecBucket kinds[ENEMY_KIND_COUNT];
+};
+
+// -----------------------------------------------------------------------------------------
+// Coding helpers
+// -----------------------------------------------------------------------------------------
+inline unsigned short SpecQuantize(float v)
+{
+    float q = (v + SPEC_ORIGIN)*SPEC_UNITS + 0.5f;
+    return (unsigned short)((q < 0.0f) ? 0.0f : (q > 65535.0f) ? 65535.0f : q);
+}
+
+inline float SpecDequantize(unsigned short q) { return q/SPEC_UNITS - SPEC_ORIGIN; }
+
+inline unsigned int SpecZigzag(int v) { return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31); }
+inline int SpecUnzigzag(unsigned int v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+inline unsigned char *SpecPutVarint(unsigned char *p, unsigned int v)
+{
+    while (v >= 0x80) { *p++ = (unsigned char)(v | 0x80); v >>= 7; }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+inline bool SpecGetVarint(const unsigned char *&p, const unsigned char *end, unsigned int &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        unsigned char b = *p++;
+        v |= (unsigned int)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Room for `capacity` enemies per kind (allocates only when that grows)
+inline void SpecReserve(SpecState &s, int capacity)
+{
+    for (SpecBucket &b : s.kinds) {
+        if ((int)b.x.size() >= capacity) continue;
+        b.x.resize(capacity); b.y.resize(capacity); b.w.resize(capacity); b.h.resize(capacity);
+        b.dy.resize(capacity); b.changed.resize(capacity);
+    }
+}
+
+// The all-zero state keyframes are coded against
+inline void SpecResetState(SpecState &s)
+{
+    s.score = s.bestScore = 0;
+    memset(s.player, 0, sizeof(s.player));
+    for (SpecBucket &b : s.kinds) b.count = 0;
+}
+
+// Slots [from, to) join: they start from zero like in a keyframe
+inline void SpecClearSlots(SpecBucket &b, int from, int to)
+{
+    for (int i = from; i < to; ++i) { b.x[i] = b.y[i] = b.w[i] = b.h[i] = 0; b.dy[i] = 0; }
+}
+
+// 8 bytes per step: byte-wise HashBytes() would be half the cost of an encode
+inline unsigned long long SpecHashWords(unsigned long long h, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (; size >= 8; p += 8, size -= 8) {
+        unsigned long long w;
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ w)*0x9E3779B97F4A7C15ull;
+        h ^= h >> 32;
+    }
+    for (; size > 0; --size) h = (h ^ *p++)*0x100000001B3ull;
+    return h;
+}
+
+inline unsigned int SpecStateHash(const SpecState &s)
+{
+    unsigned long long h = 0xCBF29CE484222325ull;
+    const int head[3] = { s.score, s.bestScore, 0 };
+    h = SpecHashWords(h, head, sizeof(head));
+    h = SpecHashWords(h, s.player, sizeof(s.player));
+    for (const SpecBucket &b : s.kinds) {
+        size_t n = (size_t)b.count*sizeof(unsigned short);
+        h = SpecHashWords(h, &b.count, sizeof(b.count));
+        h = SpecHashWords(h, b.x.data(), n);
+        h = SpecHashWords(h, b.y.data(), n);
+        h = SpecHashWords(h, b.w.data(), n);
+        h = SpecHashWords(h, b.h.data(), n);
+    }
+    return (unsigned int)(h ^ (h >> 32));
+}
+
+// -----------------------------------------------------------------------------------------
+// Encoding (source): appends one frame to `out` and moves `base` to the new state
+// -----------------------------------------------------------------------------------------
+inline void SpecEncode(SpecState &base, const Game &game, unsigned int tick, bool keyframe, std::vector<unsigned char> &out)
+{
+    if (keyframe) SpecResetState(base);
+    SpecReserve(base, game.enemies.capacity());
+
+    size_t start = out.size();
+    out.resize(start + sizeof(SpecFrameHeader) + 64 + ENEMY_KIND_COUNT*5 + (size_t)game.enemies.count*SPEC_WORST_ENEMY);
+    unsigned char *const frame = out.data() + start;
+    unsigned char *p = frame + sizeof(SpecFrameHeader);
+
+    base.score = (int)game.score;
+    base.bestScore = game.bestScore;
+    p = SpecPutVarint(p, (unsigned int)base.score);
+    p = SpecPutVarint(p, (unsigned int)base.bestScore);
+    const Rectangle &r = game.player.rect;
+    const unsigned short player[4] = { SpecQuantize(r.x), SpecQuantize(r.y), SpecQuantize(r.width), SpecQuantize(r.height) };
+    for (int i = 0; i < 4; ++i) {
+        p = SpecPutVarint(p, SpecZigzag(player[i] - base.player[i]));
+        base.player[i] = player[i];
+    }
+
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        const EnemyBucket &e = game.enemies.kinds[k];
+        SpecBucket &b = base.kinds[k];
+        if (e.count > b.count) SpecClearSlots(b, b.count, e.count);
+        b.count = e.count;
+        p = SpecPutVarint(p, (unsigned int)e.count);
+
+        // x/w/h: only the slots that changed (recycled, or swapped in by a deactivation)
+        int prev = -1;
+        for (int i = 0; i < e.count; ++i) {
+            unsigned short qx = SpecQuantize(e.x[i]), qw = SpecQuantize(e.w[i]), qh = SpecQuantize(e.h[i]);
+            unsigned char mask = (unsigned char)((qx != b.x[i] ? SPEC_X : 0) | (qw != b.w[i] ? SPEC_W : 0) | (qh != b.h[i] ? SPEC_H : 0));
+            b.changed[i] = mask;
+            if (!mask) continue;
+            p = SpecPutVarint(p, (unsigned int)(i - prev));
+            *p++ = mask;
+            if (mask & SPEC_X) p = SpecPutVarint(p, SpecZigzag(qx - b.x[i]));
+            if (mask & SPEC_W) p = SpecPutVarint(p, SpecZigzag(qw - b.w[i]));
+            if (mask & SPEC_H) p = SpecPutVarint(p, SpecZigzag(qh - b.h[i]));
+            b.x[i] = qx; b.w[i] = qw; b.h[i] = qh;
+            prev = i;
+        }
+        p = SpecPutVarint(p, 0);
+
+        // y: this step against the slot's last step (a changed slot holds another enemy now)
+        for (int i = 0; i < e.count; ++i) {
+            unsigned short qy = SpecQuantize(e.y[i]);
+            int step = qy - b.y[i];
+            p = SpecPutVarint(p, SpecZigzag(step - (b.changed[i] ? 0 : b.dy[i])));
+            b.dy[i] = step;
+            b.y[i] = qy;
+        }
+    }
+
+    base.tick = tick;
+    base.state = (unsigned char)game.state;
+    base.weather = (unsigned char)game.weather;
+    base.valid = true;
+
+    SpecFrameHeader h;
+    h.size = (unsigned int)(p - frame - sizeof(SpecFrameHeader));
+    h.type = keyframe ? SPEC_KEYFRAME : SPEC_DELTA;
+    h.state = base.state;
+    h.weather = base.weather;
+    h.reserved = 0;
+    h.tick = tick;
+    h.check = SpecStateHash(base);
+    memcpy(frame, &h, sizeof(h));
+    out.resize(start + sizeof(SpecFrameHeader) + h.size);
+}
+
+// -----------------------------------------------------------------------------------------
+// Decoding (spectator): one whole frame, header included. False if it could not be applied:
+// a delta while out of sync, or a damaged frame (then out of sync until the next keyframe).
+// -----------------------------------------------------------------------------------------
+inline bool SpecDecode(SpecState &s, const unsigned char *frame, size_t size)
+{
+    SpecFrameHeader h;
+    if (size < sizeof(h)) return false;
+    memcpy(&h, frame, sizeof(h));
+    if (size != sizeof(h) + h.size || (h.type != SPEC_KEYFRAME && h.type != SPEC_DELTA)) return false;
+    if (h.type == SPEC_KEYFRAME) SpecResetState(s);
+    else if (!s.valid) return false;
+    s.valid = false;
+
+    const unsigned char *p = frame + sizeof(h), *end = p + h.size;
+    unsigned int v;
+    if (!SpecGetVarint(p, end, v)) return false;
+    s.score = (int)v;
+    if (!SpecGetVarint(p, end, v)) return false;
+    s.bestScore = (int)v;
+    for (int i = 0; i < 4; ++i) {
+        if (!SpecGetVarint(p, end, v)) return false;
+        s.player[i] = (unsigned short)(s.player[i] + SpecUnzigzag(v));
+    }
+
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        SpecBucket &b = s.kinds[k];
+        if (!SpecGetVarint(p, end, v) || v > (unsigned int)SPEC_MAX_ENEMIES) return false;
+        int count = (int)v;
+        SpecReserve(s, count);
+        if (count > b.count) SpecClearSlots(b, b.count, count);
+        b.count = count;
+        memset(b.changed.data(), 0, (size_t)count);
+
+        for (int i = -1; ; ) {
+            if (!SpecGetVarint(p, end, v)) return false;
+            if (v == 0) break;
+            if (v > (unsigned int)(count - 1 - i) || p >= end) return false;
+            i += (int)v;
+            unsigned char mask = *p++;
+            b.changed[i] = mask;
+            unsigned short *fields[3] = { &b.x[i], &b.w[i], &b.h[i] };
+            for (int f = 0; f < 3; ++f) {
+                if (!(mask & (1 << f))) continue;
+                if (!SpecGetVarint(p, end, v)) return false;
+                *fields[f] = (unsigned short)(*fields[f] + SpecUnzigzag(v));
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            if (!SpecGetVarint(p, end, v)) return false;
+            int step = SpecUnzigzag(v) + (b.changed[i] ? 0 : b.dy[i]);
+            b.dy[i] = step;
+            b.y[i] = (unsigned short)(b.y[i] + step);
+        }
+    }
+
+    s.tick = h.tick;
+    s.state = h.state;
+    s.weather = h.weather;
+    if (p != end || SpecStateHash(s) != h.check) return false;
+    s.valid = true;
+    return true;
+}
+
+// The decoded state as a Game, for DrawWorld (enemy speeds are not sent: drawing only)
+inline void SpecToGame(const SpecState &s, Game &game)
+{
+    game.state = (GameState)((s.state <= (int)GameState::GAME_OVER) ? s.state : 0);
+    game.weather = (WeatherKind)((s.weather <= (int)WeatherKind::RAINY) ? s.weather : 0);
+    game.score = (float)s.score;
+    game.bestScore = s.bestScore;
+    game.player.rect = { SpecDequantize(s.player[0]), SpecDequantize(s.player[1]),
+                         SpecDequantize(s.player[2]), SpecDequantize(s.player[3]) };
+    game.player.prevRect = game.player.rect;
+
+    int total = 0;
+    for (const SpecBucket &b : s.kinds) total += b.count;
+    EnemyPoolReserve(game.enemies, total);
+    for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+        const SpecBucket &b = s.kinds[k];
+        EnemyBucket &e = game.enemies.kinds[k];
+        for (int i = 0; i < b.count; ++i) {
+            e.x[i] = SpecDequantize(b.x[i]); e.y[i] = SpecDequantize(b.y[i]);
+            e.w[i] = SpecDequantize(b.w[i]); e.h[i] = SpecDequantize(b.h[i]);
+            e.speedY[i] = 0.0f;
+        }
+        e.count = b.count;
+    }
+    game.enemies.count = total;
+}
+
+// -----------------------------------------------------------------------------------------
+// Stream reader (relay, spectators): bytes in, whole frames out
+// -----------------------------------------------------------------------------------------
+struct SpecReader {
+    std::vector<unsigned char> bytes;
+    size_t start = 0;                   // first byte not handed out yet
+    bool hello = false;
+};
+
+inline void SpecReaderFeed(SpecReader &r, const void *data, size_t size)
+{
+    if (r.start > 0 && r.start == r.bytes.size()) { r.bytes.clear(); r.start = 0; }
+    else if (r.start > (1u << 16)) { r.bytes.erase(r.bytes.begin(), r.bytes.begin() + (long)r.start); r.start = 0; }
+    r.bytes.insert(r.bytes.end(), (const unsigned char *)data, (const unsigned char *)data + size);
+}
+
+// 1: a frame (header included, valid until the next Feed), 0: need more bytes, -1: not a spectator stream
+inline int SpecReaderNext(SpecReader &r, const unsigned char *&frame, size_t &size)
+{
+    size_t have = r.bytes.size() - r.start;
+    if (!r.hello) {
+        if (have < sizeof(SpecHello)) return 0;
+        SpecHello hello;
+        memcpy(&hello, r.bytes.data() + r.start, sizeof(hello));
+        if (memcmp(hello.magic, SPEC_MAGIC, sizeof(hello.magic)) != 0 || hello.version != SPEC_VERSION) return -1;
+        r.hello = true;
+        r.start += sizeof(hello);
+        have -= sizeof(hello);
+    }
+    if (have < sizeof(SpecFrameHeader)) return 0;
+    SpecFrameHeader h;
+    memcpy(&h, r.bytes.data() + r.start, sizeof(h));
+    if (h.size > SPEC_MAX_PAYLOAD) return -1;
+    if (have < sizeof(h) + h.size) return 0;
+    frame = r.bytes.data() + r.start;
+    size = sizeof(h) + h.size;
+    r.start += size;
+    return 1;
+}
+
+inline bool SpecIsKeyframe(const unsigned char *frame)
+{
+    SpecFrameHeader h;
+    memcpy(&h, frame, sizeof(h));
+    return h.type == SPEC_KEYFRAME;
+}
+
+inline void SpecPutHello(std::vector<unsigned char> &out)
+{
+    SpecHello hello;
+    memcpy(hello.magic, SPEC_MAGIC, sizeof(hello.magic));
+    hello.version = SPEC_VERSION;
+    out.insert(out.end(), (const unsigned char *)&hello, (const unsigned char *)&hello + sizeof(hello));
+}
+
+#ifndef __EMSCRIPTEN__
+
+// -----------------------------------------------------------------------------------------
+// Source (desktop): the game's connection to the relay
+// -----------------------------------------------------------------------------------------
+struct SpecSource {
+    int fd = -1;
+    SpecState base;
+    std::vector<unsigned char> out;     // [sent, size) not written yet
+    size_t sent = 0;
+    unsigned int tick = 0;
+    int sinceKeyframe = 0;
+    bool needKeyframe = true;
+    unsigned long frames = 0, skipped = 0;
+    unsigned long long bytes = 0;
+};
+
+// Outside PLAYING: connects (blocking) and reserves everything for `capacity` enemies
+inline bool SpecSourceOpen(SpecSource &src, const char *host, int port, int capacity)
+{
+    src.fd = NetConnectTcp(host, port);
+    if (src.fd < 0) return false;
+    fcntl(src.fd, F_SETFL, fcntl(src.fd, F_GETFL, 0) | O_NONBLOCK);
+    src.out.reserve((size_t)SPEC_SOURCE_BACKLOG + sizeof(SpecFrameHeader) + 64 + ENEMY_KIND_COUNT*5 +
+                    (size_t)capacity*SPEC_WORST_ENEMY);
+    SpecReserve(src.base, capacity);
+    src.out.clear();
+    src.sent = 0;
+    SpecPutHello(src.out);
+    src.needKeyframe = true;
+    return true;
+}
+
+inline void SpecSourceClose(SpecSource &src)
+{
+    NetClose(src.fd);
+    src.fd = -1;
+}
+
+// Writes what the socket takes now; false (and closed) if the relay went away
+inline bool SpecSourceFlush(SpecSource &src)
+{
+    while (src.sent < src.out.size()) {
+        ssize_t n = send(src.fd, src.out.data() + src.sent, src.out.size() - src.sent, MSG_NOSIGNAL);
+        if (n > 0) { src.sent += (size_t)n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        SpecSourceClose(src);
+        return false;
+    }
+    if (src.sent == src.out.size()) { src.out.clear(); src.sent = 0; }
+    return true;
+}
+
+// Once per tick: encodes the state (or skips the tick while the relay is too far behind)
+inline void SpecSourceTick(SpecSource &src, const Game &game)
+{
+    if (src.fd < 0 || !SpecSourceFlush(src)) return;
+    unsigned int tick = src.tick++;
+    if (src.out.size() - src.sent > (size_t)SPEC_SOURCE_BACKLOG) {
+        src.skipped++;                  // `base` stays the last frame sent, so the next delta still applies
+        return;
+    }
+    if (src.sent > 0) {
+        memmove(src.out.data(), src.out.data() + src.sent, src.out.size() - src.sent);
+        src.out.resize(src.out.size() - src.sent);
+        src.sent = 0;
+    }
+
+    bool keyframe = src.needKeyframe || src.sinceKeyframe + 1 >= SPEC_KEYFRAME_TICKS;
+    size_t before = src.out.size();
+    SpecEncode(src.base, game, tick, keyframe, src.out);
+    src.bytes += src.out.size() - before;
+    src.frames++;
+    src.sinceKeyframe = keyframe ? 0 : src.sinceKeyframe + 1;
+    src.needKeyframe = false;
+    SpecSourceFlush(src);
+}
+
+#endif // !__EMSCRIPTEN__
@@ -0,0 +1,157 @@
+/*******************************************************************************************
+* stress.h - stress mode for sizing kiosk hardware
+*
+*   Starts straight into an invincible PLAYING run and keeps adding enemies at a fixed
+*   rate until the average frame time goes over budget, then reports the largest enemy
+*   count that still fitted the budget ("max sustainable").
+*
+*   Parameters (parsed once at startup):
+*     desktop:  --stress --enemies 100 --mix 1,1,2 --spawn-rate 500 --budget-ms 16.7 --max-enemies 200000
+*     web:      index.html?stress=1&enemies=100&mix=1,1,2&spawn-rate=500&budget-ms=16.7&max-enemies=200000
+*
+*   --fixed (?fixed=1) also goes through here: the fixed-point tick (fixed.h), stress or not
+*
+*   --mix is the sun,cloud,rain spawn weights (default: follow the weather)
+*   --spawn-rate is enemies added per second while ramping (0 = fixed count, no ramp)
+*   The frame cap is lifted (SetTargetFPS(0)) so frame time measures the real work.
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const int STRESS_WINDOW = 60;          // frames averaged per measurement
+
+struct StressConfig {
+    bool enabled = false;
+    int enemies = 10;                         // starting enemy count (also used without --stress)
+    int mix[3] = { 0, 0, 0 };                 // sun/cloud/rain weights
+    float spawnRate = 500.0f;                 // enemies added per second while ramping
+    float budgetMs = 1000.0f/60.0f;           // frame budget
+    int maxEnemies = 200000;                  // capacity reserved up front (ramp stops here)
+    bool fixedPoint = false;                  // --fixed / ?fixed=1 (also used without --stress)
+};
+
+struct StressState {
+    float frameMs[STRESS_WINDOW];             // ring of recent frame times
+    int frames;
+    float spawnDebt;                          // fractional enemies owed by spawnRate
+    float avgMs;
+    int sustainable;                          // largest count whose window average fit the budget
+    int overBudgetWindows;                    // consecutive windows over budget
+    bool done;
+};
+
+// -----------------------------------------------------------------------------------------
+// Parameters: the same key/value handler serves argv and the URL query string
+// -----------------------------------------------------------------------------------------
+static bool StressApplyOption(StressConfig &cfg, const char *key, const char *value)
+{
+    if (!strcmp(key, "stress")) cfg.enabled = (value == nullptr) || (atoi(value) != 0);
+    else if (!strcmp(key, "fixed")) cfg.fixedPoint = (value == nullptr) || (atoi(value) != 0);
+    else if (!value) return false;
+    else if (!strcmp(key, "enemies")) cfg.enemies = atoi(value);
+    else if (!strcmp(key, "spawn-rate")) cfg.spawnRate = (float)atof(value);
+    else if (!strcmp(key, "budget-ms")) cfg.budgetMs = (float)atof(value);
+    else if (!strcmp(key, "max-enemies")) cfg.maxEnemies = atoi(value);
+    else if (!strcmp(key, "mix")) {
+        if (sscanf(value, "%d,%d,%d", &cfg.mix[0], &cfg.mix[1], &cfg.mix[2]) != 3) return false;
+    }
+    else return false;
+    return true;
+}
+
+// Desktop: --key value (and a bare --stress or --fixed); unknown arguments are left for the caller
+static void StressParseArgs(StressConfig &cfg, int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--", 2) != 0) continue;
+        const char *key = argv[i] + 2;
+        if (!strcmp(key, "stress") || !strcmp(key, "fixed")) { StressApplyOption(cfg, key, nullptr); continue; }
+        if (i + 1 < argc && StressApplyOption(cfg, key, argv[i + 1])) i++;
+    }
+}
+
+// Web: "?stress=1&enemies=100&mix=1,1,2"
+static inline void StressParseQuery(StressConfig &cfg, const char *query)
+{
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", (query && query[0] == '?') ? query + 1 : (query ? query : ""));
+
+    for (char *pair = strtok(buf, "&"); pair; pair = strtok(nullptr, "&")) {
+        char *eq = strchr(pair, '=');
+        if (eq) *eq = '\0';
+        StressApplyOption(cfg, pair, eq ? eq + 1 : nullptr);
+    }
+}
+
+// Apply the config to a freshly initialised game (capacity, mix, invincibility, start PLAYING)
+static void StressSetup(const StressConfig &cfg, Game &game)
+{
+    game.enemyCount = cfg.enemies;
+    memcpy(game.kindMix, cfg.mix, sizeof(game.kindMix));
+    if (!cfg.enabled) return;
+
+    // Reserve everything now so the ramp never reallocates mid-run
+    EnemyPoolReserve(game.enemies, cfg.maxEnemies);
+    game.invincible = true;
+    game.difficultyRamp = false;
+    ResetGame(game);
+    ChangeState(game, GameState::PLAYING);
+}
+
+// -----------------------------------------------------------------------------------------
+// Once per frame: record the frame time, ramp the enemy count, detect the budget limit
+// -----------------------------------------------------------------------------------------
+static void StressUpdate(const StressConfig &cfg, StressState &st, Game &game, float frameTimeSec)
+{
+    if (!cfg.enabled || st.done) return;
+
+    float ms = frameTimeSec*1000.0f;
+    st.frameMs[st.frames % STRESS_WINDOW] = ms;
+    st.frames++;
+
+    // Judge once per full window so a single hitch does not end the ramp
+    if (st.frames % STRESS_WINDOW == 0) {
+        float sum = 0.0f;
+        for (int i = 0; i < STRESS_WINDOW; ++i) sum += st.frameMs[i];
+        st.avgMs = sum/STRESS_WINDOW;
+
+        int count = game.enemies.size();
+        if (st.avgMs <= cfg.budgetMs) {
+            if (count > st.sustainable) st.sustainable = count;
+            st.overBudgetWindows = 0;
+        } else if (++st.overBudgetWindows >= 3) {
+            st.done = true;
+        }
+
+        if (cfg.spawnRate <= 0.0f || count >= cfg.maxEnemies) st.done = true;
+        if (st.done) {
+            printf("STRESS: max sustainable enemies %d (budget %.2f ms, last window %.2f ms at %d enemies)\n",
+                   st.sustainable, cfg.budgetMs, st.avgMs, count);
+            fflush(stdout);
+            return;
+        }
+    }
+
+    // Ramp: add spawnRate enemies per second (fractional ones carry over)
+    if (st.overBudgetWindows == 0) {
+        st.spawnDebt += cfg.spawnRate*frameTimeSec;
+        while (st.spawnDebt >= 1.0f && SpawnEnemy(game, PickEnemyKind(game))) st.spawnDebt -= 1.0f;
+        game.enemyCount = game.enemies.size();
+    }
+}
+
+static void StressDrawOverlay(const StressConfig &cfg, const StressState &st, const Game &game)
+{
+    if (!cfg.enabled) return;
+
+    DrawRectangle(10, 70, 330, 70, Color{ 0, 0, 0, 170 });
+    DrawText(TextFormat("STRESS  enemies %d", game.enemies.size()), 18, 78, 20, YELLOW);
+    DrawText(TextFormat("avg %.2f ms / budget %.2f ms", st.avgMs, cfg.budgetMs), 18, 100, 16, RAYWHITE);
+    DrawText(TextFormat("%s %d", st.done ? "RESULT: max sustainable" : "sustainable so far", st.sustainable),
+             18, 120, 16, st.done ? GREEN : LIGHTGRAY);
+}
@@ -0,0 +1,145 @@
+/*******************************************************************************************
+* tickhash.h - per-tick state hash streams (.hashes) for the desync detector
+*
+*   A stream holds Game::tickHash after every StepGame() of a run. Two runs of the same
+*   recording (native and wasm, two compilers, before and after a change) compared tick by
+*   tick differ first where they diverged, and the field says in which part of the state
+*   (player, enemies, score, rng). tools/desync.cpp does the comparing.
+*
+*   Layout (little-endian):
+*     TickHashHeader                        16 bytes
+*     { u32 per TickHashField,              20 bytes per tick, until end of file
+*       u32 enemy windows }
+*
+*   - Each field is its 64-bit hash folded to 32 bits: a false match is 1 in 4 billion per
+*     field and tick, and 5 minutes at 60 Hz take 360 KB
+*   - The enemy windows (TickHash::enemyWindows) say how many ticks the enemy hash takes to
+*     see every enemy's y, so how late an enemy divergence can show up. Version 1 streams
+*     have no such column and load with it unknown (0)
+*   - TickHashRecorder streams ticks straight to the file, like ReplayRecorder (replay.h);
+*     main --record <file> writes <file>.hashes next to the recording
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const char TICK_HASH_MAGIC[8] = { 'D', 'O', 'D', 'G', 'E', 'H', 'S', 'H' };
+static const int TICK_HASH_VERSION = 2;
+
+struct TickHashHeader {
+    char magic[8];
+    int version;
+    int fields;                         // TICK_HASH_FIELDS when written
+};
+
+struct TickHashStream {
+    std::vector<unsigned int> values;   // TICK_HASH_FIELDS per tick
+    std::vector<unsigned int> windows;  // TickHash::enemyWindows per tick (empty: version 1)
+
+    int ticks() const { return (int)(values.size()/TICK_HASH_FIELDS); }
+    unsigned int at(int tick, int field) const { return values[(size_t)tick*TICK_HASH_FIELDS + field]; }
+    unsigned int enemyWindows(int tick) const { return windows.empty() ? 0 : windows[(size_t)tick]; }
+};
+
+inline unsigned int FoldTickHash(unsigned long long h) { return (unsigned int)(h ^ (h >> 32)); }
+
+inline void AppendTickHash(TickHashStream &stream, const TickHash &t)
+{
+    for (int f = 0; f < TICK_HASH_FIELDS; ++f) stream.values.push_back(FoldTickHash(t.field[f]));
+    stream.windows.push_back((unsigned)t.enemyWindows);
+}
+
+// -----------------------------------------------------------------------------------------
+// Recording (main --record, regress --hashes)
+// -----------------------------------------------------------------------------------------
+struct TickHashRecorder {
+    FILE *file = nullptr;
+    unsigned long ticks = 0;
+};
+
+inline bool TickHashRecordBegin(TickHashRecorder &rec, const char *path)
+{
+    rec.file = fopen(path, "wb");
+    if (!rec.file) return false;
+
+    TickHashHeader h = {};
+    memcpy(h.magic, TICK_HASH_MAGIC, sizeof(h.magic));
+    h.version = TICK_HASH_VERSION;
+    h.fields = TICK_HASH_FIELDS;
+    fwrite(&h, sizeof(h), 1, rec.file);
+    rec.ticks = 0;
+    return true;
+}
+
+inline void TickHashRecordTick(TickHashRecorder &rec, const TickHash &t)
+{
+    if (!rec.file) return;
+    unsigned int buf[TICK_HASH_FIELDS + 1];
+    for (int f = 0; f < TICK_HASH_FIELDS; ++f) buf[f] = FoldTickHash(t.field[f]);
+    buf[TICK_HASH_FIELDS] = (unsigned)t.enemyWindows;
+    fwrite(buf, sizeof(buf), 1, rec.file);
+    rec.ticks++;
+}
+
+inline void TickHashRecordEnd(TickHashRecorder &rec)
+{
+    if (!rec.file) return;
+    fclose(rec.file);
+    rec.file = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------
+// Loading and comparing (headless tools)
+// -----------------------------------------------------------------------------------------
+inline bool LoadTickHashes(const char *path, TickHashStream &stream)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    TickHashHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, TICK_HASH_MAGIC, sizeof(h.magic)) == 0 &&
+              (h.version == 1 || h.version == TICK_HASH_VERSION) && h.fields == TICK_HASH_FIELDS;
+
+    stream.values.clear();
+    stream.windows.clear();
+    size_t perTick = (ok && h.version >= 2) ? TICK_HASH_FIELDS + 1 : TICK_HASH_FIELDS;
+    unsigned int buf[TICK_HASH_FIELDS + 1];
+    while (ok && fread(buf, sizeof(unsigned int), perTick, f) == perTick) {
+        stream.values.insert(stream.values.end(), buf, buf + TICK_HASH_FIELDS);
+        if (perTick > TICK_HASH_FIELDS) stream.windows.push_back(buf[TICK_HASH_FIELDS]);
+    }
+    fclose(f);
+    return ok;
+}
+
+// First tick at which the streams differ over the ticks both have (-1 if none), and a
+// TickHashField bit mask of the fields that differ there
+inline int FirstDivergentTick(const TickHashStream &a, const TickHashStream &b, unsigned &fieldMask)
+{
+    int ticks = (a.ticks() < b.ticks()) ? a.ticks() : b.ticks();
+    fieldMask = 0;
+    for (int t = 0; t < ticks; ++t) {
+        for (int f = 0; f < TICK_HASH_FIELDS; ++f)
+            if (a.at(t, f) != b.at(t, f)) fieldMask |= 1u << f;
+        if (fieldMask) return t;
+    }
+    return -1;
+}
+
+// Earliest tick an enemy divergence first seen at `tick` can have started at: enemy y is
+// hashed a window at a time, so a y that drifted at tick t shows up as late as
+// t + enemyWindows(t) - 1. `tick` itself if every enemy was hashed there, -1 if a stream is
+// version 1 and does not say
+inline int EarliestEnemyDivergence(const TickHashStream &a, const TickHashStream &b, int tick)
+{
+    if (a.windows.empty() || b.windows.empty()) return -1;
+    for (int t = 0; t < tick; ++t) {
+        unsigned int w = (a.enemyWindows(t) > b.enemyWindows(t)) ? a.enemyWindows(t) : b.enemyWindows(t);
+        if (t + (int)w - 1 >= tick) return t;
+    }
+    return tick;
+}
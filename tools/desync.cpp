@@ -0,0 +1,126 @@
+/*******************************************************************************************
+* desync.cpp - desync detector: compares two runs' per-tick state hashes (tickhash.h)
+*
+*   - Two .hashes files (main --record writes one next to each recording, regress --hashes
+*     writes one for any recording): prints the first tick where they differ and which
+*     parts of the state differ there (player, enemies, score, rng), then the first
+*     divergent tick of each part, since one part usually drags the others along later
+*   - Enemy y is hashed a window of TICK_HASH_WINDOW enemies per kind a tick (game.h), so with
+*     more enemies than that an enemy divergence is seen up to count/TICK_HASH_WINDOW ticks
+*     after it started. The stream records how many windows each tick had, and the tool
+*     prints the range of ticks the enemy divergence can have started in
+*   - --replay runs the recording on this build (Game::hashTicks) and compares that with
+*     another build's .hashes, e.g. one recorded in the browser; at the divergent tick it
+*     also prints this build's input and state there
+*   - A stream that is a prefix of the other (a run closed early) is not a desync
+*
+* USAGE
+*   dodge_desync <a.hashes> <b.hashes>
+*   dodge_desync --replay <run.rec> <other.hashes>
+*
+* Exit code: 0 no divergence, 1 divergence, 2 usage or I/O error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../replay.h"
+#include "../tickhash.h"
+#include <cstdio>
+#include <cstring>
+
+// This build's stream for the recording, and its state after tick `stopTick` (-1: the end)
+static void ReplayHashes(const Replay &replay, Game &game, TickHashStream &stream, int stopTick)
+{
+    game.hashTicks = true;
+    InitGameFromReplay(game, replay);
+    stream.values.clear();
+    stream.values.reserve(replay.ticks.size()*TICK_HASH_FIELDS);
+    for (size_t i = 0; i < replay.ticks.size(); ++i) {
+        StepGame(game, replay.ticks[i]);
+        AppendTickHash(stream, game.tickHash);
+        if ((int)i == stopTick) return;
+    }
+}
+
+static void PrintState(const Game &game, const GameInput &in)
+{
+    const Rectangle &r = game.player.rect;
+    printf("  this build after it: input keys 0x%02x dt %.6f | %s, player (%.4f, %.4f), score %.4f, "
+           "%d enemies (%d/%d/%d), rng %016llx\n",
+           in.keys, in.dt, STATE_NAMES[(int)game.state], r.x, r.y, game.score, game.enemies.count,
+           game.enemies.kinds[0].count, game.enemies.kinds[1].count, game.enemies.kinds[2].count, game.rng.state);
+}
+
+int main(int argc, char **argv)
+{
+    const char *recPath = nullptr, *paths[2] = { nullptr, nullptr };
+    int npaths = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--replay") && i + 1 < argc) recPath = argv[++i];
+        else if (argv[i][0] != '-' && npaths < 2) paths[npaths++] = argv[i];
+        else { fprintf(stderr, "desync: unknown argument %s (see the header of tools/desync.cpp)\n", argv[i]); return 2; }
+    }
+    if (npaths != (recPath ? 1 : 2)) { fprintf(stderr, "desync: need two .hashes files, or --replay run.rec and one\n"); return 2; }
+
+    TickHashStream a, b;
+    Replay replay;
+    Game game;
+    const char *nameA = paths[0], *nameB = paths[npaths - 1];
+    if (recPath) {
+        if (!LoadReplay(recPath, replay)) { fprintf(stderr, "desync: cannot read %s\n", recPath); return 2; }
+        ReplayHashes(replay, game, a, -1);
+        nameA = "this build";
+    } else if (!LoadTickHashes(paths[0], a)) {
+        fprintf(stderr, "desync: %s is not a tick hash stream\n", paths[0]);
+        return 2;
+    }
+    if (!LoadTickHashes(nameB, b)) { fprintf(stderr, "desync: %s is not a tick hash stream\n", nameB); return 2; }
+
+    printf("desync: %s %d ticks, %s %d ticks\n", nameA, a.ticks(), nameB, b.ticks());
+    unsigned mask;
+    int tick = FirstDivergentTick(a, b, mask);
+    if (tick < 0) {
+        int common = (a.ticks() < b.ticks()) ? a.ticks() : b.ticks();
+        printf("  no divergence over %d ticks%s\n", common, (a.ticks() != b.ticks()) ? " (one stream is longer)" : "");
+        return 0;
+    }
+
+    printf("  first divergence at tick %d:", tick);
+    for (int f = 0; f < TICK_HASH_FIELDS; ++f)
+        if (mask & (1u << f)) printf(" %s", TICK_HASH_NAMES[f]);
+    printf("\n  first divergence per field:");
+    int common = (a.ticks() < b.ticks()) ? a.ticks() : b.ticks();
+    int fieldTick[TICK_HASH_FIELDS];
+    for (int f = 0; f < TICK_HASH_FIELDS; ++f) {
+        int t = tick;
+        while (t < common && a.at(t, f) == b.at(t, f)) ++t;
+        fieldTick[f] = (t < common) ? t : -1;
+        if (t < common) printf(" %s %d", TICK_HASH_NAMES[f], t);
+        else printf(" %s never", TICK_HASH_NAMES[f]);
+    }
+    printf("\n");
+
+    // Enemy y is only hashed TICK_HASH_WINDOW per kind a tick, so with more enemies than
+    // that the tick above is when the drift was seen, not when it started
+    int enemyTick = fieldTick[TICK_HASH_ENEMIES];
+    if (enemyTick >= 0) {
+        int from = EarliestEnemyDivergence(a, b, enemyTick);
+        if (from < 0) {
+            printf("  enemies: a version 1 stream does not say how many enemies were hashed, so they can have diverged before tick %d\n", enemyTick);
+        } else if (from < enemyTick) {
+            printf("  enemies: y is hashed %d per kind a tick, so they can have diverged anywhere in ticks %d..%d\n",
+                   TICK_HASH_WINDOW, from, enemyTick);
+            if (from < tick) printf("  so the first divergence can be as early as tick %d\n", from);
+        }
+    }
+
+    if (recPath) {
+        double seconds = 0.0;
+        for (int i = 0; i < tick; ++i) seconds += replay.ticks[(size_t)i].dt;
+        printf("  %.2f s into the recording\n", seconds);
+        Game at;
+        TickHashStream scratch;
+        ReplayHashes(replay, at, scratch, tick);
+        PrintState(at, replay.ticks[(size_t)tick]);
+    }
+    return 1;
+}
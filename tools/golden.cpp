@@ -0,0 +1,354 @@
+/*******************************************************************************************
+* golden.cpp - golden-image render regression for "Dodge!" (no GPU, no window)
+*
+*   - Plays a recording (.rec, see replay.h) through StepGame() and, at fixed ticks, renders
+*     the frame with the CPU rasterizer (raster.h, the same scene main.cpp draws)
+*   - Each frame is compared with its reference image (grayscale PNG) with a perceptual
+*     tolerance: edges off by one pixel and luminance within --tolerance-luma levels pass,
+*     a missing, moved or recoloured shape fails
+*   - Each frame is also timed (best of --repeat renders) against the baseline's render_ns,
+*     so a slower draw path fails like a wrong picture does
+*   - A failing frame is written to the working directory as <name>.actual.png and
+*     <name>.diff.png (absolute difference, x4) for inspection
+*   - --write-baseline renders the frames (default: PLAYING in every weather, a GAME_OVER
+*     screen and an 84x84 agent frame of tools/baselines/smoke.rec) and writes the PNGs and
+*     the JSON that lists them; PNG paths in the JSON are relative to the JSON file
+*
+* USAGE
+*   dodge_golden <run.rec> --baseline golden.json [--tolerance-luma 3] [--max-pixels 0]
+*                                        [--tolerance 0.25] [--repeat 200]
+*   dodge_golden <run.rec> --write-baseline golden.json [--frame TICK:WxH ...]
+*
+* Exit code: 0 pass, 1 image or timing regression, 2 usage or I/O error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../replay.h"
+#include "../raster.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const int GOLDEN_MAX_FRAMES = 64;
+static const double GOLDEN_MIN_SLACK_NS = 1000.0;   // sub-microsecond renders are within timer noise
+
+struct GoldenFrame {
+    int tick;                               // rendered after this many ticks of the recording
+    int width, height;
+    std::string image;                      // reference PNG, relative to the baseline JSON
+    double renderNs;                        // baseline render time (best of N)
+};
+
+struct FrameResult {
+    std::vector<unsigned char> pixels;
+    double renderNs;
+    const char *state;
+};
+
+// Frames written by --write-baseline when no --frame is given (smoke.rec: 10 enemies, the
+// weather cycling every 1200 ticks)
+static const GoldenFrame GOLDEN_DEFAULT_FRAMES[] = {
+    { 200, SCREEN_W, SCREEN_H, "", 0.0 },   // PLAYING, sunny
+    { 240, SCREEN_W, SCREEN_H, "", 0.0 },   // GAME_OVER dim
+    { 1500, SCREEN_W, SCREEN_H, "", 0.0 },  // PLAYING, cloudy
+    { 3000, SCREEN_W, SCREEN_H, "", 0.0 },  // PLAYING, rainy
+    { 3000, 84, 84, "", 0.0 },              // the same frame as a pixel agent sees it
+};
+
+static double NowNs()
+{
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------
+// Render every frame of the list, in tick order, from one pass over the recording
+// -----------------------------------------------------------------------------------------
+static bool RenderFrames(const Replay &replay, const std::vector<GoldenFrame> &frames, int repeat, std::vector<FrameResult> &out)
+{
+    std::vector<int> order(frames.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return frames[a].tick < frames[b].tick; });
+
+    Game game;
+    InitGameFromReplay(game, replay);
+    out.assign(frames.size(), FrameResult{});
+
+    int tick = 0;
+    for (int f : order) {
+        const GoldenFrame &frame = frames[f];
+        if (frame.tick > (int)replay.ticks.size()) {
+            fprintf(stderr, "golden: tick %d is past the end of the recording (%zu ticks)\n", frame.tick, replay.ticks.size());
+            return false;
+        }
+        for (; tick < frame.tick; ++tick) StepGame(game, replay.ticks[tick]);
+
+        FrameResult &r = out[f];
+        r.pixels.resize((size_t)frame.width*frame.height);
+        r.state = STATE_NAMES[(int)game.state];
+        RasterTarget target = MakeRasterTarget(r.pixels.data(), frame.width, frame.height);
+        r.renderNs = 0.0;
+        for (int i = 0; i < repeat; ++i) {
+            double t0 = NowNs();
+            RasterGame(game, target);
+            double ns = NowNs() - t0;
+            if (i == 0 || ns < r.renderNs) r.renderNs = ns;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Perceptual comparison. The renders are aliased (hard edges), so a shape edge rounded to the
+// neighbouring pixel is not a regression, and neither is a brightness drift of a few levels:
+// a pixel matches when some pixel of the other image's 3x3 neighbourhood is within the
+// tolerance, checked both ways. A missing, moved (>1 px) or recoloured shape leaves
+// unmatched pixels; so does a thin shape that is missing entirely (checked from the
+// reference side).
+// -----------------------------------------------------------------------------------------
+struct ImageDiff {
+    long mismatched;                        // pixels without a match, either way
+    long changed;                           // pixels that differ at all
+    int maxDelta;                           // largest per-pixel difference
+    int x0, y0, x1, y1;                     // bounding box of the mismatched pixels
+};
+
+static bool NeighbourWithin(const unsigned char *img, int width, int height, int x, int y, int v, int tolerance)
+{
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ++ny) {
+        for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx) {
+            if (abs(img[(size_t)ny*width + nx] - v) <= tolerance) return true;
+        }
+    }
+    return false;
+}
+
+static ImageDiff CompareImages(const unsigned char *expected, const unsigned char *actual, int width, int height, int tolerance)
+{
+    ImageDiff d = { 0, 0, 0, width, height, -1, -1 };
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            size_t i = (size_t)y*width + x;
+            int delta = abs(expected[i] - actual[i]);
+            if (delta == 0) continue;
+            d.changed++;
+            d.maxDelta = std::max(d.maxDelta, delta);
+            if (delta <= tolerance) continue;
+            if (NeighbourWithin(expected, width, height, x, y, actual[i], tolerance) &&
+                NeighbourWithin(actual, width, height, x, y, expected[i], tolerance)) continue;
+
+            d.mismatched++;
+            d.x0 = std::min(d.x0, x); d.y0 = std::min(d.y0, y);
+            d.x1 = std::max(d.x1, x); d.y1 = std::max(d.y1, y);
+        }
+    }
+    return d;
+}
+
+// -----------------------------------------------------------------------------------------
+// Images (grayscale PNG through raylib)
+// -----------------------------------------------------------------------------------------
+static bool WriteGray(const char *path, const unsigned char *pixels, int width, int height)
+{
+    Image image = { (void *)pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+    return ExportImage(image, path);
+}
+
+static bool ReadGray(const char *path, int width, int height, std::vector<unsigned char> &pixels)
+{
+    Image image = LoadImage(path);
+    if (!image.data) return false;
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    bool ok = (image.width == width && image.height == height);
+    if (ok) pixels.assign((unsigned char *)image.data, (unsigned char *)image.data + (size_t)width*height);
+    UnloadImage(image);
+    return ok;
+}
+
+static std::string FrameName(const char *replayPath, const GoldenFrame &frame)
+{
+    std::string base = replayPath;
+    size_t slash = base.find_last_of("/\\");
+    if (slash != std::string::npos) base = base.substr(slash + 1);
+    size_t dot = base.rfind('.');
+    if (dot != std::string::npos) base = base.substr(0, dot);
+    char name[256];
+    snprintf(name, sizeof(name), "%s_%d_%dx%d", base.c_str(), frame.tick, frame.width, frame.height);
+    return name;
+}
+
+static std::string DirectoryOf(const char *path)
+{
+    std::string dir = path;
+    size_t slash = dir.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string() : dir.substr(0, slash + 1);
+}
+
+// -----------------------------------------------------------------------------------------
+// Baseline JSON: one frame object per line, read back with a minimal key lookup
+// -----------------------------------------------------------------------------------------
+static bool JsonNumber(const char *json, const char *key, double &out)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    if (!p) return false;
+    p += strlen(pattern);
+    while (*p == ' ' || *p == '"') p++;
+    out = strtod(p, nullptr);
+    return true;
+}
+
+static bool JsonString(const char *json, const char *key, std::string &out)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    if (!p || !(p = strchr(p + strlen(pattern), '"'))) return false;
+    const char *end = strchr(p + 1, '"');
+    if (!end) return false;
+    out.assign(p + 1, end);
+    return true;
+}
+
+static bool LoadBaseline(const char *path, std::vector<GoldenFrame> &frames)
+{
+    char *json = LoadFileText(path);
+    if (!json) return false;
+
+    bool ok = true;
+    for (char *line = strtok(json, "\n"); line && ok; line = strtok(nullptr, "\n")) {
+        if (!strstr(line, "\"tick\":")) continue;
+        GoldenFrame f;
+        double tick = 0, width = 0, height = 0;
+        ok = JsonNumber(line, "tick", tick) && JsonNumber(line, "width", width) && JsonNumber(line, "height", height) &&
+             JsonString(line, "image", f.image) && JsonNumber(line, "render_ns", f.renderNs);
+        f.tick = (int)tick;
+        f.width = (int)width;
+        f.height = (int)height;
+        ok = ok && f.width > 0 && f.height > 0;
+        frames.push_back(f);
+    }
+    UnloadFileText(json);
+    return ok && !frames.empty();
+}
+
+static int WriteBaseline(const char *path, const char *replayPath, std::vector<GoldenFrame> &frames, const std::vector<FrameResult> &results)
+{
+    std::string dir = DirectoryOf(path);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].image = "golden/" + FrameName(replayPath, frames[i]) + ".png";
+        frames[i].renderNs = results[i].renderNs;
+        if (!WriteGray((dir + frames[i].image).c_str(), results[i].pixels.data(), frames[i].width, frames[i].height)) {
+            fprintf(stderr, "golden: could not write %s%s (does the directory exist?)\n", dir.c_str(), frames[i].image.c_str());
+            return 2;
+        }
+    }
+
+    FILE *f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "golden: could not write %s\n", path); return 2; }
+    fprintf(f, "{\n  \"recording\": \"%s\",\n  \"frames\": [\n", replayPath);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const GoldenFrame &g = frames[i];
+        fprintf(f, "    { \"tick\": %d, \"width\": %d, \"height\": %d, \"image\": \"%s\", \"render_ns\": %.1f }%s\n",
+                g.tick, g.width, g.height, g.image.c_str(), g.renderNs, (i + 1 < frames.size()) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    printf("wrote baseline %s and %zu images\n", path, frames.size());
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *replayPath = nullptr, *baselinePath = nullptr, *writePath = nullptr;
+    double tolerance = 0.25;
+    int lumaTolerance = 3, maxPixels = 0, repeat = 200;
+    std::vector<GoldenFrame> frames;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--baseline") && i + 1 < argc) baselinePath = argv[++i];
+        else if (!strcmp(argv[i], "--write-baseline") && i + 1 < argc) writePath = argv[++i];
+        else if (!strcmp(argv[i], "--tolerance-luma") && i + 1 < argc) lumaTolerance = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-pixels") && i + 1 < argc) maxPixels = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--frame") && i + 1 < argc) {
+            GoldenFrame f = { 0, 0, 0, "", 0.0 };
+            if (sscanf(argv[++i], "%d:%dx%d", &f.tick, &f.width, &f.height) != 3 || f.tick < 0 || f.width < 1 || f.height < 1) {
+                fprintf(stderr, "golden: --frame wants TICK:WxH, e.g. 600:800x450\n");
+                return 2;
+            }
+            frames.push_back(f);
+        }
+        else if (argv[i][0] != '-' && !replayPath) replayPath = argv[i];
+        else { fprintf(stderr, "golden: unknown argument %s (see the header of tools/golden.cpp)\n", argv[i]); return 2; }
+    }
+    if (!replayPath || (!baselinePath == !writePath)) {
+        fprintf(stderr, "usage: %s <run.rec> (--baseline file | --write-baseline file [--frame TICK:WxH ...])\n", argv[0]);
+        return 2;
+    }
+
+    Replay replay;
+    if (!LoadReplay(replayPath, replay)) { fprintf(stderr, "golden: %s is not a valid recording\n", replayPath); return 2; }
+
+    if (baselinePath) {
+        frames.clear();
+        if (!LoadBaseline(baselinePath, frames)) { fprintf(stderr, "golden: could not read frames from %s\n", baselinePath); return 2; }
+    } else if (frames.empty()) {
+        frames.assign(std::begin(GOLDEN_DEFAULT_FRAMES), std::end(GOLDEN_DEFAULT_FRAMES));
+    }
+    if ((int)frames.size() > GOLDEN_MAX_FRAMES) { fprintf(stderr, "golden: at most %d frames\n", GOLDEN_MAX_FRAMES); return 2; }
+
+    std::vector<FrameResult> results;
+    if (!RenderFrames(replay, frames, repeat, results)) return 2;
+
+    if (writePath) return WriteBaseline(writePath, replayPath, frames, results);
+
+    std::string dir = DirectoryOf(baselinePath);
+    int failures = 0;
+    double totalNs = 0.0, baseTotalNs = 0.0;
+    printf("%-26s %-10s %9s %9s %9s %12s %12s\n", "frame", "state", "changed", "max diff", "mismatch", "render", "baseline");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const GoldenFrame &g = frames[i];
+        const FrameResult &r = results[i];
+        std::string name = FrameName(replayPath, g);
+        totalNs += r.renderNs;
+        baseTotalNs += g.renderNs;
+
+        std::vector<unsigned char> expected;
+        if (!ReadGray((dir + g.image).c_str(), g.width, g.height, expected)) {
+            printf("FAIL: %s: could not read a %dx%d reference from %s%s\n", name.c_str(), g.width, g.height, dir.c_str(), g.image.c_str());
+            failures++;
+            continue;
+        }
+
+        ImageDiff d = CompareImages(expected.data(), r.pixels.data(), g.width, g.height, lumaTolerance);
+        double limit = std::max(g.renderNs*(1.0 + tolerance), g.renderNs + GOLDEN_MIN_SLACK_NS);
+        printf("%-26s %-10s %9ld %9d %9ld %9.1f us %9.1f us\n", name.c_str(), r.state, d.changed, d.maxDelta,
+               d.mismatched, r.renderNs/1e3, g.renderNs/1e3);
+
+        if (d.mismatched > maxPixels) {
+            printf("FAIL: %s: %ld pixels differ beyond the tolerance in (%d, %d)-(%d, %d); wrote %s.actual.png and %s.diff.png\n",
+                   name.c_str(), d.mismatched, d.x0, d.y0, d.x1, d.y1, name.c_str(), name.c_str());
+            std::vector<unsigned char> diff(r.pixels.size());
+            for (size_t p = 0; p < diff.size(); ++p) diff[p] = (unsigned char)std::min(255, 4*abs(r.pixels[p] - expected[p]));
+            WriteGray((name + ".actual.png").c_str(), r.pixels.data(), g.width, g.height);
+            WriteGray((name + ".diff.png").c_str(), diff.data(), g.width, g.height);
+            failures++;
+        }
+        if (r.renderNs > limit) {
+            printf("FAIL: %s: render %.1f us > baseline %.1f us +%.0f%% (draw path slower)\n", name.c_str(), r.renderNs/1e3,
+                   g.renderNs/1e3, tolerance*100.0);
+            failures++;
+        }
+    }
+    printf("render      %.1f us for %zu frames vs baseline %.1f us (best of %d each)\n", totalNs/1e3, frames.size(), baseTotalNs/1e3, repeat);
+
+    if (failures == 0) printf("PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,415 @@
+/*******************************************************************************************
+* regress.cpp - headless end-to-end regression runner for "Dodge!"
+*
+*   - Loads a recording (.rec, see replay.h) and plays it through StepGame(), the same
+*     update code main() runs, without opening a window
+*   - Prints the final state, its checksum (player rect, enemies, score, RNG) and timing
+*   - --baseline compares against a committed baseline: the checksum must match exactly
+*     (gameplay change) and ns/tick must stay within the tolerance (hot loop got slower)
+*   - --generate writes a scripted recording (a wandering bot that restarts after each
+*     death), which is how tools/baselines/smoke.rec was produced; with --fixed the run uses
+*     the fixed-point tick (fixed.h), like tools/baselines/smoke_fixed.rec
+*   - --hashes writes the run's per-tick state hashes (tickhash.h): two builds (say native
+*     and wasm) that disagree differ first at the tick where they diverged (tools/desync.cpp)
+*   - Checks save states (snapshot.h): the second half replayed from a mid-run snapshot,
+*     restored into a fresh Game, must land on the same checksum
+*   - Checks packed replays (replaypack.h): seeking the packed recording to times spread over
+*     the run must give the same state as playing straight there; --write-pack saves the pack
+*   - Checks long ticks: a rain drop just above the player at the bottom of the screen must
+*     hit it at every dt up to 0.5 s, even when it falls off the screen in that same tick
+*   - Built with -DDODGE_ALLOC_STATS it also fails if any PLAYING tick allocates
+*
+* USAGE
+*   dodge_regress <run.rec> [--baseline run.json] [--tolerance 0.25] [--repeat 5]
+*   dodge_regress <run.rec> --write-baseline run.json
+*   dodge_regress <run.rec> --write-pack run.dpk      (for main --view)
+*   dodge_regress <run.rec> --hashes run.hashes
+*   dodge_regress --generate run.rec [--ticks 18000] [--seed 42] [--enemies 10] [--fixed]
+*
+* Exit code: 0 pass, 1 mismatch/regression, 2 usage or I/O error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../replay.h"
+#include "../snapshot.h"
+#include "../replaypack.h"
+#include "../tickhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct RunResult {
+    unsigned long long checksum;
+    int runs;                   // games started (MENU/GAME_OVER -> PLAYING)
+    double totalMs;
+    double nsPerTick;
+    double p50Ns, p99Ns, maxNs; // single-tick times
+};
+
+static double NowNs()
+{
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------
+// Play the whole recording once, timing every tick
+// -----------------------------------------------------------------------------------------
+static RunResult PlayReplay(const Replay &replay, Game &game, std::vector<double> &tickNs, bool countAllocs)
+{
+    (void)countAllocs;
+    RunResult r = {};
+    InitGameFromReplay(game, replay);
+
+    size_t n = replay.ticks.size();
+    double start = NowNs();
+    for (size_t i = 0; i < n; ++i) {
+        GameState before = game.state;
+        double t0 = NowNs();
+        StepGame(game, replay.ticks[i]);
+        tickNs[i] = NowNs() - t0;
+
+        if (before != GameState::PLAYING && game.state == GameState::PLAYING) r.runs++;
+#ifdef DODGE_ALLOC_STATS
+        if (countAllocs) AllocStatsEndFrame(before == GameState::PLAYING);
+#endif
+    }
+    r.totalMs = (NowNs() - start)/1e6;
+    r.checksum = GameChecksum(game);
+
+    if (n > 0) {
+        double sum = 0.0;
+        for (double t : tickNs) sum += t;
+        r.nsPerTick = sum/n;
+        std::vector<double> sorted(tickNs);
+        std::sort(sorted.begin(), sorted.end());
+        r.p50Ns = sorted[n/2];
+        r.p99Ns = sorted[std::min(n - 1, (size_t)(n*0.99))];
+        r.maxNs = sorted[n - 1];
+    }
+    return r;
+}
+
+// -----------------------------------------------------------------------------------------
+// Save-state round trip: snapshot halfway, finish the run, then replay the second half from
+// the snapshot in a fresh Game. Returns the checksum of that resumed run.
+// -----------------------------------------------------------------------------------------
+static unsigned long long ResumeFromSnapshot(const Replay &replay, size_t &snapshotBytes)
+{
+    Game game;
+    InitGameFromReplay(game, replay);
+    size_t n = replay.ticks.size(), half = n/2;
+    for (size_t i = 0; i < half; ++i) StepGame(game, replay.ticks[i]);
+
+    GameSnapshot snap;
+    SaveGameSnapshot(game, snap);
+    snapshotBytes = snap.size;
+    for (size_t i = half; i < n; ++i) StepGame(game, replay.ticks[i]);   // scribble over the saved state
+
+    Game resumed;
+    if (!LoadGameSnapshot(resumed, snap)) return 0;
+    for (size_t i = half; i < n; ++i) StepGame(resumed, replay.ticks[i]);
+    return GameChecksum(resumed);
+}
+
+// -----------------------------------------------------------------------------------------
+// Packed replay: build the pack, then seek to PACK_CHECK_SEEKS times spread over the run (in
+// a scrambled order, like a viewer scrubbing) and compare each with the straight run's state
+// at that tick. Returns the number of mismatches; -1 if the pack could not be built.
+// -----------------------------------------------------------------------------------------
+static const int PACK_CHECK_SEEKS = 64;
+
+static int CheckReplayPack(const Replay &replay, ReplayPack &pack, double &seekUs)
+{
+    if (!BuildReplayPack(replay, pack)) return -1;
+
+    Game game;
+    InitGameFromReplay(game, replay);
+    std::vector<unsigned long long> straight(replay.ticks.size() + 1);
+    straight[0] = GameChecksum(game);
+    for (size_t i = 0; i < replay.ticks.size(); ++i) {
+        StepGame(game, replay.ticks[i]);
+        straight[i + 1] = GameChecksum(game);
+    }
+
+    PackCursor cursor;
+    int mismatches = 0;
+    double totalNs = 0.0;
+    for (int i = 0; i < PACK_CHECK_SEEKS; ++i) {
+        double time = pack.header.duration*((i*37) % PACK_CHECK_SEEKS)/(PACK_CHECK_SEEKS - 1);
+        double t0 = NowNs();
+        bool ok = PackSeek(pack, cursor, game, time);
+        totalNs += NowNs() - t0;
+        if (!ok || GameChecksum(game) != straight[(size_t)cursor.tick]) {
+            printf("FAIL: packed replay seek to %.3f s (tick %d) differs from the straight run\n", time, cursor.tick);
+            mismatches++;
+        }
+    }
+    seekUs = totalNs/PACK_CHECK_SEEKS/1e3;
+    return mismatches;
+}
+
+// -----------------------------------------------------------------------------------------
+// Long ticks (a tab switch, a GC pause): one rain drop falling onto the player parked at the
+// bottom, at dt from a normal frame to one that carries the drop through the player and off
+// the screen. Every case must end the run. Returns the number of misses.
+// -----------------------------------------------------------------------------------------
+static const float LONG_TICK_DTS[] = { 1.0f/60.0f, 0.05f, 0.1f, 0.25f, 0.5f };
+
+static int CheckLongTicks(int &cases)
+{
+    int misses = 0;
+    cases = 0;
+    for (int fixedPoint = 0; fixedPoint < 2; ++fixedPoint) {
+        for (float dt : LONG_TICK_DTS) {
+            Game game;
+            game.fixedPoint = fixedPoint != 0;
+            game.difficultyRamp = false;
+            InitGame(game, 7, 1, WeatherKind::RAINY);
+            StepGame(game, { KEYS_START, -1, 0.0f });
+
+            game.player.rect = game.player.prevRect = { 400.0f, SCREEN_H - 36.0f, 36.0f, 36.0f };
+            EnemyBucket &b = game.enemies.kinds[RainKind::KIND];
+            b.x[0] = 415.0f;
+            b.y[0] = SCREEN_H - 36.0f - 21.0f;     // 1 px above the player
+            b.w[0] = 5.0f;
+            b.h[0] = 20.0f;
+            b.speedY[0] = b.maxSpeedY = 360.0f;
+
+            StepGame(game, { 0, -1, dt });
+            cases++;
+            if (game.state != GameState::GAME_OVER) {
+                printf("FAIL: %s tick of %.3f s carried a rain drop through the player\n",
+                       fixedPoint ? "fixed-point" : "float", dt);
+                misses++;
+            }
+        }
+    }
+    return misses;
+}
+
+// -----------------------------------------------------------------------------------------
+// Scripted recording: hold a random direction for a while, restart shortly after dying
+// -----------------------------------------------------------------------------------------
+static int GenerateReplay(const char *path, int ticks, unsigned long long seed, int enemyCount, bool fixedPoint)
+{
+    Game game;
+    game.fixedPoint = fixedPoint;
+    InitGame(game, seed, enemyCount, WeatherKind::SUNNY);
+
+    ReplayRecorder rec;
+    if (!ReplayRecordBegin(rec, path, game, seed)) { fprintf(stderr, "regress: could not write %s\n", path); return 2; }
+
+    GameRng script;
+    SeedRandom(script, seed ^ 0xA5A5A5A5ull);
+    unsigned char held = 0;
+    int holdTicks = 0, waitTicks = 0;
+
+    for (int i = 0; i < ticks; ++i) {
+        GameInput in{};
+        in.weather = -1;
+        // Mostly 60 FPS with the occasional hitch, like a real session
+        in.dt = (RandomValue(script, 0, 99) < 3) ? 1.0f/20.0f : 1.0f/60.0f;
+
+        // Cycle the weather every 20 s of recording so every enemy kind is exercised
+        if (i > 0 && i % 1200 == 0) in.weather = (signed char)((i/1200) % 3);
+
+        if (game.state == GameState::PLAYING) {
+            if (--holdTicks <= 0) {
+                held = (unsigned char)RandomValue(script, 0, 15);   // any LEFT/RIGHT/UP/DOWN combination
+                holdTicks = RandomValue(script, 6, 40);
+            }
+            in.keys = held;
+            waitTicks = 0;
+        } else if (++waitTicks > 30) {
+            in.keys = (game.state == GameState::MENU) ? KEYS_START : KEYS_RESTART;
+            waitTicks = 0;
+        }
+
+        ReplayRecordTick(rec, in);
+        StepGame(game, in);
+    }
+
+    ReplayRecordEnd(rec);
+    printf("wrote %s: %d ticks, seed %llu, %d enemies%s\n", path, ticks, seed, enemyCount, fixedPoint ? ", fixed-point" : "");
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------
+// Per-tick state hashes (tickhash.h), for tools/desync.cpp
+// -----------------------------------------------------------------------------------------
+static bool WriteTickHashes(const char *path, const Replay &replay)
+{
+    TickHashRecorder rec;
+    if (!TickHashRecordBegin(rec, path)) return false;
+    Game game;
+    game.hashTicks = true;
+    InitGameFromReplay(game, replay);
+    for (const GameInput &in : replay.ticks) {
+        StepGame(game, in);
+        TickHashRecordTick(rec, game.tickHash);
+    }
+    TickHashRecordEnd(rec);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Baseline files: a flat JSON object, read back with a minimal key lookup
+// -----------------------------------------------------------------------------------------
+static bool JsonNumber(const char *json, const char *key, double &out)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    if (!p) return false;
+    p += strlen(pattern);
+    while (*p == ' ' || *p == '"') p++;
+    out = strtod(p, nullptr);
+    return true;
+}
+
+static bool JsonChecksum(const char *json, unsigned long long &out)
+{
+    const char *p = strstr(json, "\"checksum\":");
+    if (!p || !(p = strchr(p + 11, '"'))) return false;
+    out = strtoull(p + 1, nullptr, 16);
+    return true;
+}
+
+static void WriteBaseline(const char *path, const Replay &replay, const Game &game, const RunResult &r)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "regress: could not write %s\n", path); return; }
+    fprintf(f, "{\n  \"ticks\": %zu,\n  \"checksum\": \"%016llx\",\n  \"score\": %d,\n  \"best\": %d,\n"
+               "  \"runs\": %d,\n  \"ns_per_tick\": %.1f\n}\n",
+            replay.ticks.size(), r.checksum, (int)game.score, game.bestScore, r.runs, r.nsPerTick);
+    fclose(f);
+    printf("wrote baseline %s\n", path);
+}
+
+int main(int argc, char **argv)
+{
+    const char *replayPath = nullptr, *baselinePath = nullptr, *writePath = nullptr, *generatePath = nullptr;
+    const char *packPath = nullptr, *hashesPath = nullptr;
+    bool fixedPoint = false;
+    double tolerance = 0.25;
+    int repeat = 5, ticks = 18000, enemyCount = 10;
+    unsigned long long seed = 42;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--baseline") && i + 1 < argc) baselinePath = argv[++i];
+        else if (!strcmp(argv[i], "--write-baseline") && i + 1 < argc) writePath = argv[++i];
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--write-pack") && i + 1 < argc) packPath = argv[++i];
+        else if (!strcmp(argv[i], "--hashes") && i + 1 < argc) hashesPath = argv[++i];
+        else if (!strcmp(argv[i], "--fixed")) fixedPoint = true;
+        else if (!strcmp(argv[i], "--generate") && i + 1 < argc) generatePath = argv[++i];
+        else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc) enemyCount = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !replayPath) replayPath = argv[i];
+        else { fprintf(stderr, "regress: unknown argument %s (see the header of tools/regress.cpp)\n", argv[i]); return 2; }
+    }
+
+    if (generatePath) return GenerateReplay(generatePath, ticks, seed, enemyCount, fixedPoint);
+    if (!replayPath) { fprintf(stderr, "usage: %s <run.rec> [--baseline file] [--write-baseline file]\n", argv[0]); return 2; }
+
+    Replay replay;
+    if (!LoadReplay(replayPath, replay)) { fprintf(stderr, "regress: %s is not a valid recording\n", replayPath); return 2; }
+
+    // Best of N runs for timing; every run must land on the same checksum
+    Game game;
+    std::vector<double> tickNs(replay.ticks.size());
+    RunResult best = {};
+    int failures = 0;
+    for (int i = 0; i < repeat; ++i) {
+        RunResult r = PlayReplay(replay, game, tickNs, i == 0);
+        if (i > 0 && r.checksum != best.checksum) {
+            printf("FAIL: non-deterministic, run %d checksum %016llx != %016llx\n", i, r.checksum, best.checksum);
+            failures++;
+        }
+        if (i == 0 || r.nsPerTick < best.nsPerTick) best = r;
+    }
+
+    size_t snapshotBytes = 0;
+    unsigned long long resumed = ResumeFromSnapshot(replay, snapshotBytes);
+    if (resumed != best.checksum) {
+        printf("FAIL: resumed from the mid-run snapshot, checksum %016llx != %016llx\n", resumed, best.checksum);
+        failures++;
+    }
+
+    int longTickCases = 0;
+    int longTickMisses = CheckLongTicks(longTickCases);
+    if (longTickMisses != 0) failures++;
+
+    ReplayPack pack;
+    double seekUs = 0.0;
+    int packMismatches = CheckReplayPack(replay, pack, seekUs);
+    if (packMismatches != 0) failures++;
+
+    const Rectangle &p = game.player.rect;
+    printf("replay      %s (%zu ticks, seed %llu, %d enemies, %s)\n", replayPath, replay.ticks.size(),
+           replay.header.seed, replay.header.enemyCount,
+           (replay.header.flags & REPLAY_FIXED_POINT) ? "fixed-point" : "float");
+    printf("final       state %s, score %d, best %d, runs %d\n", STATE_NAMES[(int)game.state],
+           (int)game.score, game.bestScore, best.runs);
+    printf("player      x %.3f y %.3f w %.0f h %.0f\n", p.x, p.y, p.width, p.height);
+    printf("checksum    %016llx\n", best.checksum);
+    PrintEnemyPoolStats(game.enemies);
+    printf("snapshot    %zu bytes at tick %zu, resumed run %s\n", snapshotBytes, replay.ticks.size()/2,
+           resumed == best.checksum ? "matches" : "DIFFERS");
+    printf("pack        %zu bytes (.rec %zu), %d blocks of %.0f s, %d seeks %s, %.1f us/seek\n", pack.file.size(),
+           sizeof(ReplayHeader) + replay.ticks.size()*REPLAY_TICK_SIZE, pack.header.blockCount, pack.header.keyframeSeconds,
+           PACK_CHECK_SEEKS, packMismatches == 0 ? "match" : "DIFFER", seekUs);
+    printf("long ticks  %d/%d hit the player (dt up to %.2f s)\n", longTickCases - longTickMisses, longTickCases,
+           LONG_TICK_DTS[sizeof(LONG_TICK_DTS)/sizeof(LONG_TICK_DTS[0]) - 1]);
+    printf("timing      %.3f ms total, %.1f ns/tick, p50 %.0f ns, p99 %.0f ns, max %.0f ns (best of %d)\n",
+           best.totalMs, best.nsPerTick, best.p50Ns, best.p99Ns, best.maxNs, repeat);
+
+#ifdef DODGE_ALLOC_STATS
+    if (AllocStatsReport(PROF_NAMES, PROF_PHASE_COUNT) > 0) failures++;
+#endif
+
+    if (writePath) WriteBaseline(writePath, replay, game, best);
+    if (hashesPath) {
+        if (!WriteTickHashes(hashesPath, replay)) { fprintf(stderr, "regress: could not write %s\n", hashesPath); return 2; }
+        printf("wrote tick hashes %s\n", hashesPath);
+    }
+    if (packPath) {
+        if (!SaveReplayPack(packPath, pack)) { fprintf(stderr, "regress: could not write %s\n", packPath); return 2; }
+        printf("wrote pack %s\n", packPath);
+    }
+
+    if (baselinePath) {
+        char *json = LoadFileText(baselinePath);
+        if (!json) { fprintf(stderr, "regress: could not read %s\n", baselinePath); return 2; }
+
+        unsigned long long expected = 0;
+        double baseNs = 0.0;
+        if (!JsonChecksum(json, expected) || !JsonNumber(json, "ns_per_tick", baseNs)) {
+            fprintf(stderr, "regress: %s is missing checksum/ns_per_tick\n", baselinePath);
+            UnloadFileText(json);
+            return 2;
+        }
+        UnloadFileText(json);
+
+        if (best.checksum != expected) {
+            printf("FAIL: checksum %016llx != baseline %016llx (gameplay changed)\n", best.checksum, expected);
+            failures++;
+        }
+        double limit = baseNs*(1.0 + tolerance);
+        if (best.nsPerTick > limit) {
+            printf("FAIL: %.1f ns/tick > baseline %.1f ns/tick +%.0f%% (hot loop slower)\n", best.nsPerTick, baseNs, tolerance*100.0);
+            failures++;
+        } else {
+            printf("timing OK   %.1f ns/tick vs baseline %.1f (limit %.1f)\n", best.nsPerTick, baseNs, limit);
+        }
+        if (failures == 0) printf("PASS\n");
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/*******************************************************************************************
+* relay.cpp - spectator relay: one game in, hundreds of spectators out (spectate.h)
+*
+*   The game (`dodge --broadcast`) or tools/spectate.cpp connects to --source-port and
+*   streams its frames; spectators connect to --port. Every frame is read once and the same
+*   buffer is queued to every spectator (shared, never copied or re-encoded). One thread,
+*   one poll() loop, non-blocking sockets.
+*
+*   - A new spectator gets the hello, then the latest keyframe and every frame since, so it
+*     is in sync at once and a few frames behind at most
+*   - A spectator that cannot keep up (more than --backlog-kb queued) loses its queue, apart
+*     from the frame it is in the middle of, and picks up again at the next keyframe. Deltas
+*     are always against the previous frame, so skipping to a keyframe is the only safe cut.
+*   - One source at a time; a second one is turned away until the first disconnects
+*   - Prints spectators, frames/s, MB/s out and resyncs every --report seconds
+*
+* USAGE
+*   dodge_relay [--source-port 7470] [--port 7471] [--backlog-kb 256] [--max-spectators 4096] [--report 5]
+*
+* Exit code: 2 usage or socket error (otherwise runs until killed)
+*******************************************************************************************/
+
+#include "../spectate.h"
+#include "../net.h"
+#include <poll.h>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+struct RelayOptions {
+    int sourcePort = 7470;
+    int port = 7471;
+    size_t backlog = 256*1024;
+    int maxSpectators = 4096;
+    double report = 5.0;
+};
+
+// Kernel send buffer per spectator: small, so a slow spectator's backlog builds up here
+// (where it can be cut back to a keyframe) instead of in the kernel
+static const int RELAY_SNDBUF = 64*1024;
+
+using Frame = std::shared_ptr<const std::vector<unsigned char>>;
+
+struct Spectator {
+    int fd = -1;
+    std::deque<Frame> queue;
+    size_t offset = 0;                // bytes of queue.front() already written
+    size_t queued = 0;                // bytes in the queue, not yet written
+    bool waitKeyframe = false;
+};
+
+struct Relay {
+    RelayOptions opt;
+    int sourceListen = -1, spectatorListen = -1, source = -1;
+    SpecReader reader;
+    std::vector<Frame> cache;         // latest keyframe and every frame since
+    std::vector<std::unique_ptr<Spectator>> spectators;
+    Frame hello;
+    unsigned long frames = 0, resyncs = 0;
+    unsigned long long bytesOut = 0;
+};
+
+static void SetNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// Writes as much of the queue as the socket takes; false if the spectator is gone
+static bool FlushSpectator(Relay &relay, Spectator &s)
+{
+    while (!s.queue.empty()) {
+        const std::vector<unsigned char> &f = *s.queue.front();
+        ssize_t n = send(s.fd, f.data() + s.offset, f.size() - s.offset, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) return false;
+        s.offset += (size_t)n;
+        s.queued -= (size_t)n;
+        relay.bytesOut += (unsigned long long)n;
+        if (s.offset == f.size()) { s.queue.pop_front(); s.offset = 0; }
+    }
+    return true;
+}
+
+static void Enqueue(Spectator &s, const Frame &f)
+{
+    s.queue.push_back(f);
+    s.queued += f->size();
+}
+
+// Too far behind: keep only the frame being written, wait for the next keyframe
+static void Resync(Relay &relay, Spectator &s)
+{
+    while (s.queue.size() > (s.offset > 0 ? 1u : 0u)) {
+        s.queued -= s.queue.back()->size();
+        s.queue.pop_back();
+    }
+    if (s.offset > 0) s.queued = s.queue.front()->size() - s.offset;
+    s.waitKeyframe = true;
+    relay.resyncs++;
+}
+
+static void OnFrame(Relay &relay, const unsigned char *data, size_t size)
+{
+    SpecFrameHeader h;
+    memcpy(&h, data, sizeof(h));
+    bool keyframe = h.type == SPEC_KEYFRAME;
+    Frame f = std::make_shared<const std::vector<unsigned char>>(data, data + size);
+    relay.frames++;
+
+    if (keyframe) relay.cache.clear();
+    if (keyframe || !relay.cache.empty()) relay.cache.push_back(f);
+
+    for (std::unique_ptr<Spectator> &sp : relay.spectators) {
+        Spectator &s = *sp;
+        if (s.waitKeyframe && !keyframe) continue;
+        s.waitKeyframe = false;
+        Enqueue(s, f);
+        if (s.queued > relay.opt.backlog) Resync(relay, s);
+    }
+}
+
+static void AcceptSpectators(Relay &relay)
+{
+    for (;;) {
+        int fd = accept(relay.spectatorListen, nullptr, nullptr);
+        if (fd < 0) return;
+        if ((int)relay.spectators.size() >= relay.opt.maxSpectators) { NetClose(fd); continue; }
+        SetNonBlocking(fd);
+        NetNoDelay(fd);
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &RELAY_SNDBUF, sizeof(RELAY_SNDBUF));
+        std::unique_ptr<Spectator> s(new Spectator);
+        s->fd = fd;
+        Enqueue(*s, relay.hello);
+        if (relay.cache.empty()) s->waitKeyframe = true;
+        for (const Frame &f : relay.cache) Enqueue(*s, f);
+        relay.spectators.push_back(std::move(s));
+    }
+}
+
+static void ReadSource(Relay &relay)
+{
+    unsigned char buffer[64*1024];
+    for (;;) {
+        ssize_t n = recv(relay.source, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) {
+            printf("relay: source disconnected\n");
+            NetClose(relay.source);
+            relay.source = -1;
+            return;
+        }
+        SpecReaderFeed(relay.reader, buffer, (size_t)n);
+        const unsigned char *frame;
+        size_t size;
+        int got;
+        while ((got = SpecReaderNext(relay.reader, frame, size)) == 1) OnFrame(relay, frame, size);
+        if (got < 0) {
+            printf("relay: source sent something that is not a spectator stream\n");
+            NetClose(relay.source);
+            relay.source = -1;
+            return;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Relay relay;
+    RelayOptions &opt = relay.opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--source-port") && i + 1 < argc) opt.sourcePort = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opt.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--backlog-kb") && i + 1 < argc) opt.backlog = (size_t)atoi(argv[++i])*1024;
+        else if (!strcmp(argv[i], "--max-spectators") && i + 1 < argc) opt.maxSpectators = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--report") && i + 1 < argc) opt.report = atof(argv[++i]);
+        else { fprintf(stderr, "relay: unknown argument %s (see the header of tools/relay.cpp)\n", argv[i]); return 2; }
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    relay.sourceListen = NetListenTcp("127.0.0.1", opt.sourcePort, 4);
+    relay.spectatorListen = NetListenTcp("0.0.0.0", opt.port, 256);
+    if (relay.sourceListen < 0 || relay.spectatorListen < 0) {
+        fprintf(stderr, "relay: cannot listen on %d/%d\n", opt.sourcePort, opt.port);
+        return 2;
+    }
+    SetNonBlocking(relay.sourceListen);
+    SetNonBlocking(relay.spectatorListen);
+    std::vector<unsigned char> hello;
+    SpecPutHello(hello);
+    relay.hello = std::make_shared<const std::vector<unsigned char>>(hello);
+    printf("relay: source on 127.0.0.1:%d, spectators on port %d\n", opt.sourcePort, opt.port);
+    fflush(stdout);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point lastReport = Clock::now();
+    unsigned long lastFrames = 0;
+    unsigned long long lastBytes = 0;
+    std::vector<pollfd> fds;
+    for (;;) {
+        // --- : who to wait for: both listeners, the source, spectators with something queued
+        fds.clear();
+        fds.push_back({ relay.sourceListen, POLLIN, 0 });
+        fds.push_back({ relay.spectatorListen, POLLIN, 0 });
+        fds.push_back({ relay.source, POLLIN, 0 });     // fd -1 is skipped by poll()
+        for (const std::unique_ptr<Spectator> &s : relay.spectators)
+            fds.push_back({ s->fd, (short)(POLLIN | (s->queue.empty() ? 0 : POLLOUT)), 0 });
+        poll(fds.data(), (nfds_t)fds.size(), 100);
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(relay.sourceListen, nullptr, nullptr);
+            if (fd >= 0 && relay.source >= 0) NetClose(fd);
+            else if (fd >= 0) {
+                SetNonBlocking(fd);
+                relay.source = fd;
+                relay.reader = SpecReader();
+                relay.cache.clear();
+                printf("relay: source connected\n");
+            }
+        }
+        if (fds[1].revents & POLLIN) AcceptSpectators(relay);
+        if (relay.source >= 0 && (fds[2].revents & (POLLIN | POLLHUP | POLLERR))) ReadSource(relay);
+
+        // --- : write to everyone (new frames were just queued), drop the ones that left
+        size_t polled = fds.size() - 3;     // spectators accepted above were not polled yet
+        for (size_t i = 0; i < relay.spectators.size(); ++i) {
+            Spectator &s = *relay.spectators[i];
+            bool gone = i < polled && (fds[3 + i].revents & (POLLHUP | POLLERR));
+            if (!gone && i < polled && (fds[3 + i].revents & POLLIN)) {
+                char discard[256];      // spectators have nothing to say; EOF means they left
+                ssize_t n = recv(s.fd, discard, sizeof(discard), 0);
+                gone = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+            }
+            if (gone || !FlushSpectator(relay, s)) {
+                NetClose(s.fd);
+                s.fd = -1;
+            }
+        }
+        relay.spectators.erase(std::remove_if(relay.spectators.begin(), relay.spectators.end(),
+                                              [](const std::unique_ptr<Spectator> &s) { return s->fd < 0; }),
+                               relay.spectators.end());
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - lastReport).count();
+        if (opt.report > 0.0 && elapsed >= opt.report) {
+            printf("relay: %zu spectators, %.1f frames/s in, %.2f MB/s out, %lu resyncs%s\n", relay.spectators.size(),
+                   (relay.frames - lastFrames)/elapsed, (relay.bytesOut - lastBytes)/elapsed/1e6, relay.resyncs,
+                   relay.source >= 0 ? "" : ", no source");
+            fflush(stdout);
+            lastReport = Clock::now();
+            lastFrames = relay.frames;
+            lastBytes = relay.bytesOut;
+        }
+    }
+}
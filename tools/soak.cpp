@@ -0,0 +1,164 @@
+/*******************************************************************************************
+* soak.cpp - headless soak test: the lookahead bot (bot.h) plays many games of "Dodge!"
+*
+*   - Each game is a fresh InitGame() with its own seed, driven through StepGame() (the same
+*     update code main() runs) by BotKeys() until GAME_OVER or --max-seconds of play
+*   - Every tick checks the invariants the game relies on (player on screen, pool counts
+*     consistent, finite positions); a violation fails the run with the seed and tick
+*   - Games are spread over --threads workers (one Game + Bot each), so the whole run
+*     scales with cores; results do not depend on the thread count
+*   - Prints games/s, game ticks/s and player moves tested per second by the lookahead and the survival distribution
+*
+* USAGE
+*   dodge_soak [--games 1000] [--threads N] [--seed 1] [--enemies 10] [--max-seconds 120]
+*              [--horizon 0.6] [--replan 1] [--dt 0.016667]
+*
+* Exit code: 0 pass, 1 invariant violation, 2 usage error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../bot.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+struct SoakOptions {
+    int games = 1000;
+    int threads = 0;                          // 0 = hardware concurrency
+    unsigned long long seed = 1;
+    int enemies = 10;
+    float maxSeconds = 120.0f;                // a game that survives this long counts as survived
+    float dt = 1.0f/60.0f;
+    BotConfig bot;
+};
+
+struct GameResult {
+    float seconds;                            // survived time
+    int score;
+    long ticks;                               // game ticks
+    long rolloutSteps;                        // ticks simulated by the bot's lookahead
+    bool violated;
+};
+
+// -----------------------------------------------------------------------------------------
+// Invariants checked after every tick; prints the first violation
+// -----------------------------------------------------------------------------------------
+static bool CheckInvariants(const Game &game, unsigned long long seed, long tick)
+{
+    const Rectangle &r = game.player.rect;
+    const EnemyPool &pool = game.enemies;
+    const char *problem = nullptr;
+
+    int sum = 0;
+    for (const EnemyBucket &b : pool.kinds) {
+        sum += b.count;
+        for (int i = 0; i < b.count && !problem; ++i) {
+            if (!std::isfinite(b.y[i]) || !(b.speedY[i] > 0.0f)) problem = "enemy with a bad y/speed";
+        }
+    }
+    if (!std::isfinite(r.x) || !std::isfinite(r.y)) problem = "player position not finite";
+    else if (r.x < 0.0f || r.y < 0.0f || r.x + r.width > SCREEN_W || r.y + r.height > SCREEN_H) problem = "player off screen";
+    else if (sum != pool.count) problem = "bucket counts do not add up to the pool count";
+    else if (pool.count > pool.limit) problem = "pool over its limit";
+
+    if (problem) printf("FAIL: seed %llu tick %ld: %s\n", seed, tick, problem);
+    return problem == nullptr;
+}
+
+static GameResult PlayOneGame(const SoakOptions &opt, unsigned long long seed, Game &game, Bot &bot)
+{
+    GameResult r = {};
+    InitGame(game, seed, opt.enemies, (WeatherKind)(seed % 3));
+    bot.keys = 0;
+    bot.holdTicks = 0;
+    bot.rolloutSteps = 0;
+
+    long maxTicks = (long)(opt.maxSeconds/opt.dt);
+    GameInput in{};
+    in.weather = -1;
+    in.dt = opt.dt;
+    in.keys = KEYS_START;
+    StepGame(game, in);
+
+    while (game.state == GameState::PLAYING && r.ticks < maxTicks) {
+        in.keys = BotKeys(bot, game);
+        StepGame(game, in);
+        r.ticks++;
+        if (!CheckInvariants(game, seed, r.ticks)) { r.violated = true; break; }
+    }
+    r.seconds = r.ticks*opt.dt;
+    r.score = (int)game.score;
+    r.rolloutSteps = bot.rolloutSteps;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    SoakOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) opt.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) opt.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) opt.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc) opt.enemies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-seconds") && i + 1 < argc) opt.maxSeconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--horizon") && i + 1 < argc) opt.bot.horizon = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--replan") && i + 1 < argc) opt.bot.replanEvery = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc) opt.dt = (float)atof(argv[++i]);
+        else { fprintf(stderr, "soak: unknown argument %s (see the header of tools/soak.cpp)\n", argv[i]); return 2; }
+    }
+    if (opt.games < 1 || opt.dt <= 0.0f) { fprintf(stderr, "soak: need --games >= 1 and --dt > 0\n"); return 2; }
+    if (opt.threads <= 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    opt.threads = std::min(opt.threads, opt.games);
+
+    std::vector<GameResult> results(opt.games);
+    std::atomic<int> next{ 0 };
+    auto start = std::chrono::steady_clock::now();
+
+    // Workers pull game indices; game i always uses seed + i, whichever thread plays it
+    std::vector<std::thread> workers;
+    for (int t = 0; t < opt.threads; ++t) {
+        workers.emplace_back([&]() {
+            Game game;
+            Bot bot;
+            bot.cfg = opt.bot;
+            for (int i; (i = next.fetch_add(1)) < opt.games; ) {
+                results[i] = PlayOneGame(opt, opt.seed + (unsigned long long)i, game, bot);
+            }
+        });
+    }
+    for (std::thread &w : workers) w.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long ticks = 0, rollout = 0;
+    int violations = 0, survived = 0;
+    std::vector<float> seconds;
+    for (const GameResult &r : results) {
+        ticks += r.ticks;
+        rollout += r.rolloutSteps;
+        violations += r.violated;
+        survived += (r.seconds >= opt.maxSeconds - opt.dt);
+        seconds.push_back(r.seconds);
+    }
+    std::sort(seconds.begin(), seconds.end());
+    double mean = 0.0;
+    for (float s : seconds) mean += s;
+    mean /= seconds.size();
+
+    printf("soak        %d games, %d threads, %d enemies, horizon %.2f s, replan every %d ticks\n",
+           opt.games, opt.threads, opt.enemies, opt.bot.horizon, opt.bot.replanEvery);
+    printf("survival    mean %.1f s, p10 %.1f s, p50 %.1f s, p90 %.1f s, %d/%d reached %.0f s\n", mean,
+           seconds[seconds.size()/10], seconds[seconds.size()/2], seconds[seconds.size()*9/10],
+           survived, opt.games, opt.maxSeconds);
+    printf("throughput  %.1f s wall, %.0f games/s, %.2e game ticks/s, %.2e lookahead moves/s\n",
+           sec, opt.games/sec, ticks/sec, rollout/sec);
+
+    if (violations) { printf("FAIL: %d games broke an invariant\n", violations); return 1; }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,309 @@
+/*******************************************************************************************
+* spectate.cpp - spectator streaming test: a headless game broadcasts, many spectators watch
+*
+*   Start tools/relay.cpp first, then this: a source thread plays "Dodge!" with the bot
+*   (bot.h, through StepGame() at a fixed 60 Hz in real time, restarting after every game
+*   over) and sends its SpecSource stream to the relay; a watcher thread connects
+*   --spectators sockets to the relay and decodes every frame of every one of them.
+*
+*   - Every decoded frame is checked against the hash the source put in its header, so a
+*     spectator that rebuilt anything other than the source's quantized state is an error
+*   - --slow spectators only read for SLOW_READ_MS out of every SLOW_PERIOD_MS, so they fall
+*     behind until the relay cuts them back to a keyframe. Each one must be cut back at least
+*     once and, at the end of every read after that, be at most
+*     SPEC_KEYFRAME_TICKS + SLOW_LAG_MARGIN ticks behind the source (waiting for the next
+*     keyframe, plus what was still buffered when the relay cut, is the most a cut leaves).
+*     This needs a stream where one period is more than the relay's --backlog-kb, e.g.
+*     --enemies 3000
+*   - Prints source bytes per tick (deltas, keyframes, and a snapshot.h save state for
+*     comparison), encode time per tick, quantization error, and per spectator: frames,
+*     cuts back to a keyframe and how many ticks behind the source it was
+*
+* USAGE
+*   dodge_spectate [--spectators 200] [--slow 0] [--seconds 20] [--enemies 10]
+*                  [--relay 127.0.0.1] [--source-port 7470] [--port 7471] [--fast]
+*
+*   --fast ticks as fast as the relay takes it instead of 60 Hz (throughput)
+*
+* Exit code: 0 ok, 1 decode errors, a spectator that never synced, or a slow spectator that was
+*            never cut back or stayed too far behind, 2 usage or connection error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../bot.h"
+#include "../snapshot.h"
+#include "../spectate.h"
+#include "../net.h"
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct SpectateOptions {
+    int spectators = 200;
+    int slow = 0;
+    double seconds = 20.0;
+    int enemies = 10;
+    const char *relay = "127.0.0.1";
+    int sourcePort = 7470;
+    int port = 7471;
+    bool fast = false;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Slow spectators: a short read every period. At 3000 enemies a period of stream is well past
+// what the relay (--backlog-kb 256) and the two socket buffers hold together
+static const int SLOW_PERIOD_MS = 3000;
+static const int SLOW_READ_MS = 100;
+// Ticks past SPEC_KEYFRAME_TICKS a read may end behind: the frames still sitting in the socket
+// buffers when the relay cut (~40 ticks at 3000 enemies) plus scheduling slack
+static const unsigned int SLOW_LAG_MARGIN = 60;
+
+static std::atomic<unsigned int> gSourceTick{ 0 };
+static std::atomic<bool> gSourceDone{ false };
+
+struct SourceResult {
+    unsigned long frames = 0, skipped = 0, keyframes = 0;
+    unsigned long long deltaBytes = 0, keyframeBytes = 0, rawBytes = 0;
+    double encodeUs = 0.0, worstEncodeUs = 0.0;
+    float maxError = 0.0f;            // px, quantized vs true position
+    bool connected = false;
+};
+
+// -----------------------------------------------------------------------------------------
+// Source: bot-played game, one SpecSourceTick per tick
+// -----------------------------------------------------------------------------------------
+static void RunSource(const SpectateOptions &opt, SourceResult &res)
+{
+    std::unique_ptr<SpecSource> src(new SpecSource);
+    Game game;
+    InitGame(game, 12345, opt.enemies, WeatherKind::SUNNY);
+    ResetGame(game);
+    ChangeState(game, GameState::PLAYING);
+    Bot bot;
+
+    res.connected = SpecSourceOpen(*src, opt.relay, opt.sourcePort, game.enemies.capacity());
+    if (!res.connected) { gSourceDone = true; return; }
+
+    const float dt = 1.0f/60.0f;
+    const long ticks = (long)(opt.seconds*60.0);
+    Clock::time_point start = Clock::now();
+    for (long t = 0; t < ticks && src->fd >= 0; ++t) {
+        GameInput in{};
+        in.dt = dt;
+        in.weather = (t % 1200 == 0) ? (signed char)((t/1200) % 3) : -1;   // a weather change every 20 s
+        in.keys = (game.state == GameState::PLAYING) ? BotKeys(bot, game) : (unsigned char)KEYS_RESTART;
+        StepGame(game, in);
+
+        unsigned long long before = src->bytes;
+        bool keyframe = src->needKeyframe || src->sinceKeyframe + 1 >= SPEC_KEYFRAME_TICKS;
+        unsigned long frames = src->frames;
+        gSourceTick = src->tick;        // before the frame leaves, so no spectator is ever "ahead"
+        Clock::time_point t0 = Clock::now();
+        SpecSourceTick(*src, game);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+        if (src->frames != frames) {
+            res.encodeUs += us;
+            res.worstEncodeUs = std::max(res.worstEncodeUs, us);
+            unsigned long long bytes = src->bytes - before;
+            if (keyframe) { res.keyframes++; res.keyframeBytes += bytes; }
+            else res.deltaBytes += bytes;
+            res.rawBytes += GameSnapshotSize(game);
+        }
+        for (const EnemyBucket &b : game.enemies.kinds)
+            for (int i = 0; i < b.count; ++i)
+                res.maxError = std::max(res.maxError, fabsf(SpecDequantize(SpecQuantize(b.y[i])) - b.y[i]));
+
+        if (!opt.fast) std::this_thread::sleep_until(start + std::chrono::microseconds((long long)((t + 1)*1e6/60.0)));
+    }
+    // Let the last frames out before closing
+    for (int i = 0; i < 100 && src->fd >= 0 && src->sent < src->out.size(); ++i) {
+        SpecSourceFlush(*src);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    res.frames = src->frames;
+    res.skipped = src->skipped;
+    SpecSourceClose(*src);
+    gSourceDone = true;
+}
+
+// -----------------------------------------------------------------------------------------
+// Watchers: every spectator connection decodes everything it gets
+// -----------------------------------------------------------------------------------------
+struct Watcher {
+    int fd = -1;
+    bool slow = false;
+    SpecReader reader;
+    SpecState state;
+    unsigned long frames = 0, errors = 0, waiting = 0, resyncs = 0;
+    unsigned int lastTick = 0;
+    bool synced = false;
+    double lagSum = 0.0;              // ticks behind the source, sampled per decoded frame
+    unsigned long lagSamples = 0;
+    unsigned int maxLag = 0;
+    unsigned int settledLag = 0;      // slow: most ticks behind at the end of a read
+    bool reading = false;             // slow: inside a read, until readUntil
+    Clock::time_point nextRead, readUntil;
+};
+
+static bool ReadWatcher(Watcher &w)
+{
+    unsigned char buffer[64*1024];
+    for (;;) {
+        ssize_t n = recv(w.fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) return false;
+        SpecReaderFeed(w.reader, buffer, (size_t)n);
+        const unsigned char *frame;
+        size_t size;
+        int got;
+        while ((got = SpecReaderNext(w.reader, frame, size)) == 1) {
+            SpecFrameHeader h;
+            memcpy(&h, frame, sizeof(h));
+            bool wasValid = w.state.valid;
+            if (w.synced && wasValid && h.type == SPEC_KEYFRAME && h.tick != w.lastTick + 1) w.resyncs++;
+            if (SpecDecode(w.state, frame, size)) {
+                w.frames++;
+                w.synced = true;
+                w.lastTick = h.tick;
+                unsigned int lag = gSourceTick - h.tick;
+                w.lagSum += lag;
+                w.lagSamples++;
+                w.maxLag = std::max(w.maxLag, lag);
+            }
+            else if (h.type == SPEC_DELTA && !wasValid) w.waiting++;   // joined mid-stream or cut back
+            else w.errors++;
+        }
+        if (got < 0) return false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SpectateOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--spectators") && i + 1 < argc) opt.spectators = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--slow") && i + 1 < argc) opt.slow = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) opt.seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc) opt.enemies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--relay") && i + 1 < argc) opt.relay = argv[++i];
+        else if (!strcmp(argv[i], "--source-port") && i + 1 < argc) opt.sourcePort = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opt.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fast")) opt.fast = true;
+        else { fprintf(stderr, "spectate: unknown argument %s (see the header of tools/spectate.cpp)\n", argv[i]); return 2; }
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<Watcher> watchers((size_t)(opt.spectators + opt.slow));
+    for (size_t i = 0; i < watchers.size(); ++i) {
+        Watcher &w = watchers[i];
+        w.fd = NetConnectTcp(opt.relay, opt.port);
+        if (w.fd < 0) { fprintf(stderr, "spectate: cannot connect to the relay at %s:%d\n", opt.relay, opt.port); return 2; }
+        fcntl(w.fd, F_SETFL, fcntl(w.fd, F_GETFL, 0) | O_NONBLOCK);
+        w.slow = (int)i >= opt.spectators;
+        if (w.slow) {
+            // A fixed receive window, so the backlog builds up in the relay. Not much smaller:
+            // below one loopback segment (64 KB) the kernel holds back window updates and the
+            // reads crawl along on zero-window probes
+            int window = 64*1024;
+            setsockopt(w.fd, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+        }
+    }
+
+    SourceResult source;
+    std::thread sourceThread(RunSource, std::cref(opt), std::ref(source));
+
+    std::vector<pollfd> fds(watchers.size());
+    Clock::time_point doneAt{};
+    bool draining = false;
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        for (size_t i = 0; i < watchers.size(); ++i) {
+            Watcher &w = watchers[i];
+            if (w.slow && w.reading && now >= w.readUntil) {
+                // A read just ended: how far behind it left this spectator. Counted from the first
+                // cut on; before that it is still catching up on the join (up to a keyframe late)
+                w.reading = false;
+                if (w.synced && w.resyncs > 0) w.settledLag = std::max(w.settledLag, gSourceTick - w.lastTick);
+            }
+            if (w.slow && now >= w.nextRead) {
+                w.reading = true;
+                w.readUntil = now + std::chrono::milliseconds(SLOW_READ_MS);
+                w.nextRead = now + std::chrono::milliseconds(SLOW_PERIOD_MS);
+            }
+            bool wantRead = w.fd >= 0 && (!w.slow || w.reading);
+            fds[i] = { wantRead ? w.fd : -1, POLLIN, 0 };
+        }
+        poll(fds.data(), (nfds_t)fds.size(), 20);
+        now = Clock::now();
+        for (size_t i = 0; i < watchers.size(); ++i) {
+            Watcher &w = watchers[i];
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (!ReadWatcher(w)) { NetClose(w.fd); w.fd = -1; }
+        }
+        // After the source stops: half a second for the relay to deliver the rest
+        if (gSourceDone && !draining) { draining = true; doneAt = now; }
+        if (draining && now - doneAt > std::chrono::milliseconds(500)) break;
+    }
+    sourceThread.join();
+    if (!source.connected) { fprintf(stderr, "spectate: cannot connect to the relay source port %s:%d\n", opt.relay, opt.sourcePort); return 2; }
+
+    unsigned long deltas = source.frames - source.keyframes;
+    printf("source: %lu frames (%lu keyframes), %lu ticks skipped, %d enemies at start\n",
+           source.frames, source.keyframes, source.skipped, opt.enemies);
+    printf("  bytes/tick: delta %.1f, keyframe %.1f, raw save state %.1f (%.1fx smaller on average)\n",
+           deltas ? (double)source.deltaBytes/deltas : 0.0, source.keyframes ? (double)source.keyframeBytes/source.keyframes : 0.0,
+           source.frames ? (double)source.rawBytes/source.frames : 0.0,
+           (double)source.rawBytes/std::max(1ull, source.deltaBytes + source.keyframeBytes));
+    printf("  encode + send: %.2f us/tick average, %.1f us worst; quantization error <= %.4f px\n",
+           source.frames ? source.encodeUs/source.frames : 0.0, source.worstEncodeUs, source.maxError);
+
+    bool ok = true;
+    for (int slow = 0; slow < 2; ++slow) {
+        unsigned long n = 0, frames = 0, errors = 0, resyncs = 0, unsynced = 0, minFrames = ~0ul;
+        double lag = 0.0;
+        unsigned long lagSamples = 0;
+        unsigned int maxLag = 0, settledLag = 0;
+        unsigned long neverCut = 0;
+        for (const Watcher &w : watchers) {
+            if (w.slow != (slow == 1)) continue;
+            n++;
+            frames += w.frames;
+            minFrames = std::min(minFrames, w.frames);
+            errors += w.errors;
+            resyncs += w.resyncs;
+            unsynced += w.synced ? 0 : 1;
+            lag += w.lagSum;
+            lagSamples += w.lagSamples;
+            maxLag = std::max(maxLag, w.maxLag);
+            settledLag = std::max(settledLag, w.settledLag);
+            neverCut += (w.resyncs == 0) ? 1 : 0;
+        }
+        if (n == 0) continue;
+        printf("%s spectators: %lu, frames %.1f average (fewest %lu), %lu decode errors, %lu cut back to a keyframe, "
+               "%lu never synced, %.2f ticks behind on average (worst %u)\n",
+               slow ? "slow" : "normal", n, (double)frames/n, minFrames, errors, resyncs, unsynced,
+               lagSamples ? lag/lagSamples : 0.0, maxLag);
+        if (errors > 0 || unsynced > 0) ok = false;
+        if (slow) {
+            unsigned int limit = SPEC_KEYFRAME_TICKS + SLOW_LAG_MARGIN;
+            printf("  after each read: at most %u ticks behind (limit %u), %lu never cut back\n", settledLag, limit, neverCut);
+            if (neverCut > 0) printf("  a slow spectator was never cut back: use more --enemies, or a smaller relay --backlog-kb\n");
+            if (neverCut > 0 || settledLag > limit) ok = false;
+        }
+    }
+    for (Watcher &w : watchers) NetClose(w.fd);
+    printf(ok ? "OK\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************************
+* verify.cpp - replay verification service for a local "Dodge!" leaderboard
+*
+*   A score is accepted only if its recording (.rec, see replay.h) re-simulates to it:
+*
+*   --serve   listens on 127.0.0.1:<port>. Each connection sends requests (any number,
+*             pipelined) and gets one response per request, matched by id; responses can
+*             come back out of order. Reader threads queue the requests, a pool of --threads
+*             workers re-simulates them through StepGame() (the update code main() runs,
+*             with the built-in enemy profiles, like tools/regress) and answers.
+*   --submit  sends one recording with its claimed score and prints the verdict
+*   --load    floods a server with copies of one recording over several connections and
+*             reports verified replays per minute (the throughput check)
+*
+*   Wire format (little-endian, TCP):
+*     request   VerifyRequest (16 bytes), then `size` bytes of a .rec file
+*     response  VerifyResponse (32 bytes)
+*
+*   - The verified score is the best score of the recording (runs that ended, plus the one
+*     still going at the last tick), the same number the "Best:" HUD shows
+*   - A recording is rejected as invalid when it is not a .rec, is longer than --max-ticks,
+*     starts with a different enemy count than --enemies, or has a tick whose dt is outside
+*     [VERIFY_MIN_DT, VERIFY_MAX_DT] or whose weather is not -1..2
+*   - When the queue holds --queue requests, new ones are answered VERIFY_BUSY at once (the
+*     client may retry later); --load keeps --in-flight requests per connection instead
+*   - Workers keep their Game and Replay between jobs, so a re-simulation does not allocate
+*
+* USAGE
+*   dodge_verify --serve [--port 7461] [--threads N] [--queue 4096] [--max-ticks 216000] [--enemies 10]
+*   dodge_verify --submit run.rec --claim SCORE [--port 7461]
+*   dodge_verify --load run.rec [--requests 2000] [--connections 4] [--in-flight 64] [--port 7461]
+*
+* Exit code: 0 ok/accepted, 1 rejected, 2 usage, I/O or connection error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../replay.h"
+#include "../net.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char VERIFY_REQUEST_MAGIC[4] = { 'D', 'V', 'R', 'Q' };
+static const char VERIFY_RESPONSE_MAGIC[4] = { 'D', 'V', 'R', 'S' };
+static const float VERIFY_MIN_DT = 1.0f/1000.0f;      // a tick shorter than this is not a real frame
+static const float VERIFY_MAX_DT = 0.5f;              // longest hitch main() can produce and still play
+
+enum VerifyStatus { VERIFY_ACCEPTED = 0, VERIFY_SCORE_MISMATCH, VERIFY_INVALID, VERIFY_BUSY, VERIFY_STATUS_COUNT };
+static const char *VERIFY_STATUS_NAMES[VERIFY_STATUS_COUNT] = { "ACCEPTED", "SCORE_MISMATCH", "INVALID", "BUSY" };
+
+struct VerifyRequest {
+    char magic[4];
+    unsigned int id;                  // echoed in the response
+    int claimedScore;
+    unsigned int size;                // bytes of .rec that follow
+};
+
+struct VerifyResponse {
+    char magic[4];
+    unsigned int id;
+    int status;                       // VerifyStatus
+    int verifiedScore;                // best score of the re-simulated recording
+    unsigned long long checksum;      // GameChecksum() after the last tick
+    unsigned int ticks;
+    float seconds;                    // played time, the sum of every tick's dt
+};
+
+static_assert(sizeof(VerifyRequest) == 16 && sizeof(VerifyResponse) == 32, "wire structs must not be padded");
+
+struct VerifyOptions {
+    int port = 7461;
+    int threads = 0;                  // 0 = hardware concurrency
+    int queue = 4096;
+    int maxTicks = 60*60*60;          // one hour at 60 FPS
+    int enemies = 10;                 // what main() starts a run with
+    int requests = 2000;
+    int connections = 4;
+    int inFlight = 64;                // requests a --load connection sends ahead of its answers
+    int claim = 0;
+};
+
+// -----------------------------------------------------------------------------------------
+// Re-simulation (one worker's Game and Replay, reused across jobs)
+// -----------------------------------------------------------------------------------------
+static VerifyResponse VerifyRecording(const VerifyOptions &opt, const VerifyRequest &req, const std::vector<unsigned char> &rec,
+                                      Game &game, Replay &replay)
+{
+    VerifyResponse res = {};
+    memcpy(res.magic, VERIFY_RESPONSE_MAGIC, sizeof(res.magic));
+    res.id = req.id;
+    res.status = VERIFY_INVALID;
+
+    if (!ParseReplay(rec.data(), rec.size(), replay)) return res;
+    if (replay.header.enemyCount != opt.enemies || replay.header.weather < 0 || replay.header.weather > 2) return res;
+    if (replay.ticks.empty() || replay.ticks.size() > (size_t)opt.maxTicks) return res;
+    for (const GameInput &in : replay.ticks) {
+        if (!(in.dt >= VERIFY_MIN_DT && in.dt <= VERIFY_MAX_DT) || in.weather < -1 || in.weather > 2) return res;
+    }
+
+    InitGameFromReplay(game, replay);
+    float seconds = 0.0f;
+    for (const GameInput &in : replay.ticks) {
+        StepGame(game, in);
+        seconds += in.dt;
+    }
+
+    res.verifiedScore = std::max(game.bestScore, (int)game.score);
+    res.status = (res.verifiedScore == req.claimedScore) ? VERIFY_ACCEPTED : VERIFY_SCORE_MISMATCH;
+    res.checksum = GameChecksum(game);
+    res.ticks = (unsigned int)replay.ticks.size();
+    res.seconds = seconds;
+    return res;
+}
+
+// -----------------------------------------------------------------------------------------
+// Server: a reader thread per connection queues jobs, --threads workers answer them
+// -----------------------------------------------------------------------------------------
+struct VerifyConnection {
+    int fd = -1;
+    std::mutex sendLock;              // workers answer on the same socket
+    ~VerifyConnection() { NetClose(fd); }
+};
+
+struct VerifyJob {
+    std::shared_ptr<VerifyConnection> conn;
+    VerifyRequest req;
+    std::vector<unsigned char> rec;
+};
+
+struct VerifyServer {
+    VerifyOptions opt;
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<VerifyJob> queue;
+
+    std::atomic<long> verdicts[VERIFY_STATUS_COUNT] = {};
+    std::atomic<long> ticks{ 0 };
+};
+
+static void SendResponse(VerifyConnection &conn, const VerifyResponse &res)
+{
+    std::lock_guard<std::mutex> guard(conn.sendLock);
+    NetSendAll(conn.fd, &res, sizeof(res));   // a client that left just misses its answer
+}
+
+static void ServeWorker(VerifyServer *server)
+{
+    Game game;
+    Replay replay;
+    for (;;) {
+        VerifyJob job;
+        {
+            std::unique_lock<std::mutex> guard(server->lock);
+            server->ready.wait(guard, [&]() { return !server->queue.empty(); });
+            job = std::move(server->queue.front());
+            server->queue.pop_front();
+        }
+        VerifyResponse res = VerifyRecording(server->opt, job.req, job.rec, game, replay);
+        server->verdicts[res.status]++;
+        server->ticks += res.ticks;
+        SendResponse(*job.conn, res);
+    }
+}
+
+static void ServeConnection(VerifyServer *server, std::shared_ptr<VerifyConnection> conn)
+{
+    const size_t maxSize = sizeof(ReplayHeader) + (size_t)server->opt.maxTicks*REPLAY_TICK_SIZE;
+    VerifyRequest req;
+    while (NetRecvAll(conn->fd, &req, sizeof(req))) {
+        VerifyResponse busy = {};
+        memcpy(busy.magic, VERIFY_RESPONSE_MAGIC, sizeof(busy.magic));
+        busy.id = req.id;
+
+        // A malformed header or an oversized body ends the connection (the stream is lost)
+        if (memcmp(req.magic, VERIFY_REQUEST_MAGIC, sizeof(req.magic)) != 0 || req.size > maxSize) {
+            busy.status = VERIFY_INVALID;
+            server->verdicts[VERIFY_INVALID]++;
+            SendResponse(*conn, busy);
+            break;
+        }
+
+        VerifyJob job;
+        job.conn = conn;
+        job.req = req;
+        job.rec.resize(req.size);
+        if (!NetRecvAll(conn->fd, job.rec.data(), req.size)) break;
+
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> guard(server->lock);
+            if ((int)server->queue.size() < server->opt.queue) {
+                server->queue.push_back(std::move(job));
+                queued = true;
+            }
+        }
+        if (queued) {
+            server->ready.notify_one();
+        } else {
+            busy.status = VERIFY_BUSY;
+            server->verdicts[VERIFY_BUSY]++;
+            SendResponse(*conn, busy);
+        }
+    }
+    shutdown(conn->fd, SHUT_RD);   // queued jobs still answer; the socket closes with the last one
+}
+
+static int Serve(const VerifyOptions &opt)
+{
+    int listenFd = NetListenTcp("127.0.0.1", opt.port, 64);
+    if (listenFd < 0) { fprintf(stderr, "verify: could not listen on 127.0.0.1:%d\n", opt.port); return 2; }
+
+    static VerifyServer server;       // lives as long as the detached threads
+    server.opt = opt;
+    for (int t = 0; t < opt.threads; ++t) std::thread(ServeWorker, &server).detach();
+
+    // Prints the totals every 10 s while there is traffic
+    std::thread([]() {
+        long lastDone = 0;
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+            long done = 0;
+            for (const std::atomic<long> &v : server.verdicts) done += v;
+            if (done == lastDone) continue;
+            printf("verify      %.0f replays/min, %ld accepted, %ld score mismatch, %ld invalid, %ld busy, %.2e ticks total\n",
+                   (done - lastDone)*6.0, server.verdicts[VERIFY_ACCEPTED].load(), server.verdicts[VERIFY_SCORE_MISMATCH].load(),
+                   server.verdicts[VERIFY_INVALID].load(), server.verdicts[VERIFY_BUSY].load(), (double)server.ticks.load());
+            fflush(stdout);
+            lastDone = done;
+        }
+    }).detach();
+
+    printf("verify      listening on 127.0.0.1:%d, %d workers, queue %d, %d enemies, max %d ticks\n",
+           opt.port, opt.threads, opt.queue, opt.enemies, opt.maxTicks);
+    fflush(stdout);
+    for (;;) {
+        int fd = NetAccept(listenFd);
+        if (fd < 0) continue;
+        auto conn = std::make_shared<VerifyConnection>();
+        conn->fd = fd;
+        std::thread(ServeConnection, &server, conn).detach();
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+// Clients
+// -----------------------------------------------------------------------------------------
+static bool ReadFileBytes(const char *path, std::vector<unsigned char> &bytes)
+{
+    int size = 0;
+    unsigned char *data = LoadFileData(path, &size);
+    if (!data) return false;
+    bytes.assign(data, data + size);
+    UnloadFileData(data);
+    return true;
+}
+
+static bool SendRequest(int fd, unsigned int id, int claimedScore, const std::vector<unsigned char> &rec)
+{
+    VerifyRequest req;
+    memcpy(req.magic, VERIFY_REQUEST_MAGIC, sizeof(req.magic));
+    req.id = id;
+    req.claimedScore = claimedScore;
+    req.size = (unsigned int)rec.size();
+    return NetSendAll(fd, &req, sizeof(req)) && NetSendAll(fd, rec.data(), rec.size());
+}
+
+static bool RecvResponse(int fd, VerifyResponse &res)
+{
+    return NetRecvAll(fd, &res, sizeof(res)) && memcmp(res.magic, VERIFY_RESPONSE_MAGIC, sizeof(res.magic)) == 0 &&
+           res.status >= 0 && res.status < VERIFY_STATUS_COUNT;
+}
+
+static int Submit(const VerifyOptions &opt, const char *path)
+{
+    std::vector<unsigned char> rec;
+    if (!ReadFileBytes(path, rec)) { fprintf(stderr, "verify: could not read %s\n", path); return 2; }
+    int fd = NetConnectTcp("127.0.0.1", opt.port);
+    if (fd < 0) { fprintf(stderr, "verify: no server on 127.0.0.1:%d\n", opt.port); return 2; }
+
+    VerifyResponse res;
+    bool ok = SendRequest(fd, 1, opt.claim, rec) && RecvResponse(fd, res);
+    NetClose(fd);
+    if (!ok) { fprintf(stderr, "verify: connection lost\n"); return 2; }
+
+    printf("%s: claimed %d, verified %d, %u ticks (%.1f s), checksum %016llx\n", VERIFY_STATUS_NAMES[res.status],
+           opt.claim, res.verifiedScore, res.ticks, res.seconds, res.checksum);
+    return (res.status == VERIFY_ACCEPTED) ? 0 : 1;
+}
+
+// First asks the server for the recording's true score, then sends --requests copies claiming
+// it, spread over --connections; each connection sends and receives on separate threads and
+// keeps at most --in-flight requests unanswered, so the server queue is never flooded
+static int Load(const VerifyOptions &opt, const char *path)
+{
+    std::vector<unsigned char> rec;
+    if (!ReadFileBytes(path, rec)) { fprintf(stderr, "verify: could not read %s\n", path); return 2; }
+
+    int probe = NetConnectTcp("127.0.0.1", opt.port);
+    VerifyResponse truth;
+    bool ok = probe >= 0 && SendRequest(probe, 0, 0, rec) && RecvResponse(probe, truth);
+    NetClose(probe);
+    if (!ok || truth.status == VERIFY_INVALID || truth.status == VERIFY_BUSY) {
+        fprintf(stderr, "verify: could not get a verdict for %s from 127.0.0.1:%d\n", path, opt.port);
+        return 2;
+    }
+
+    std::atomic<long> verdicts[VERIFY_STATUS_COUNT] = {};
+    std::atomic<int> broken{ 0 };
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> clients;
+    for (int c = 0; c < opt.connections; ++c) {
+        int count = opt.requests/opt.connections + (c < opt.requests % opt.connections);
+        clients.emplace_back([&, count]() {
+            int fd = NetConnectTcp("127.0.0.1", opt.port);
+            if (fd < 0) { broken++; return; }
+            std::mutex lock;
+            std::condition_variable answered;
+            int inFlight = 0;
+            bool stop = false;
+            std::thread sender([&]() {
+                for (int i = 0; i < count; ++i) {
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        answered.wait(guard, [&]() { return inFlight < opt.inFlight || stop; });
+                        if (stop) break;
+                        inFlight++;
+                    }
+                    if (!SendRequest(fd, (unsigned int)i + 1, truth.verifiedScore, rec)) break;
+                }
+            });
+            VerifyResponse res;
+            for (int i = 0; i < count; ++i) {
+                if (!RecvResponse(fd, res)) { broken++; break; }
+                verdicts[res.status]++;
+                std::lock_guard<std::mutex> guard(lock);
+                inFlight--;
+                answered.notify_one();
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+                answered.notify_one();
+            }
+            shutdown(fd, SHUT_RDWR);
+            sender.join();
+            NetClose(fd);
+        });
+    }
+    for (std::thread &t : clients) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long accepted = verdicts[VERIFY_ACCEPTED];
+    printf("load        %d requests of %s (%u ticks, %.1f s of play, score %d) over %d connections\n", opt.requests, path,
+           truth.ticks, truth.seconds, truth.verifiedScore, opt.connections);
+    printf("verdicts    %ld accepted, %ld score mismatch, %ld invalid, %ld busy\n", accepted,
+           verdicts[VERIFY_SCORE_MISMATCH].load(), verdicts[VERIFY_INVALID].load(), verdicts[VERIFY_BUSY].load());
+    printf("throughput  %.2f s wall, %.0f verified replays/min, %.2e ticks/s\n", sec, accepted*60.0/sec,
+           (double)accepted*truth.ticks/sec);
+
+    if (broken || accepted != opt.requests) { printf("FAIL: %d broken connections, %ld not accepted\n", broken.load(), opt.requests - accepted); return 1; }
+    printf("PASS\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    VerifyOptions opt;
+    const char *submitPath = nullptr, *loadPath = nullptr;
+    bool serve = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--serve")) serve = true;
+        else if (!strcmp(argv[i], "--submit") && i + 1 < argc) submitPath = argv[++i];
+        else if (!strcmp(argv[i], "--load") && i + 1 < argc) loadPath = argv[++i];
+        else if (!strcmp(argv[i], "--claim") && i + 1 < argc) opt.claim = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opt.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) opt.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--queue") && i + 1 < argc) opt.queue = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--max-ticks") && i + 1 < argc) opt.maxTicks = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc) opt.enemies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--requests") && i + 1 < argc) opt.requests = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--connections") && i + 1 < argc) opt.connections = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--in-flight") && i + 1 < argc) opt.inFlight = std::max(1, atoi(argv[++i]));
+        else { fprintf(stderr, "verify: unknown argument %s (see the header of tools/verify.cpp)\n", argv[i]); return 2; }
+    }
+    if (opt.threads <= 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (serve) return Serve(opt);
+    if (submitPath) return Submit(opt, submitPath);
+    if (loadPath) return Load(opt, loadPath);
+    fprintf(stderr, "usage: %s --serve | --submit run.rec --claim SCORE | --load run.rec\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,215 @@
+/*******************************************************************************************
+* versus.cpp - loopback test of versus mode's rollback netcode (rollback.h, versus.h)
+*
+*   Two peers run in one process, each with its own UDP socket on 127.0.0.1 and its own
+*   RollbackSession + Versus, exactly as two `dodge --versus` processes would. Every datagram
+*   goes through NetLag (net.h): --latency one way, up to --jitter more (so packets reorder),
+*   --loss of them dropped. Frames are 1/60 s of simulated clock, so a run takes no real time.
+*
+*   - Each player holds random keys for random stretches (a new press every 6-40 ticks), so
+*     predictions keep failing and rollbacks happen all the time
+*   - After --ticks both stop and keep exchanging packets until every tick is confirmed;
+*     then both confirmed hash chains and final states must equal a reference run that
+*     steps the same inputs straight through, without any network
+*   - Prints rollbacks, re-simulated ticks, stalls, the worst frame, and what re-simulating
+*     8 and ROLLBACK_MAX_FRAMES ticks costs against the 16.7 ms frame budget
+*
+* USAGE
+*   dodge_versus [--ticks 18000] [--latency 50] [--jitter 20] [--loss 5] [--enemies 10]
+*                [--seed 7] [--port 47700]
+*
+* Exit code: 0 in sync, 1 desync or no progress, 2 usage or socket error
+*******************************************************************************************/
+
+#include "../game.h"
+#include "../net.h"
+#include "../rollback.h"
+#include "../versus.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+struct VersusOptions {
+    int ticks = 18000;                // 5 minutes
+    float latencyMs = 50.0f;          // one way
+    float jitterMs = 20.0f;
+    float lossPct = 5.0f;
+    int enemies = 10;
+    unsigned long long seed = 7;
+    int port = 47700;                 // player p binds port + p
+};
+
+struct Peer {
+    int fd = -1;
+    sockaddr_in to;
+    NetLag lag;
+    RollbackSession session;
+    Versus versus;
+    bool playing = false;             // VersusInit done (the seed is known)
+    GameRng script{ 1 };
+    unsigned char keys = 0;
+    int hold = 0;                     // frames left on `keys`
+    std::vector<unsigned char> inputs;    // keys used for tick k (the truth)
+    double worstUs = 0.0, totalUs = 0.0;
+    long frames = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double MicrosSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+// A random move held for a while
+static unsigned char ScriptKeys(Peer &peer)
+{
+    if (--peer.hold <= 0) {
+        peer.keys = MOVE_KEYS[RandomValue(peer.script, 0, MOVE_COUNT - 1)];
+        peer.hold = RandomValue(peer.script, 6, 40);
+    }
+    return peer.keys;
+}
+
+static void RunFrame(Peer &peer, const VersusOptions &opt, double now)
+{
+    unsigned char buffer[256];
+    int n;
+    while ((n = NetRecvUdp(peer.fd, buffer, sizeof(buffer))) >= 0) RollbackOnPacket(peer.session, buffer, n);
+
+    RollbackSession &s = peer.session;
+    if (s.started && !peer.playing) {
+        VersusInit(peer.versus, s.seed, opt.enemies);
+        peer.playing = true;
+    }
+
+    unsigned char keys = ScriptKeys(peer);
+    Clock::time_point t0 = Clock::now();
+    bool stepped = RollbackAdvance(s, peer.versus, keys);
+    double us = MicrosSince(t0);
+    if (peer.playing) {
+        peer.totalUs += us;
+        peer.frames++;
+        if (us > peer.worstUs) peer.worstUs = us;
+    }
+    if (stepped && s.tick - 1 + ROLLBACK_INPUT_DELAY < (int)peer.inputs.size())
+        peer.inputs[(size_t)(s.tick - 1 + ROLLBACK_INPUT_DELAY)] = keys;
+
+    RollbackPacket pkt;
+    RollbackMakePacket(s, pkt);
+    NetLagSend(peer.lag, peer.fd, peer.to, &pkt, sizeof(pkt), now);
+}
+
+// Average cost of one rollback of `depth` ticks: load the state, re-step, re-save
+static double MeasureResim(Versus &versus, RollbackSession &scratch, int depth)
+{
+    const int REPEATS = 200;
+    RollbackInit(scratch, 0, 1);
+    scratch.started = true;
+    SaveVersusSnapshot(versus, scratch.snapshots[0]);
+    Clock::time_point t0 = Clock::now();
+    for (int r = 0; r < REPEATS; ++r) {
+        LoadVersusSnapshot(versus, scratch.snapshots[0]);
+        for (int k = 0; k < depth; ++k) RollbackStepTick(scratch, versus, k);
+    }
+    return MicrosSince(t0)/REPEATS;
+}
+
+int main(int argc, char **argv)
+{
+    VersusOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--ticks") && i + 1 < argc) opt.ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--latency") && i + 1 < argc) opt.latencyMs = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) opt.jitterMs = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc) opt.lossPct = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc) opt.enemies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) opt.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) opt.port = atoi(argv[++i]);
+        else { fprintf(stderr, "versus: unknown argument %s (see the header of tools/versus.cpp)\n", argv[i]); return 2; }
+    }
+    if (opt.ticks < 1 || opt.enemies < 1) { fprintf(stderr, "versus: --ticks and --enemies must be positive\n"); return 2; }
+
+    std::unique_ptr<Peer[]> peers(new Peer[2]);
+    for (int p = 0; p < 2; ++p) {
+        Peer &peer = peers[p];
+        peer.fd = NetBindUdp("127.0.0.1", opt.port + p);
+        if (peer.fd < 0 || !NetAddress("127.0.0.1", opt.port + 1 - p, peer.to)) {
+            fprintf(stderr, "versus: cannot bind 127.0.0.1:%d\n", opt.port + p);
+            return 2;
+        }
+        peer.lag.latency = opt.latencyMs/1000.0;
+        peer.lag.jitter = opt.jitterMs/1000.0;
+        peer.lag.loss = opt.lossPct/100.0f;
+        peer.lag.rng += (unsigned long long)p*0x632BE59BD9B4E019ull;
+        SeedRandom(peer.script, opt.seed*2 + (unsigned long long)p + 1);
+        RollbackInit(peer.session, p, opt.seed);
+        peer.session.stopTick = opt.ticks;
+        peer.inputs.assign((size_t)opt.ticks + ROLLBACK_INPUT_DELAY, 0);
+    }
+
+    // Frames until both have simulated and confirmed every tick (generous cap for bad links)
+    const long maxFrames = (long)opt.ticks*4 + 60*60;
+    long frame = 0;
+    for (; frame < maxFrames; ++frame) {
+        double now = frame*(double)VERSUS_DT;
+        for (int p = 0; p < 2; ++p) NetLagFlush(peers[p].lag, peers[p].fd, peers[p].to, now);
+        for (int p = 0; p < 2; ++p) RunFrame(peers[p], opt, now);
+        if (peers[0].session.confirmedTick == opt.ticks && peers[1].session.confirmedTick == opt.ticks) break;
+    }
+
+    printf("versus: %d ticks, %d enemies, latency %.0f ms + jitter %.0f ms, loss %.1f%%, window %d, input delay %d\n",
+           opt.ticks, opt.enemies, opt.latencyMs, opt.jitterMs, opt.lossPct, ROLLBACK_MAX_FRAMES, ROLLBACK_INPUT_DELAY);
+    for (int p = 0; p < 2; ++p) {
+        const Peer &peer = peers[p];
+        const RollbackStats &st = peer.session.stats;
+        printf("  player %d: %lu packets sent, %lu dropped | %d rollbacks, %d ticks re-simulated, max depth %d | "
+               "%d stall frames | %d/%d predictions wrong | frame avg %.1f us, worst %.1f us\n",
+               p, peer.lag.sent, peer.lag.dropped, st.rollbacks, st.resimTicks, st.maxDepth, st.stalls,
+               st.mispredicted, st.predicted, peer.frames ? peer.totalUs/peer.frames : 0.0, peer.worstUs);
+    }
+    printf("  %ld frames for %d ticks (%.1f%% waiting)\n", frame, opt.ticks, 100.0*(frame - opt.ticks)/(frame ? frame : 1));
+
+    bool ok = frame < maxFrames;
+    if (!ok) printf("FAIL: not every tick confirmed after %ld frames (player 0 at %d, player 1 at %d)\n",
+                    frame, peers[0].session.confirmedTick, peers[1].session.confirmedTick);
+
+    // Reference: the same inputs stepped straight through
+    std::unique_ptr<Versus> ref(new Versus);
+    VersusInit(*ref, opt.seed, opt.enemies);
+    unsigned long long chain = 0xCBF29CE484222325ull;
+    for (int k = 0; k < opt.ticks; ++k) {
+        unsigned char keys[VERSUS_PLAYERS] = { peers[0].inputs[(size_t)k], peers[1].inputs[(size_t)k] };
+        VersusStep(*ref, keys);
+        unsigned long long h = VersusChecksum(*ref);
+        chain = HashBytes(chain, &h, sizeof(h));
+    }
+    const VersusPlayers &rp = ref->players;
+    printf("  reference: round %d, wins %d-%d, checksum %016llx, hash chain %016llx\n",
+           rp.round, rp.wins[0], rp.wins[1], VersusChecksum(*ref), chain);
+    for (int p = 0; ok && p < 2; ++p) {
+        const Peer &peer = peers[p];
+        unsigned long long h = VersusChecksum(peer.versus);
+        if (peer.session.confirmedHash != chain || h != VersusChecksum(*ref)) {
+            printf("FAIL: player %d desynced (checksum %016llx, hash chain %016llx)\n", p, h, peer.session.confirmedHash);
+            ok = false;
+        }
+    }
+    if (ok) printf("  both peers match the reference\n");
+
+    // Rollback cost on the final state (scratch session: the peers' are left as they are)
+    std::unique_ptr<RollbackSession> scratch(new RollbackSession);
+    std::unique_ptr<Versus> field(new Versus);
+    VersusInit(*field, opt.seed, opt.enemies);
+    LoadVersusSnapshot(*field, peers[0].session.snapshots[(opt.ticks - 1) % ROLLBACK_SNAPSHOTS]);
+    double us8 = MeasureResim(*field, *scratch, 8);
+    double usMax = MeasureResim(*field, *scratch, ROLLBACK_MAX_FRAMES);
+    printf("  re-simulating 8 ticks: %.1f us, %d ticks: %.1f us (%.2f%% of a 16.7 ms frame)\n",
+           us8, ROLLBACK_MAX_FRAMES, usMax, usMax/(1e6/60.0)*100.0);
+
+    for (int p = 0; p < 2; ++p) NetClose(peers[p].fd);
+    return ok ? 0 : 1;
+}
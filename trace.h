@@ -0,0 +1,162 @@
+/*******************************************************************************************
+* trace.h - Chrome trace-event exporter for "Dodge!" (open in chrome://tracing or ui.perfetto.dev)
+*
+*   - Frame phases (the same PROFILE_SCOPE blocks used by profiler.h), whole frames,
+*     ResetGame() calls, state changes and weather changes are recorded
+*   - Events go into a preallocated ring; nothing is formatted or written while recording
+*   - TraceFlushIfIdle() writes pending events after EndDrawing, but only outside PLAYING
+*     (or when the ring is nearly full), so the gameplay frames never pay for I/O
+*   - The output file is valid JSON after every flush (the closing bracket is rewritten)
+*   - Web: the file lives in MEMFS; F5 downloads it via saveFileFromMEMFSToDisk (shell.html)
+*
+* Compile-time switch: build with -DDODGE_TRACE to enable, otherwise everything is a no-op.
+*******************************************************************************************/
+
+#pragma once
+
+#ifdef DODGE_TRACE
+
+#include "raylib.h"
+#include <chrono>
+#include <cstdio>
+
+#ifdef __EMSCRIPTEN__
+  #include <emscripten/emscripten.h>
+#endif
+
+#define TRACE_FILE "dodge_trace.json"       // cwd on desktop, MEMFS root on web
+
+static const int TRACE_CAPACITY = 1 << 16;   // events (~2.5 MB), about 2 minutes of PLAYING
+
+struct TraceEvent {
+    const char *name;       // must be a string literal / static string
+    const char *argName;    // optional single string argument
+    const char *argValue;
+    double tsUs;            // start, microseconds since TraceOpen()
+    float durUs;            // 'X' events only
+    char ph;                // 'X' complete, 'i' instant
+};
+
+struct TraceRing {
+    TraceEvent events[TRACE_CAPACITY];
+    unsigned long long head;     // next slot to write
+    unsigned long long tail;     // next slot to flush
+    unsigned long dropped;       // events overwritten before they were flushed
+    double frameStartUs;
+    double originUs;
+    FILE *file;
+};
+
+static TraceRing gTrace = {};
+
+static inline double TraceNowUs()
+{
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count() - gTrace.originUs;
+}
+
+static inline void TracePush(char ph, const char *name, double tsUs, float durUs,
+                             const char *argName = nullptr, const char *argValue = nullptr)
+{
+    TraceRing &t = gTrace;
+    if (t.head - t.tail == (unsigned long long)TRACE_CAPACITY) { t.tail++; t.dropped++; }  // overwrite oldest
+    TraceEvent &e = t.events[t.head % TRACE_CAPACITY];
+    e.name = name; e.argName = argName; e.argValue = argValue;
+    e.tsUs = tsUs; e.durUs = durUs; e.ph = ph;
+    t.head++;
+}
+
+static inline void TraceComplete(const char *name, double startUs)
+{
+    TracePush('X', name, startUs, (float)(TraceNowUs() - startUs));
+}
+
+static inline void TraceInstant(const char *name, const char *argName, const char *argValue)
+{
+    TracePush('i', name, TraceNowUs(), 0.0f, argName, argValue);
+}
+
+// Records a complete ('X') event for the enclosing scope
+struct TraceScope {
+    const char *name;
+    double start;
+    explicit TraceScope(const char *n) : name(n), start(TraceNowUs()) {}
+    ~TraceScope() { TraceComplete(name, start); }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+static inline void TraceFrameBegin() { gTrace.frameStartUs = TraceNowUs(); }
+static inline void TraceFrameEnd()   { TraceComplete("frame", gTrace.frameStartUs); }
+
+static void TraceOpen()
+{
+    using namespace std::chrono;
+    gTrace.originUs = duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+    gTrace.file = fopen(TRACE_FILE, "wb");   // binary: TraceFlush() seeks back over "\n]\n", 3 bytes only without \r\n
+    if (!gTrace.file) { TraceLog(LOG_WARNING, "TRACE: could not open %s", TRACE_FILE); return; }
+
+    // Metadata first, so every event after it can be written as ",\n{...}"
+    fprintf(gTrace.file, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Dodge\"}}");
+}
+
+// Write everything between tail and head, then re-terminate the array so the file stays valid
+static void TraceFlush()
+{
+    TraceRing &t = gTrace;
+    if (!t.file || t.tail == t.head) return;
+
+    for (; t.tail != t.head; t.tail++) {
+        const TraceEvent &e = t.events[t.tail % TRACE_CAPACITY];
+        fprintf(t.file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":1,\"ts\":%.3f",
+                e.name, e.ph, e.tsUs);
+        if (e.ph == 'X') fprintf(t.file, ",\"dur\":%.3f", e.durUs);
+        if (e.ph == 'i') fprintf(t.file, ",\"s\":\"g\"");
+        if (e.argName) fprintf(t.file, ",\"args\":{\"%s\":\"%s\"}", e.argName, e.argValue);
+        fputc('}', t.file);
+    }
+
+    fputs("\n]\n", t.file);
+    fflush(t.file);
+    fseek(t.file, -3, SEEK_CUR);   // next flush overwrites the closing bracket
+}
+
+// Called once per frame after EndDrawing
+static void TraceFlushIfIdle(bool playing)
+{
+    if (!playing || gTrace.head - gTrace.tail > (unsigned long long)(TRACE_CAPACITY*3/4)) TraceFlush();
+}
+
+static void TraceClose()
+{
+    TraceFlush();
+    if (!gTrace.file) return;
+    fclose(gTrace.file);
+    gTrace.file = nullptr;
+    TraceLog(LOG_INFO, "TRACE: wrote %s (%lu events dropped)", TRACE_FILE, gTrace.dropped);
+}
+
+// F5: web downloads the MEMFS file through shell.html, desktop just flushes to disk
+static void TraceHandleInput()
+{
+    if (!IsKeyPressed(KEY_F5)) return;
+    TraceFlush();
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ saveFileFromMEMFSToDisk("/dodge_trace.json", "dodge_trace.json"); });
+#endif
+}
+
+#else // !DODGE_TRACE
+
+#define TRACE_SCOPE(name)                      ((void)0)
+#define TraceInstant(name, argName, argValue)  ((void)0)
+#define TraceFrameBegin()                      ((void)0)
+#define TraceFrameEnd()                        ((void)0)
+#define TraceOpen()                            ((void)0)
+#define TraceFlushIfIdle(playing)              ((void)0)
+#define TraceClose()                           ((void)0)
+#define TraceHandleInput()                     ((void)0)
+
+#endif // DODGE_TRACE
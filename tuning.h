@@ -0,0 +1,194 @@
+/*******************************************************************************************
+* tuning.h - enemy profiles (size and speed ranges per kind) from enemy_profiles.txt
+*
+*   File format, one kind per line, '#' starts a comment:
+*     # kind  w_min w_max  h_min h_max  speed_base speed_min speed_max
+*     rain    3     6      14    24     180        40        180
+*   Kinds missing from the file keep their current values. A file with a bad line is
+*   rejected as a whole, so a half-typed edit never reaches the game.
+*
+*   - TuningLoad() reads the file once at startup (desktop: working directory, web: MEMFS,
+*     ship it with --preload-file enemy_profiles.txt). Without the file the defaults in
+*     game.h are used.
+*   - Desktop Linux: TuningWatchStart() starts an inotify watcher thread. Each save is parsed
+*     on that thread into a new table and posted; TuningPoll() copies a posted table into
+*     the Game between frames. The frame never waits: if the watcher holds the lock, the
+*     table is applied on the next frame.
+*   - New values apply to enemies as they spawn or recycle; falling enemies keep their size.
+*******************************************************************************************/
+
+#pragma once
+
+#include "raylib.h"
+#include "game.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+  #define TUNING_HOT_RELOAD
+  #include <atomic>
+  #include <mutex>
+  #include <thread>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+#define TUNING_FILE "enemy_profiles.txt"     // cwd on desktop, MEMFS root on web
+
+static const char *const ENEMY_KIND_NAMES[] = { "sun", "cloud", "rain" };
+
+// -----------------------------------------------------------------------------------------
+// Parse the whole file into 'table' (which holds the current values on entry).
+// False on the first bad line, with 'table' left untouched.
+// -----------------------------------------------------------------------------------------
+static bool TuningParse(const char *text, EnemyProfileTable &table)
+{
+    EnemyProfileTable next = table;
+    int lineNo = 0;
+
+    for (const char *line = text; line && *line; ) {
+        const char *eol = strchr(line, '\n');
+        size_t len = eol ? (size_t)(eol - line) : strlen(line);
+        char buf[256];
+        if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+        memcpy(buf, line, len);
+        buf[len] = '\0';
+        line = eol ? eol + 1 : nullptr;
+        lineNo++;
+
+        if (char *comment = strchr(buf, '#')) *comment = '\0';
+
+        char name[16];
+        EnemyProfile p;
+        int n = sscanf(buf, "%15s %d %d %d %d %f %d %d", name, &p.wMin, &p.wMax, &p.hMin, &p.hMax,
+                       &p.speedBase, &p.speedMin, &p.speedMax);
+        if (n <= 0) continue;   // blank or comment-only line
+
+        int kind = -1;
+        for (int k = 0; k < ENEMY_KIND_COUNT; ++k) {
+            if (!strcmp(name, ENEMY_KIND_NAMES[k])) kind = k;
+        }
+        bool valid = (n == 8) && (kind >= 0) &&
+                     (p.wMin > 0) && (p.wMin <= p.wMax) && (p.wMax <= SCREEN_W) &&
+                     (p.hMin > 0) && (p.hMin <= p.hMax) && (p.speedMin <= p.speedMax) &&
+                     (p.speedBase + p.speedMin > 0.0f);   // enemies must fall
+        if (!valid) {
+            TraceLog(LOG_WARNING, "TUNING: %s line %d: expected 'sun|cloud|rain w_min w_max h_min h_max "
+                                  "speed_base speed_min speed_max', file ignored", TUNING_FILE, lineNo);
+            return false;
+        }
+        next.kinds[kind] = p;
+    }
+
+    table = next;
+    return true;
+}
+
+// Startup load; false (table unchanged) when the file is missing or invalid
+static bool TuningLoad(EnemyProfileTable &table)
+{
+    if (!FileExists(TUNING_FILE)) return false;
+    char *text = LoadFileText(TUNING_FILE);
+    if (!text) return false;
+
+    bool ok = TuningParse(text, table);
+    UnloadFileText(text);
+    if (ok) TraceLog(LOG_INFO, "TUNING: loaded %s", TUNING_FILE);
+    return ok;
+}
+
+#ifdef TUNING_HOT_RELOAD
+
+// -----------------------------------------------------------------------------------------
+// Hot reload (desktop Linux): watcher thread -> posted table -> TuningPoll() on the main thread
+// -----------------------------------------------------------------------------------------
+struct TuningWatcher {
+    std::thread thread;
+    std::atomic<bool> stop{ false };
+    std::atomic<bool> pending{ false };     // 'posted' holds a table the game has not applied yet
+    std::mutex lock;                        // guards 'posted'
+    EnemyProfileTable posted;
+    EnemyProfileTable current;              // watcher thread only: base for files that list some kinds
+};
+
+static TuningWatcher gTuning;
+
+// Watcher thread: plain open/read into a fixed buffer (no stdio, no heap)
+static void TuningReloadFile()
+{
+    static char text[8192];
+    int fd = open(TUNING_FILE, O_RDONLY);
+    if (fd < 0) return;
+    ssize_t n = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (n < 0) return;
+    text[n] = '\0';
+
+    if (!TuningParse(text, gTuning.current)) return;   // keep playing with the old table
+
+    std::lock_guard<std::mutex> guard(gTuning.lock);
+    gTuning.posted = gTuning.current;
+    gTuning.pending.store(true, std::memory_order_release);
+}
+
+static void TuningWatchThread()
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+
+    // Watch the directory, not the file: editors often save by renaming a temp file over it
+    if (inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0) { close(fd); return; }
+
+    alignas(inotify_event) char events[4096];
+    while (!gTuning.stop.load(std::memory_order_relaxed)) {
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 250) <= 0) continue;   // wake up now and then to check 'stop'
+
+        ssize_t n = read(fd, events, sizeof(events));
+        bool changed = false;
+        for (ssize_t off = 0; off < n; ) {
+            const inotify_event *e = (const inotify_event *)(events + off);
+            if (e->len && !strcmp(e->name, TUNING_FILE)) changed = true;
+            off += sizeof(inotify_event) + e->len;
+        }
+        if (changed) TuningReloadFile();
+    }
+    close(fd);
+}
+
+static void TuningWatchStart(const EnemyProfileTable &current)
+{
+    gTuning.current = current;
+    gTuning.thread = std::thread(TuningWatchThread);
+}
+
+static void TuningWatchStop()
+{
+    if (!gTuning.thread.joinable()) return;
+    gTuning.stop.store(true);
+    gTuning.thread.join();
+}
+
+// Once per frame, before StepGame(): apply a posted table. Never blocks.
+static void TuningPoll(Game &game)
+{
+    if (!gTuning.pending.load(std::memory_order_acquire)) return;
+
+    std::unique_lock<std::mutex> guard(gTuning.lock, std::try_to_lock);
+    if (!guard.owns_lock()) return;          // the watcher is posting right now: next frame
+
+    game.profiles = gTuning.posted;
+    gTuning.pending.store(false, std::memory_order_relaxed);
+    TraceInstant("tuning", "file", TUNING_FILE);
+    TraceLog(LOG_INFO, "TUNING: reloaded %s", TUNING_FILE);
+}
+
+#else // !TUNING_HOT_RELOAD
+
+static inline void TuningWatchStart(const EnemyProfileTable &) {}
+static inline void TuningWatchStop() {}
+static inline void TuningPoll(Game &) {}
+
+#endif // TUNING_HOT_RELOAD
@@ -0,0 +1,138 @@
+/*******************************************************************************************
+* versus.h - two players dodging the same field (the simulation; rollback.h does the netcode)
+*
+*   - One Game holds the shared field (enemies, RNG, difficulty, round time); its own player
+*     is unused. Both players move, then the enemies, then each player is tested against them.
+*   - A round ends when both players are out; whoever survived longer takes it. The next
+*     round starts VERSUS_RESTART_TICKS later, reset from the field's RNG like a normal run.
+*   - Every tick is VERSUS_DT: the state after tick k is a pure function of the seed and
+*     both players' keys for ticks 0..k, so two peers fed the same inputs stay identical
+*     (same build on both ends: the float math is not bit-portable across compilers)
+*   - A tick costs one StepGame and a second PlayerHit; rollback re-runs up to
+*     ROLLBACK_MAX_FRAMES of them inside one frame
+*******************************************************************************************/
+
+#pragma once
+
+#include "game.h"
+#include "snapshot.h"
+
+static const int   VERSUS_PLAYERS = 2;
+static const float VERSUS_DT = 1.0f/60.0f;
+static const int   VERSUS_RESTART_TICKS = 120;      // both out: next round after 2 s
+
+// Everything besides the field: plain data, copied whole by snapshots
+struct VersusPlayers {
+    Player player[VERSUS_PLAYERS];
+    bool alive[VERSUS_PLAYERS];
+    float score[VERSUS_PLAYERS];        // this round (seconds * 60, like a normal run)
+    int wins[VERSUS_PLAYERS];
+    int round;                          // from 0
+    int overTicks;                      // ticks since both went out (-1 while the round is on)
+    int tick;                           // ticks stepped since VersusInit
+};
+
+struct Versus {
+    Game field;
+    VersusPlayers players;
+};
+
+struct VersusSnapshot {
+    GameSnapshot field;
+    VersusPlayers players;
+};
+
+// -----------------------------------------------------------------------------------------
+// Rounds
+// -----------------------------------------------------------------------------------------
+inline void VersusStartRound(Versus &v)
+{
+    ResetGame(v.field);
+    VersusPlayers &p = v.players;
+    for (int i = 0; i < VERSUS_PLAYERS; ++i) {
+        Player &player = p.player[i];
+        player.rect = { SCREEN_W*(i + 1)/3.0f - 18.0f, SCREEN_H - 70.0f, 36.0f, 36.0f };
+        player.prevRect = player.rect;
+        p.alive[i] = true;
+        p.score[i] = 0.0f;
+    }
+    p.overTicks = -1;
+}
+
+inline void VersusInit(Versus &v, unsigned long long seed, int enemyCount)
+{
+    InitGame(v.field, seed, enemyCount, WeatherKind::SUNNY);
+    v.field.state = GameState::PLAYING;
+    v.players = VersusPlayers{};
+    VersusStartRound(v);
+}
+
+// -----------------------------------------------------------------------------------------
+// One tick: keys[i] is player i's GameKeys for this tick
+// -----------------------------------------------------------------------------------------
+inline void VersusStep(Versus &v, const unsigned char keys[VERSUS_PLAYERS])
+{
+    VersusPlayers &p = v.players;
+    p.tick++;
+
+    if (p.overTicks >= 0) {
+        if (++p.overTicks >= VERSUS_RESTART_TICKS) {
+            p.round++;
+            VersusStartRound(v);
+        }
+        return;
+    }
+
+    for (int i = 0; i < VERSUS_PLAYERS; ++i)
+        if (p.alive[i]) UpdatePlayer(p.player[i], KeysToMove(keys[i]), VERSUS_DT);
+
+    UpdateDifficulty(v.field);
+    FallEnemies(v.field, VERSUS_DT);
+
+    for (int i = 0; i < VERSUS_PLAYERS; ++i) {
+        if (!p.alive[i]) continue;
+        if (PlayerHit(p.player[i], v.field.enemies, VERSUS_DT)) p.alive[i] = false;
+        else p.score[i] += 60.0f*VERSUS_DT;
+    }
+    RecycleEnemies(v.field);
+    v.field.score += 60.0f*VERSUS_DT;
+
+    if (!p.alive[0] && !p.alive[1]) {
+        // Out on the same tick: a draw
+        if (p.score[0] != p.score[1]) p.wins[(p.score[0] > p.score[1]) ? 0 : 1]++;
+        p.overTicks = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+// Save states (rollback) and checksums (desync checks)
+// -----------------------------------------------------------------------------------------
+inline void SaveVersusSnapshot(const Versus &v, VersusSnapshot &snap)
+{
+    SaveGameSnapshot(v.field, snap.field);
+    snap.players = v.players;
+}
+
+inline bool LoadVersusSnapshot(Versus &v, const VersusSnapshot &snap)
+{
+    if (!LoadGameSnapshot(v.field, snap.field)) return false;
+    v.players = snap.players;
+    return true;
+}
+
+// GameChecksum of the field, then each player field by field (no struct padding)
+inline unsigned long long VersusChecksum(const Versus &v)
+{
+    unsigned long long h = GameChecksum(v.field);
+    const VersusPlayers &p = v.players;
+    for (int i = 0; i < VERSUS_PLAYERS; ++i) {
+        h = HashBytes(h, &p.player[i].rect, sizeof(p.player[i].rect));
+        h = HashBytes(h, &p.alive[i], sizeof(p.alive[i]));
+        h = HashBytes(h, &p.score[i], sizeof(p.score[i]));
+        h = HashBytes(h, &p.wins[i], sizeof(p.wins[i]));
+    }
+    h = HashBytes(h, &p.round, sizeof(p.round));
+    h = HashBytes(h, &p.overTicks, sizeof(p.overTicks));
+    h = HashBytes(h, &p.tick, sizeof(p.tick));
+    return h;
+}